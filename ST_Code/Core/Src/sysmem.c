@@ -70,7 +70,13 @@ void* _sbrk(int incr)
 		heap_end = &end;
 
 	prev_heap_end = heap_end;
+#if POOL_HOOK_MALLOC == true
+	/* The app's pool allocator, demo/pool.c, replaces malloc(): the
+	   heap never grows, but _sbrk(0) still reports where it ends */
+	if (incr != 0)
+#else
 	if (heap_end + incr > stack_ptr)
+#endif
 	{
 		errno = ENOMEM;
 		return (void*) -1;
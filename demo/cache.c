@@ -0,0 +1,203 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#define     LOG_MODULE      LOG_MODULE_HTTP
+#include "main.h"
+
+
+/*
+ * NOTE Entries are keyed by a 32-bit hash of the URL, not the URL itself,
+ *      to keep them small. Two URLs in the cache with the same hash would
+ *      share an entry, but the server only answers 304 if the validator
+ *      matches its own resource, so that costs a miss, not a wrong answer,
+ *      unless the two resources carry the same validator.
+ *
+ *      What's cached is the value the app made of the body, eg. a parsed
+ *      record, not the body, so a hit saves parsing as well as the download.
+ */
+
+
+/*
+ * TYPES
+ */
+struct CacheEntry {
+    uint32_t                hash;           // 0 if the entry is free
+    uint32_t                hits;
+    uint32_t                last_used;
+    uint32_t                body_len;       // What each hit saves downloading
+    uint32_t                length;
+    struct CacheValidator   validator;
+    uint8_t                 value[CACHE_VALUE_MAX_LEN_B];
+};
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static struct CacheEntry* cache_find(uint32_t hash);
+
+
+/*
+ * GLOBALS
+ */
+static struct CacheEntry cache_entries[CACHE_ENTRIES];
+static uint32_t cache_clock = 0;
+static struct CacheStats cache_stats = { 0 };
+
+
+/**
+ * @brief Hash a cache key: FNV-1a.
+ *
+ * @param key: The key, eg. a URL.
+ *
+ * @returns The hash, which is never 0.
+ */
+uint32_t cache_hash(const char* key) {
+
+    uint32_t hash = 2166136261UL;
+    while (*key != 0) hash = (hash ^ (uint8_t)*key++) * 16777619UL;
+    return hash != 0 ? hash : 1;
+}
+
+
+/**
+ * @brief Get the validator with which to make a request conditional.
+ *
+ * @param hash: The URL's hash.
+ *
+ * @returns The validator, or `NULL` if the URL is not cached. Only valid
+ *          until the next call to `cache_store()`.
+ */
+const struct CacheValidator* cache_validator(uint32_t hash) {
+
+    cache_stats.lookups++;
+    struct CacheEntry* entry = cache_find(hash);
+    if (entry == NULL) return NULL;
+
+    cache_stats.conditional++;
+    return &entry->validator;
+}
+
+
+/**
+ * @brief Get the cached value for a URL the server says has not changed.
+ *
+ * @param hash:   The URL's hash.
+ * @param length: Receives the size of the value in bytes.
+ *
+ * @returns The value, or `NULL` if it's no longer cached. Only valid
+ *          until the next call to `cache_store()`.
+ */
+const void* cache_hit(uint32_t hash, uint32_t* length) {
+
+    struct CacheEntry* entry = cache_find(hash);
+    if (entry == NULL) return NULL;
+
+    entry->hits++;
+    entry->last_used = ++cache_clock;
+    cache_stats.hits++;
+    cache_stats.bytes_saved += entry->body_len;
+    *length = entry->length;
+    return entry->value;
+}
+
+
+/**
+ * @brief Cache the value made of a response, with the response's validator.
+ *
+ * A full cache gives up the entry with the fewest hits. Of entries never
+ * hit, the newest goes, so a request cycle longer than the cache -- which
+ * plain LRU would churn through without a hit -- keeps the entries it
+ * stored first, and hits them on its next pass. Of entries that have been
+ * hit, the least recently used goes.
+ *
+ * @param hash:      The URL's hash.
+ * @param validator: The response's ETag or Last-Modified.
+ * @param body_len:  The size of the response body.
+ * @param value:     The value to cache.
+ * @param length:    Its size in bytes, up to CACHE_VALUE_MAX_LEN_B.
+ *
+ * @returns `true` if the value was cached, otherwise `false`.
+ */
+bool cache_store(uint32_t hash, const struct CacheValidator* validator, uint32_t body_len,
+                 const void* value, uint32_t length) {
+
+    if (validator->type == CACHE_VALIDATOR_NONE || length > CACHE_VALUE_MAX_LEN_B) return false;
+
+    struct CacheEntry* entry = cache_find(hash);
+    if (entry == NULL) {
+        // A free entry, or the victim
+        for (uint32_t i = 0 ; i < CACHE_ENTRIES ; ++i) {
+            struct CacheEntry* candidate = &cache_entries[i];
+            if (candidate->hash == 0) {
+                entry = candidate;
+                cache_stats.entries++;
+                break;
+            }
+
+            if (entry == NULL || candidate->hits < entry->hits) {
+                entry = candidate;
+            } else if (candidate->hits == entry->hits) {
+                bool older = candidate->last_used < entry->last_used;
+                if (candidate->hits == 0 ? !older : older) entry = candidate;
+            }
+        }
+
+        if (entry->hash != 0) cache_stats.evictions++;
+        entry->hash = hash;
+        entry->hits = 0;
+    }
+
+    entry->last_used = ++cache_clock;
+    entry->body_len = body_len;
+    entry->length = length;
+    entry->validator = *validator;
+    memcpy(entry->value, value, length);
+    cache_stats.stores++;
+    return true;
+}
+
+
+/**
+ * @brief Copy out the cache's counters.
+ *
+ * @param stats: Pointer to the record to fill.
+ */
+void cache_get_stats(struct CacheStats* stats) {
+
+    *stats = cache_stats;
+}
+
+
+/**
+ * @brief Log the cache's counters.
+ */
+void cache_report(void) {
+
+    uint32_t rate = cache_stats.lookups > 0 ? cache_stats.hits * 100 / cache_stats.lookups : 0;
+    server_log("Cache: %lu of %u entries, %lu lookups, %lu conditional, %lu hits (%lu%%), %lu evictions, %lu bytes saved",
+               cache_stats.entries, CACHE_ENTRIES, cache_stats.lookups, cache_stats.conditional,
+               cache_stats.hits, rate, cache_stats.evictions, (uint32_t)cache_stats.bytes_saved);
+}
+
+
+/**
+ * @brief Find a URL's entry.
+ *
+ * @param hash: The URL's hash.
+ *
+ * @returns The entry, or `NULL` if the URL is not cached.
+ */
+static struct CacheEntry* cache_find(uint32_t hash) {
+
+    for (uint32_t i = 0 ; i < CACHE_ENTRIES ; ++i) {
+        if (cache_entries[i].hash == hash) return &cache_entries[i];
+    }
+
+    return NULL;
+}
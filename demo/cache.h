@@ -0,0 +1,68 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     CACHE_ENTRIES               32
+#define     CACHE_VALIDATOR_MAX_LEN_B   40            // Room for a quoted ETag, or an HTTP date
+#define     CACHE_VALUE_MAX_LEN_B       80
+
+
+/*
+ * TYPES
+ */
+enum CacheValidatorType {
+    CACHE_VALIDATOR_NONE = 0,
+    CACHE_VALIDATOR_ETAG,                   // Sent back as If-None-Match
+    CACHE_VALIDATOR_DATE                    // Last-Modified, sent back as If-Modified-Since
+};
+
+struct CacheValidator {
+    enum CacheValidatorType     type;
+    char                        value[CACHE_VALIDATOR_MAX_LEN_B];
+};
+
+struct CacheStats {
+    uint32_t    entries;            // In use now
+    uint32_t    lookups;            // Requests that could have been made conditional
+    uint32_t    conditional;        // Requests sent with a validator
+    uint32_t    hits;               // 304s answered from the cache
+    uint32_t    stores;
+    uint32_t    evictions;
+    uint64_t    bytes_saved;        // Response bodies not downloaded
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+uint32_t                        cache_hash(const char* key);
+const struct CacheValidator*    cache_validator(uint32_t hash);
+const void*                     cache_hit(uint32_t hash, uint32_t* length);
+bool                            cache_store(uint32_t hash, const struct CacheValidator* validator, uint32_t body_len,
+                                            const void* value, uint32_t length);
+void                            cache_get_stats(struct CacheStats* stats);
+void                            cache_report(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _CACHE_H_
@@ -0,0 +1,306 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * NOTE CBOR (RFC 8949) encodes each item as a head -- a major type in
+ *      its top three bits and an argument -- then, for strings, the
+ *      bytes. Arguments under 24 fit in the head's own byte, so the
+ *      small numbers of telemetry cost a byte or two each, where JSON
+ *      spends a digit a decade plus separators, and no formatting.
+ */
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     cbor_head(struct CborWriter* writer, uint8_t major, uint32_t argument);
+static void     cbor_put(struct CborWriter* writer, const uint8_t* data, uint32_t length);
+
+
+/**
+ * @brief Set up a writer.
+ *
+ * @param writer: The writer.
+ * @param data:   The buffer to write, or `NULL` to count bytes only.
+ * @param size:   Its size in bytes.
+ */
+void cbor_writer_init(struct CborWriter* writer, uint8_t* data, uint32_t size) {
+
+    writer->data = data;
+    writer->size = data != NULL ? size : UINT32_MAX;
+    writer->length = 0;
+    writer->overflow = false;
+}
+
+
+/**
+ * @brief Write an unsigned integer.
+ */
+void cbor_uint(struct CborWriter* writer, uint32_t value) {
+
+    cbor_head(writer, CBOR_MAJOR_UINT, value);
+}
+
+
+/**
+ * @brief Write a signed integer.
+ */
+void cbor_int(struct CborWriter* writer, int32_t value) {
+
+    // A negative integer n is encoded as -1 - n, ie. its complement
+    if (value < 0) {
+        cbor_head(writer, CBOR_MAJOR_NEGATIVE, ~(uint32_t)value);
+    } else {
+        cbor_head(writer, CBOR_MAJOR_UINT, (uint32_t)value);
+    }
+}
+
+
+/**
+ * @brief Write a byte string.
+ */
+void cbor_bytes(struct CborWriter* writer, const uint8_t* data, uint32_t length) {
+
+    cbor_head(writer, CBOR_MAJOR_BYTES, length);
+    cbor_put(writer, data, length);
+}
+
+
+/**
+ * @brief Write a UTF-8 text string, eg. a map key.
+ */
+void cbor_text(struct CborWriter* writer, const char* text, uint32_t length) {
+
+    cbor_head(writer, CBOR_MAJOR_TEXT, length);
+    cbor_put(writer, (const uint8_t*)text, length);
+}
+
+
+/**
+ * @brief Start an array. Write its `count` items next.
+ */
+void cbor_array(struct CborWriter* writer, uint32_t count) {
+
+    cbor_head(writer, CBOR_MAJOR_ARRAY, count);
+}
+
+
+/**
+ * @brief Start a map. Write its `count` keys and values next, alternately.
+ */
+void cbor_map(struct CborWriter* writer, uint32_t count) {
+
+    cbor_head(writer, CBOR_MAJOR_MAP, count);
+}
+
+
+/**
+ * @brief Write `true` or `false`.
+ */
+void cbor_bool(struct CborWriter* writer, bool value) {
+
+    cbor_head(writer, CBOR_MAJOR_SIMPLE, value ? 21 : 20);
+}
+
+
+/**
+ * @brief Write `null`.
+ */
+void cbor_null(struct CborWriter* writer) {
+
+    cbor_head(writer, CBOR_MAJOR_SIMPLE, 22);
+}
+
+
+/**
+ * @brief Set up a reader.
+ *
+ * @param reader: The reader.
+ * @param data:   The encoded items, eg. a response body.
+ * @param length: Their length in bytes.
+ */
+void cbor_reader_init(struct CborReader* reader, const uint8_t* data, uint32_t length) {
+
+    reader->data = data;
+    reader->length = length;
+    reader->offset = 0;
+    reader->error = false;
+}
+
+
+/**
+ * @brief Read the next item.
+ *
+ * An array, map or tag is returned as its head alone: its contents are
+ * the items that follow.
+ *
+ * @param reader: The reader.
+ * @param item:   Receives the item.
+ *
+ * @returns `true` if an item was read, `false` at the end of the input or
+ *          if it's malformed, in which case the reader's `error` is set.
+ */
+bool cbor_read(struct CborReader* reader, struct CborItem* item) {
+
+    if (reader->error || reader->offset >= reader->length) return false;
+
+    uint8_t head = reader->data[reader->offset++];
+    uint8_t major = head >> 5;
+    uint8_t info = head & 0x1F;
+
+    // The argument: in the head, or in the 1, 2 or 4 bytes after it
+    uint32_t argument = info;
+    uint32_t extra = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : info == 27 ? 8 : 0;
+    if (info > 27 || reader->length - reader->offset < extra || (extra == 8 && major != CBOR_MAJOR_SIMPLE)) {
+        reader->error = true;
+        return false;
+    }
+
+    const uint8_t* bytes = &reader->data[reader->offset];
+    if (extra > 0 && extra < 8) {
+        argument = 0;
+        for (uint32_t i = 0 ; i < extra ; ++i) argument = (argument << 8) | bytes[i];
+    }
+
+    reader->offset += extra;
+    item->value = argument;
+    item->data = NULL;
+
+    switch (major) {
+        case CBOR_MAJOR_BYTES:
+        case CBOR_MAJOR_TEXT:
+            if (reader->length - reader->offset < argument) {
+                reader->error = true;
+                return false;
+            }
+
+            item->type = major == CBOR_MAJOR_BYTES ? CBOR_TYPE_BYTES : CBOR_TYPE_TEXT;
+            item->data = &reader->data[reader->offset];
+            reader->offset += argument;
+            return true;
+        case CBOR_MAJOR_SIMPLE:
+            if (extra > 1) {
+                item->type = CBOR_TYPE_FLOAT;
+                item->data = bytes;
+                item->value = extra;
+                return true;
+            }
+
+            if (argument < 20 || argument > 23) {
+                reader->error = true;
+                return false;
+            }
+
+            item->type = (enum CborType)(CBOR_TYPE_FALSE + (argument - 20));
+            return true;
+        default:
+            // Unsigned, negative, array, map and tag are in major type order
+            item->type = (enum CborType)(CBOR_TYPE_UINT + major);
+            return true;
+    }
+}
+
+
+/**
+ * @brief Skip the next item, with all its contents if it's an array, map or tag.
+ *
+ * @param reader: The reader.
+ *
+ * @returns `true` if the item was skipped, otherwise `false`.
+ */
+bool cbor_skip(struct CborReader* reader) {
+
+    uint32_t pending = 1;
+    while (pending > 0) {
+        struct CborItem item;
+        if (!cbor_read(reader, &item)) return false;
+        pending--;
+
+        uint32_t remaining = reader->length - reader->offset;
+        uint32_t contents = 0;
+        if (item.type == CBOR_TYPE_ARRAY) {
+            contents = item.value;
+        } else if (item.type == CBOR_TYPE_MAP) {
+            contents = item.value > remaining ? UINT32_MAX : item.value * 2;
+        } else if (item.type == CBOR_TYPE_TAG) {
+            contents = 1;
+        }
+
+        // No item takes less than a byte, so more items than bytes left is malformed
+        if (contents > remaining - pending) {
+            reader->error = true;
+            return false;
+        }
+
+        pending += contents;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Check whether an item is a given text string, eg. a map key.
+ */
+bool cbor_text_equals(const struct CborItem* item, const char* text, uint32_t length) {
+
+    return item->type == CBOR_TYPE_TEXT && item->value == length && memcmp(item->data, text, length) == 0;
+}
+
+
+/**
+ * @brief Write an item's head, in the fewest bytes that hold its argument.
+ *
+ * @param writer:   The writer.
+ * @param major:    The major type.
+ * @param argument: The value, length or count.
+ */
+static void cbor_head(struct CborWriter* writer, uint8_t major, uint32_t argument) {
+
+    uint8_t head[5];
+    uint32_t length = 1;
+    if (argument < 24) {
+        head[0] = (uint8_t)((major << 5) | argument);
+    } else if (argument <= 0xFF) {
+        head[0] = (uint8_t)((major << 5) | 24);
+        head[1] = (uint8_t)argument;
+        length = 2;
+    } else if (argument <= 0xFFFF) {
+        head[0] = (uint8_t)((major << 5) | 25);
+        head[1] = (uint8_t)(argument >> 8);
+        head[2] = (uint8_t)argument;
+        length = 3;
+    } else {
+        head[0] = (uint8_t)((major << 5) | 26);
+        head[1] = (uint8_t)(argument >> 24);
+        head[2] = (uint8_t)(argument >> 16);
+        head[3] = (uint8_t)(argument >> 8);
+        head[4] = (uint8_t)argument;
+        length = 5;
+    }
+
+    cbor_put(writer, head, length);
+}
+
+
+/**
+ * @brief Append bytes, or just count them if the writer has no buffer.
+ */
+static void cbor_put(struct CborWriter* writer, const uint8_t* data, uint32_t length) {
+
+    if (writer->overflow || writer->size - writer->length < length) {
+        writer->overflow = true;
+        return;
+    }
+
+    if (writer->data != NULL && length > 0) memcpy(&writer->data[writer->length], data, length);
+    writer->length += length;
+}
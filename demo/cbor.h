@@ -0,0 +1,104 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _CBOR_H_
+#define _CBOR_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     CBOR_MAJOR_UINT             0
+#define     CBOR_MAJOR_NEGATIVE         1
+#define     CBOR_MAJOR_BYTES            2
+#define     CBOR_MAJOR_TEXT             3
+#define     CBOR_MAJOR_ARRAY            4
+#define     CBOR_MAJOR_MAP              5
+#define     CBOR_MAJOR_TAG              6
+#define     CBOR_MAJOR_SIMPLE           7
+
+// A string literal and its length, counted by the compiler, eg. `cbor_text(writer, CBOR_LITERAL("id"))`
+#define     CBOR_LITERAL(text)          ("" text), (sizeof(text) - 1)
+
+
+/*
+ * TYPES
+ */
+// Writes items in order into a buffer. With no buffer, only counts
+// the bytes the items need, eg. to size a request body before writing it
+struct CborWriter {
+    uint8_t*    data;
+    uint32_t    size;
+    uint32_t    length;
+    bool        overflow;           // An item didn't fit: sticky
+};
+
+enum CborType {
+    CBOR_TYPE_UINT = 0,
+    CBOR_TYPE_NEGATIVE,             // The value is -1 - `value`
+    CBOR_TYPE_BYTES,
+    CBOR_TYPE_TEXT,
+    CBOR_TYPE_ARRAY,
+    CBOR_TYPE_MAP,
+    CBOR_TYPE_TAG,
+    CBOR_TYPE_FALSE,
+    CBOR_TYPE_TRUE,
+    CBOR_TYPE_NULL,
+    CBOR_TYPE_UNDEFINED,
+    CBOR_TYPE_FLOAT                 // Half, single or double precision, left encoded in `data`
+};
+
+// One item. `value` is the integer, the tag, the number of array
+// items or map pairs, or the length of `data`. `data` points into the
+// reader's input, for strings and floats
+struct CborItem {
+    enum CborType   type;
+    uint32_t        value;
+    const uint8_t*  data;
+};
+
+// Reads items in order from a buffer. Only definite lengths and
+// arguments up to 32 bits are supported
+struct CborReader {
+    const uint8_t*  data;
+    uint32_t        length;
+    uint32_t        offset;
+    bool            error;          // Malformed or unsupported input: sticky
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        cbor_writer_init(struct CborWriter* writer, uint8_t* data, uint32_t size);
+void        cbor_uint(struct CborWriter* writer, uint32_t value);
+void        cbor_int(struct CborWriter* writer, int32_t value);
+void        cbor_bytes(struct CborWriter* writer, const uint8_t* data, uint32_t length);
+void        cbor_text(struct CborWriter* writer, const char* text, uint32_t length);
+void        cbor_array(struct CborWriter* writer, uint32_t count);
+void        cbor_map(struct CborWriter* writer, uint32_t count);
+void        cbor_bool(struct CborWriter* writer, bool value);
+void        cbor_null(struct CborWriter* writer);
+
+void        cbor_reader_init(struct CborReader* reader, const uint8_t* data, uint32_t length);
+bool        cbor_read(struct CborReader* reader, struct CborItem* item);
+bool        cbor_skip(struct CborReader* reader);
+bool        cbor_text_equals(const struct CborItem* item, const char* text, uint32_t length);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _CBOR_H_
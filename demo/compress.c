@@ -0,0 +1,241 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * NOTE The output is an LZSS bit stream, laid out as heatshrink lays
+ *      it out with a window of 2^COMPRESS_WINDOW_BITS bytes and copies
+ *      of up to 2^COMPRESS_LENGTH_BITS: most significant bit first, a
+ *      one bit then a literal byte, or a zero bit, the distance back
+ *      less one and the length less one. The last byte is padded with
+ *      zero bits. A copy costs 15 bits to a literal's nine, so copies of
+ *      two bytes or more are used.
+ *
+ *      There is no allocation: the compressor is one struct, about 3.5KB,
+ *      which the caller owns. A dictionary of text the input is likely
+ *      to repeat can be loaded as history, so even short inputs find
+ *      matches; the decoder must be given the same dictionary.
+ */
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     compress_block(struct Compressor* compressor, bool final);
+static void     compress_bits(struct Compressor* compressor, uint32_t value, uint32_t count);
+
+
+/**
+ * @brief Set up a compressor.
+ *
+ * @param compressor:     The compressor.
+ * @param data:           The buffer for the compressed output.
+ * @param size:           Its size in bytes. COMPRESS_BOUND() of the input always fits.
+ * @param dictionary:     Text to preload as history, or `NULL`.
+ * @param dictionary_len: Its length. Only the last COMPRESS_WINDOW_B bytes are used.
+ */
+void compress_init(struct Compressor* compressor, uint8_t* data, uint32_t size,
+                   const uint8_t* dictionary, uint32_t dictionary_len) {
+
+    if (dictionary_len > COMPRESS_WINDOW_B) {
+        dictionary += dictionary_len - COMPRESS_WINDOW_B;
+        dictionary_len = COMPRESS_WINDOW_B;
+    }
+
+    if (dictionary_len > 0) memcpy(compressor->window, dictionary, dictionary_len);
+    compressor->history = dictionary_len;
+    compressor->input = 0;
+    compressor->data = data;
+    compressor->size = size;
+    compressor->length = 0;
+    compressor->bits = 0;
+    compressor->bit_count = 0;
+    compressor->overflow = false;
+}
+
+
+/**
+ * @brief Add input. It's compressed as the window fills, so any amount
+ *        may be written, in as many calls as suit the caller.
+ *
+ * @param compressor: The compressor.
+ * @param data:       The input.
+ * @param length:     Its length in bytes.
+ */
+void compress_write(struct Compressor* compressor, const uint8_t* data, uint32_t length) {
+
+    while (length > 0) {
+        uint32_t room = 2 * COMPRESS_WINDOW_B - compressor->history - compressor->input;
+        uint32_t count = length < room ? length : room;
+        memcpy(&compressor->window[compressor->history + compressor->input], data, count);
+        compressor->input += count;
+        data += count;
+        length -= count;
+
+        if (compressor->history + compressor->input == 2 * COMPRESS_WINDOW_B) compress_block(compressor, false);
+    }
+}
+
+
+/**
+ * @brief Compress the rest of the input and complete the output.
+ *
+ * @param compressor: The compressor.
+ *
+ * @returns The length of the output, or 0 if it didn't fit.
+ */
+uint32_t compress_finish(struct Compressor* compressor) {
+
+    compress_block(compressor, true);
+    if (compressor->bit_count > 0) compress_bits(compressor, 0, 8 - compressor->bit_count);
+    return compressor->overflow ? 0 : compressor->length;
+}
+
+
+/**
+ * @brief Decompress a whole buffer.
+ *
+ * @param data:           The compressed input.
+ * @param length:         Its length in bytes.
+ * @param out:            The buffer for the output.
+ * @param size:           Its size in bytes.
+ * @param dictionary:     The dictionary the input was compressed with, or `NULL`.
+ * @param dictionary_len: Its length.
+ * @param out_len:        Receives the length of the output.
+ *
+ * @returns `true` if the input decompressed, `false` if it's malformed or
+ *          the output didn't fit.
+ */
+bool compress_expand(const uint8_t* data, uint32_t length, uint8_t* out, uint32_t size,
+                     const uint8_t* dictionary, uint32_t dictionary_len, uint32_t* out_len) {
+
+    uint32_t bits = 0;
+    uint32_t bit_count = 0;
+    uint32_t offset = 0;
+    uint32_t written = 0;
+
+    while (true) {
+        // Top up to at least a copy's worth of bits
+        while (bit_count <= 24 && offset < length) {
+            bits = (bits << 8) | data[offset++];
+            bit_count += 8;
+        }
+
+        // Fewer bits than the shortest token are padding
+        if (bit_count < 9) break;
+
+        if ((bits >> (bit_count - 1)) & 1) {
+            if (written == size) return false;
+            out[written++] = (uint8_t)(bits >> (bit_count - 9));
+            bit_count -= 9;
+            continue;
+        }
+
+        if (bit_count < 1 + COMPRESS_WINDOW_BITS + COMPRESS_LENGTH_BITS) return false;
+        bit_count -= 1 + COMPRESS_WINDOW_BITS + COMPRESS_LENGTH_BITS;
+        uint32_t token = bits >> bit_count;
+        uint32_t distance = ((token >> COMPRESS_LENGTH_BITS) & (COMPRESS_WINDOW_B - 1)) + 1;
+        uint32_t count = (token & (COMPRESS_MATCH_MAX_B - 1)) + 1;
+        if (distance > written + dictionary_len || size - written < count) return false;
+
+        // Copy a byte at a time: the source may run into the bytes being written
+        for (uint32_t i = 0 ; i < count ; ++i, ++written) {
+            out[written] = distance > written ? dictionary[dictionary_len + written - distance] : out[written - distance];
+        }
+    }
+
+    *out_len = written;
+    return true;
+}
+
+
+/**
+ * @brief Compress the input gathered in the window.
+ *
+ * Unless it's the final block, the last COMPRESS_MATCH_MAX_B bytes are
+ * left for the next, as a match starting there could run on into input
+ * not yet written. What has been compressed is then moved down, to be
+ * the next block's history.
+ *
+ * @param compressor: The compressor.
+ * @param final:      Is this the end of the input?
+ */
+static void compress_block(struct Compressor* compressor, bool final) {
+
+    uint8_t* window = compressor->window;
+    int16_t* chain = compressor->chain;
+    uint32_t end = compressor->history + compressor->input;
+    uint32_t limit = final ? end : end - COMPRESS_MATCH_MAX_B;
+
+    // Index the window: each position's last earlier position with the same byte
+    memset(compressor->last, 0xFF, sizeof(compressor->last));
+    for (uint32_t i = 0 ; i < end ; ++i) {
+        chain[i] = compressor->last[window[i]];
+        compressor->last[window[i]] = (int16_t)i;
+    }
+
+    uint32_t position = compressor->history;
+    while (position < limit) {
+        uint32_t most = end - position < COMPRESS_MATCH_MAX_B ? end - position : COMPRESS_MATCH_MAX_B;
+        uint32_t best_len = 1;
+        uint32_t best_distance = 0;
+
+        // A single byte is cheaper as a literal, so needs no search
+        int32_t candidate = most > 1 ? chain[position] : -1;
+        for (uint32_t tries = 0 ; candidate >= 0 && position - (uint32_t)candidate <= COMPRESS_WINDOW_B &&
+                                  tries < COMPRESS_CHAIN_MAX ; ++tries) {
+            // Only a candidate that beats the best so far is worth comparing in full
+            const uint8_t* match = &window[candidate];
+            if (match[best_len] == window[position + best_len]) {
+                uint32_t match_len = 1;
+                while (match_len < most && match[match_len] == window[position + match_len]) match_len++;
+                if (match_len > best_len) {
+                    best_len = match_len;
+                    best_distance = position - (uint32_t)candidate;
+                    if (best_len == most) break;
+                }
+            }
+
+            candidate = chain[candidate];
+        }
+
+        if (best_distance > 0) {
+            compress_bits(compressor, ((best_distance - 1) << COMPRESS_LENGTH_BITS) | (best_len - 1),
+                          1 + COMPRESS_WINDOW_BITS + COMPRESS_LENGTH_BITS);
+            position += best_len;
+        } else {
+            compress_bits(compressor, 0x100 | window[position], 9);
+            position++;
+        }
+    }
+
+    uint32_t start = position > COMPRESS_WINDOW_B ? position - COMPRESS_WINDOW_B : 0;
+    memmove(window, &window[start], end - start);
+    compressor->history = position - start;
+    compressor->input = end - position;
+}
+
+
+/**
+ * @brief Append bits to the output, most significant first.
+ */
+static void compress_bits(struct Compressor* compressor, uint32_t value, uint32_t count) {
+
+    compressor->bits = (compressor->bits << count) | value;
+    compressor->bit_count += count;
+    while (compressor->bit_count >= 8) {
+        compressor->bit_count -= 8;
+        if (compressor->length == compressor->size) {
+            compressor->overflow = true;
+        } else {
+            compressor->data[compressor->length++] = (uint8_t)(compressor->bits >> compressor->bit_count);
+        }
+    }
+}
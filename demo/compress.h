@@ -0,0 +1,70 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _COMPRESS_H_
+#define _COMPRESS_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     COMPRESS_WINDOW_BITS        9             // Copies reach back up to 2^9 bytes...
+#define     COMPRESS_LENGTH_BITS        5             // ...and are up to 2^5 bytes long
+#define     COMPRESS_WINDOW_B           (1 << COMPRESS_WINDOW_BITS)
+#define     COMPRESS_MATCH_MAX_B        (1 << COMPRESS_LENGTH_BITS)
+#define     COMPRESS_CHAIN_MAX          32            // Earlier matches tried per byte
+#define     COMPRESS_ENCODING           "x-heatshrink-9-5"
+
+// The most bytes `length` bytes of input can compress to: nine bits a byte, plus padding
+#define     COMPRESS_BOUND(length)      ((length) + (length) / 8 + 1)
+
+
+/*
+ * TYPES
+ */
+// A streaming compressor. Input is gathered in the second half of
+// `window`, behind the history it may refer back to, and compressed a
+// half at a time. `chain` links each position to the last one before
+// it with the same byte, to find matches without a search of the window
+struct Compressor {
+    uint8_t     window[2 * COMPRESS_WINDOW_B];
+    int16_t     chain[2 * COMPRESS_WINDOW_B];
+    int16_t     last[256];
+    uint32_t    history;            // Bytes already compressed, at the start of `window`
+    uint32_t    input;              // Bytes waiting to be, after them
+    uint8_t*    data;
+    uint32_t    size;
+    uint32_t    length;
+    uint32_t    bits;               // Output bits not yet a whole byte...
+    uint32_t    bit_count;          // ...and how many
+    bool        overflow;           // The output didn't fit: sticky
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        compress_init(struct Compressor* compressor, uint8_t* data, uint32_t size,
+                          const uint8_t* dictionary, uint32_t dictionary_len);
+void        compress_write(struct Compressor* compressor, const uint8_t* data, uint32_t length);
+uint32_t    compress_finish(struct Compressor* compressor);
+bool        compress_expand(const uint8_t* data, uint32_t length, uint8_t* out, uint32_t size,
+                            const uint8_t* dictionary, uint32_t dictionary_len, uint32_t* out_len);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _COMPRESS_H_
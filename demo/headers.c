@@ -0,0 +1,273 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#define     LOG_MODULE      LOG_MODULE_HTTP
+#include "main.h"
+
+
+/*
+ * NOTE Headers are read only when something asks for one, so a response
+ *      that's handled on its status code alone -- eg. a 304 -- costs no
+ *      header reads at all. When they are read, it's all at once: one
+ *      system call per header, each straight into the table's arena.
+ *
+ *      Names are hashed case-insensitively into an open-addressed table
+ *      that's never more than 3/4 full, so a lookup compares one or two
+ *      slots whatever the number of headers.
+ *
+ *      A real server sends some 20 headers, validators among the last,
+ *      after several hundred bytes of reporting headers. Lines over
+ *      HEADERS_LINE_MAX_B are skipped as they're read, without a slot or
+ *      arena space, so those that follow still fit.
+ */
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     headers_load(struct HeaderTable* table);
+static bool     headers_intern(struct HeaderTable* table, char* line, uint32_t length);
+static uint32_t headers_hash(const char* name, uint32_t length);
+static bool     headers_match(const char* stored, const char* name);
+
+
+/*
+ * GLOBALS
+ */
+static struct HeaderStats header_stats = { 0 };
+
+
+/**
+ * @brief Set up a table for a response's headers. None are read yet.
+ *
+ * @param table:       The table.
+ * @param channel:     The channel holding the response.
+ * @param num_headers: The number of headers in the response.
+ */
+void headers_init(struct HeaderTable* table, MvChannelHandle channel, uint32_t num_headers) {
+
+    table->channel = channel;
+    table->num_headers = num_headers;
+    table->loaded = false;
+    header_stats.responses++;
+}
+
+
+/**
+ * @brief Look up a response header.
+ *
+ * The first lookup reads the response's headers, so the channel must
+ * still hold the response, eg. during the request's callback.
+ *
+ * @param table: The table.
+ * @param name:  The header name, in any case.
+ *
+ * @returns The header's value, without surrounding whitespace, or `NULL`
+ *          if the response has no such header. Valid until the table is
+ *          set up for another response.
+ */
+const char* headers_get(struct HeaderTable* table, const char* name) {
+
+    if (!table->loaded) headers_load(table);
+    header_stats.lookups++;
+
+    uint32_t hash = headers_hash(name, strlen(name));
+    for (uint32_t index = hash & (HEADERS_SLOTS - 1) ; ; index = (index + 1) & (HEADERS_SLOTS - 1)) {
+        const struct HeaderSlot* slot = &table->slots[index];
+        header_stats.probes++;
+        if (slot->hash == 0) return NULL;
+        if (slot->hash == hash && headers_match(&table->arena[slot->name], name)) return &table->arena[slot->value];
+    }
+}
+
+
+/**
+ * @brief Look up a response header with an unsigned decimal value, eg. Content-Length.
+ *
+ * @param table: The table.
+ * @param name:  The header name, in any case.
+ * @param value: Receives the value.
+ *
+ * @returns `true` if the header is present and a number that fits in 32 bits,
+ *          otherwise `false`.
+ */
+bool headers_get_uint(struct HeaderTable* table, const char* name, uint32_t* value) {
+
+    const char* text = headers_get(table, name);
+    if (text == NULL || *text == 0) return false;
+
+    uint64_t number = 0;
+    for ( ; *text != 0 ; ++text) {
+        if (*text < '0' || *text > '9') return false;
+        number = number * 10 + (uint32_t)(*text - '0');
+        if (number > UINT32_MAX) return false;
+    }
+
+    *value = (uint32_t)number;
+    return true;
+}
+
+
+/**
+ * @brief Copy out the header tables' counters.
+ *
+ * @param stats: Pointer to the record to fill.
+ */
+void headers_get_stats(struct HeaderStats* stats) {
+
+    *stats = header_stats;
+}
+
+
+/**
+ * @brief Log the header tables' counters.
+ */
+void headers_report(void) {
+
+    server_log("Headers: %lu responses, %lu read (%lu lines, %lu skipped, %lu dropped), %lu lookups, %lu probes",
+               header_stats.responses, header_stats.loaded, header_stats.headers, header_stats.skipped, header_stats.dropped,
+               header_stats.lookups, header_stats.probes);
+}
+
+
+/**
+ * @brief Read a response's headers into its table.
+ *
+ * Lines over HEADERS_LINE_MAX_B are skipped. Headers that don't fit in
+ * the arena, or beyond HEADERS_MAX, are dropped.
+ *
+ * @param table: The table.
+ */
+static void headers_load(struct HeaderTable* table) {
+
+    table->loaded = true;
+    table->count = 0;
+    table->used = 0;
+    memset(table->slots, 0, sizeof(table->slots));
+
+    // A header line read into the arena isn't necessarily NUL-terminated:
+    // the zeroed space after it terminates it
+    memset(table->arena, 0, HEADERS_ARENA_B);
+    header_stats.loaded++;
+
+    for (uint32_t i = 0 ; i < table->num_headers ; ++i) {
+        char* line = &table->arena[table->used];
+        uint32_t space = HEADERS_ARENA_B - table->used;
+        if (table->count == HEADERS_MAX || space < 2) {
+            header_stats.dropped++;
+            continue;
+        }
+
+        // Read no more than the longest line kept: a longer one is refused
+        // as too big for the buffer, or fills it
+        uint32_t size = space - 1 < HEADERS_LINE_MAX_B + 1 ? space - 1 : HEADERS_LINE_MAX_B + 1;
+        enum MvStatus status = mvReadHttpResponseHeader(table->channel, i, (uint8_t*)line, size);
+        uint32_t length = status == MV_STATUS_OKAY ? (uint32_t)strnlen(line, size) : 0;
+        if ((status == MV_STATUS_INVALIDBUFFERSIZE && size > HEADERS_LINE_MAX_B) || length > HEADERS_LINE_MAX_B) {
+            memset(line, 0, size);
+            header_stats.skipped++;
+            continue;
+        }
+
+        if (status != MV_STATUS_OKAY) {
+            memset(line, 0, size);
+            header_stats.dropped++;
+            continue;
+        }
+
+        header_stats.headers++;
+        if (!headers_intern(table, line, length)) header_stats.dropped++;
+    }
+}
+
+
+/**
+ * @brief Rewrite a header line where it lies in the arena, and add it to the table.
+ *
+ * "Content-Type:  text/plain\r\n" becomes "content-type\0text/plain\0".
+ * A repeated header keeps its first value.
+ *
+ * @param table:  The table.
+ * @param line:   The line, at the end of the arena's used space.
+ * @param length: Its length.
+ *
+ * @returns `true` if the line is a header, otherwise `false`.
+ */
+static bool headers_intern(struct HeaderTable* table, char* line, uint32_t length) {
+
+    char* colon = (char*)memchr(line, ':', length);
+    if (colon == NULL || colon == line) {
+        memset(line, 0, length);
+        return false;
+    }
+
+    uint32_t name_len = (uint32_t)(colon - line);
+    for (uint32_t i = 0 ; i < name_len ; ++i) line[i] = (char)tolower((uint8_t)line[i]);
+    *colon = 0;
+
+    // Trim the value, then move it down to follow the name
+    char* value = colon + 1;
+    char* end = line + length;
+    while (value < end && (*value == ' ' || *value == '\t')) value++;
+    while (end > value && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) end--;
+
+    uint32_t value_len = (uint32_t)(end - value);
+    memmove(colon + 1, value, value_len);
+    uint32_t record = name_len + 1 + value_len + 1;
+    memset(&line[record - 1], 0, length + 1 - record);
+
+    uint32_t hash = headers_hash(line, name_len);
+    uint32_t index = hash & (HEADERS_SLOTS - 1);
+    while (table->slots[index].hash != 0) {
+        const struct HeaderSlot* slot = &table->slots[index];
+        if (slot->hash == hash && strcmp(&table->arena[slot->name], line) == 0) {
+            memset(line, 0, record);
+            return true;
+        }
+
+        index = (index + 1) & (HEADERS_SLOTS - 1);
+    }
+
+    struct HeaderSlot* slot = &table->slots[index];
+    slot->hash = hash;
+    slot->name = (uint16_t)(line - table->arena);
+    slot->value = (uint16_t)(slot->name + name_len + 1);
+    table->used += record;
+    table->count++;
+    return true;
+}
+
+
+/**
+ * @brief Hash a header name, case-insensitively: FNV-1a of its lower-case form.
+ *
+ * @param name:   The name.
+ * @param length: Its length.
+ *
+ * @returns The hash, which is never 0.
+ */
+static uint32_t headers_hash(const char* name, uint32_t length) {
+
+    uint32_t hash = 2166136261UL;
+    for (uint32_t i = 0 ; i < length ; ++i) hash = (hash ^ (uint8_t)tolower((uint8_t)name[i])) * 16777619UL;
+    return hash != 0 ? hash : 1;
+}
+
+
+/**
+ * @brief Compare a stored, lower-case header name with one in any case.
+ */
+static bool headers_match(const char* stored, const char* name) {
+
+    while (*stored != 0 && *stored == tolower((uint8_t)*name)) {
+        stored++;
+        name++;
+    }
+
+    return *stored == 0 && *name == 0;
+}
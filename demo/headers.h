@@ -0,0 +1,79 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _HEADERS_H_
+#define _HEADERS_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     HEADERS_SLOTS               32            // Must be a power of two
+#define     HEADERS_MAX                 24            // Keeps the table no more than 3/4 full
+#define     HEADERS_ARENA_B             1024
+
+// Longer lines are skipped, and take no space: they are reporting and
+// policy headers, eg. Report-To and NEL, which the app doesn't read
+#define     HEADERS_LINE_MAX_B          128
+
+
+/*
+ * TYPES
+ */
+// One header: its name's hash, and where its name and value sit in the arena
+struct HeaderSlot {
+    uint32_t    hash;               // 0 if the slot is free
+    uint16_t    name;
+    uint16_t    value;
+};
+
+// A response's headers, read on the first lookup. Each header line is
+// read straight into the arena, then rewritten where it lies as its
+// lower-case name and trimmed value, NUL-terminated
+struct HeaderTable {
+    MvChannelHandle     channel;
+    uint32_t            num_headers;        // In the response
+    bool                loaded;
+    uint32_t            count;              // In the table
+    uint32_t            used;               // Arena bytes
+    struct HeaderSlot   slots[HEADERS_SLOTS];
+    char                arena[HEADERS_ARENA_B];
+};
+
+struct HeaderStats {
+    uint32_t    responses;
+    uint32_t    loaded;             // Responses whose headers were read
+    uint32_t    headers;            // Header lines read
+    uint32_t    dropped;            // Lines that didn't fit, or were malformed
+    uint32_t    skipped;            // Lines over HEADERS_LINE_MAX_B
+    uint32_t    lookups;
+    uint32_t    probes;             // Slots compared by lookups
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void            headers_init(struct HeaderTable* table, MvChannelHandle channel, uint32_t num_headers);
+const char*     headers_get(struct HeaderTable* table, const char* name);
+bool            headers_get_uint(struct HeaderTable* table, const char* name, uint32_t* value);
+void            headers_get_stats(struct HeaderStats* stats);
+void            headers_report(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _HEADERS_H_
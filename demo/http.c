@@ -6,9 +6,60 @@
  * Licence: MIT
  *
  */
+#define     LOG_MODULE      LOG_MODULE_HTTP
 #include "main.h"
 
 
+/*
+ * STATIC PROTOTYPES
+ */
+static bool     http_open_channel(uint32_t slot);
+static void     http_close_channel(uint32_t slot);
+static void     http_pump_queue(void);
+static struct HttpQueueEntry* http_queue_free(void);
+static void     http_queue_release(const struct HttpQueueEntry* entry);
+static uint8_t* http_request_reserve(struct HttpQueueEntry* request, uint32_t length, uint32_t wire_len);
+static bool     http_request_queue(struct HttpQueueEntry* request, http_callback callback, void* context,
+                                   bool durable, bool replayed);
+static bool     http_request_unpack(struct HttpQueueEntry* request, uint32_t length);
+static bool     http_issue(uint32_t slot, const struct HttpQueueEntry* request, bool fresh_channel);
+static void     http_complete(uint32_t slot);
+static void     http_fail(uint32_t slot, enum MvStatus status);
+static void     http_release(uint32_t slot);
+static void     http_check_timeouts(void);
+static void     http_check_idle(void);
+static uint64_t http_now(void);
+static void     http_process_notification(const struct MvNotification* notification);
+static void     http_read_validator(struct HeaderTable* headers, struct CacheValidator* validator);
+static void     http_hold(struct HeaderTable* headers);
+static void     http_resume(void);
+static void     http_record_latency(struct HttpLatency* latency, uint64_t elapsed_us);
+static bool     http_spool(const struct HttpQueueEntry* entry);
+static void     http_spool_queue(void);
+static void     http_replay(void);
+static void     http_replay_done(void);
+
+
+/*
+ * TYPES
+ */
+// A channel that carries one request at a time. Microvisor HTTP channels
+// can't pipeline, so requests are in flight together on separate channels
+struct HttpSlot {
+    MvChannelHandle     channel;
+    bool                in_flight;
+    bool                fresh_channel;      // The request had to open the channel
+    uint64_t            start_tick;
+    uint64_t            idle_since;
+    const struct HttpQueueEntry* request;   // Its queue entry, taken until it's done
+    uint32_t            url_hash;           // The request's cache key, or 0
+    // Set by the ISR
+    volatile bool       readable;
+    volatile bool       closed;
+    volatile uint64_t   response_tick;
+};
+
+
 /*
  * GLOBALS
  */
@@ -17,48 +68,101 @@
 static struct {
     MvNotificationHandle notification;
     MvNetworkHandle      network;
-    MvChannelHandle      channel;
-} http_handles = { 0, 0, 0 };
+} http_handles = { 0, 0 };
 
 // Central store for HTTP request management notification records.
 // Holds HTTP_NT_BUFFER_SIZE_R records at a time -- each record is 16 bytes in size.
 static struct MvNotification http_notification_center[HTTP_NT_BUFFER_SIZE_R] __attribute__((aligned(8)));
-static volatile uint32_t current_notification_index = 0;
+static struct NcRing http_notification_ring;
+
+// The channels' multi-use send and receive buffers
+static uint8_t http_rx_buffers[HTTP_MAX_IN_FLIGHT][HTTP_RX_BUFFER_SIZE_B] __attribute__((aligned(512)));
+static uint8_t http_tx_buffers[HTTP_MAX_IN_FLIGHT][HTTP_TX_BUFFER_SIZE_B] __attribute__((aligned(512)));
+
+static struct HttpSlot http_slots[HTTP_MAX_IN_FLIGHT];
+
+// Requests are built, queued and sent in place in these entries. An entry
+// is taken from when it's queued until its request is done, and `order`
+// lists those awaiting a free channel, oldest first. Only touched
+// from the main loop, so it needs no locking
+static struct {
+    struct HttpQueueEntry   entries[HTTP_QUEUE_DEPTH];
+    uint8_t                 order[HTTP_QUEUE_DEPTH];
+    uint32_t                head;
+    uint32_t                count;
+    uint32_t                taken;      // A bit per entry
+} http_queue;
+
+static struct HttpQueueStats http_queue_stats = { 0 };
+
+// The network state `http_service()` last saw
+static bool http_online = false;
 
-// Defined in `main.c`
-extern volatile bool received_request;
-extern volatile bool channel_was_closed;
+// Store-and-forward. Stored requests are replayed to the stock request's
+// callback, as a function pointer doesn't outlive a reset, a batch at a time.
+// Each batch is committed -- removed from flash -- once all its requests are done
+static http_callback http_spool_callback = NULL;
+static uint32_t http_replay_outstanding = 0;
+static bool http_replay_uncommitted = false;
+
+// Response bodies are read through this block a chunk at a time.
+// Only used from the main loop
+static uint8_t http_body_chunk[HTTP_BODY_CHUNK_SIZE_B];
+
+// The headers of the response being handled. Only one is at a time
+static struct HeaderTable http_headers;
+
+// Request bodies are compressed through these. Only used from the main loop
+static struct Compressor http_compressor;
+static uint8_t http_packed[HTTP_TX_BUFFER_SIZE_B];
+
+// Requests are held back until this tick when the server asks us to wait
+static uint64_t http_hold_until = 0;
+static SchedJobId http_resume_job = SCHED_JOB_NONE;
+
+// Housekeeping jobs, scheduled only while there's something to check
+static SchedJobId http_timeout_job = SCHED_JOB_NONE;
+static SchedJobId http_idle_job = SCHED_JOB_NONE;
+
+// Request-to-response times, split by whether the channel was reused
+static struct {
+    struct HttpLatency  fresh;
+    struct HttpLatency  reused;
+} http_latency;
+
+// Throughput reporting window
+static uint64_t http_report_tick = 0;
+static uint32_t http_report_completed = 0;
 
 
 /**
  * @brief Open a new HTTP channel.
  *
+ * @param slot: The slot the channel will serve.
+ *
  * @returns `true` if the channel is open, otherwise `false`.
  */
-bool http_open_channel(void) {
-
-    // Set up the HTTP channel's multi-use send and receive buffers
-    static uint8_t http_rx_buffer[HTTP_RX_BUFFER_SIZE_B] __attribute__((aligned(512)));
-    static uint8_t http_tx_buffer[HTTP_TX_BUFFER_SIZE_B] __attribute__((aligned(512)));
+static bool http_open_channel(uint32_t slot) {
 
     // Get the network channel handle.
-    // NOTE This is set in `logging.c` which puts the network in place
-    //      (ie. so the network handle != 0) well in advance of this being called
+    // NOTE This is set in `network.c`, and requests are only sent
+    //      once it reports the network is connected
     http_handles.network = net_get_handle();
     if (http_handles.network == 0) return false;
     server_log("Network handle: %lu", (uint32_t)http_handles.network);
 
-    // Configure the required data channel
+    // Configure the required data channel. The tag identifies the slot
+    // in the channel's notifications
     const struct MvOpenChannelParams channel_config = {
         .version = 1,
         .v1 = {
             .notification_handle = http_handles.notification,
-            .notification_tag    = USER_TAG_HTTP_OPEN_CHANNEL,
+            .notification_tag    = HTTP_SLOT_TAG(slot),
             .network_handle      = http_handles.network,
-            .receive_buffer      = http_rx_buffer,
-            .receive_buffer_len  = sizeof(http_rx_buffer),
-            .send_buffer         = http_tx_buffer,
-            .send_buffer_len     = sizeof(http_tx_buffer),
+            .receive_buffer      = http_rx_buffers[slot],
+            .receive_buffer_len  = HTTP_RX_BUFFER_SIZE_B,
+            .send_buffer         = http_tx_buffers[slot],
+            .send_buffer_len     = HTTP_TX_BUFFER_SIZE_B,
             .channel_type        = MV_CHANNELTYPE_HTTP,
             .endpoint            = {
                 .data = (uint8_t*)"",
@@ -69,9 +173,12 @@ bool http_open_channel(void) {
 
     // Ask Microvisor to open the channel
     // and confirm that it has accepted the request
-    enum MvStatus status = mvOpenChannel(&channel_config, &http_handles.channel);
+    struct HttpSlot* entry = &http_slots[slot];
+    enum MvStatus status = mvOpenChannel(&channel_config, &entry->channel);
     if (status == MV_STATUS_OKAY) {
-        server_log("HTTP channel handle: %lu", (uint32_t)http_handles.channel);
+        entry->readable = false;
+        entry->closed = false;
+        server_log("HTTP channel handle: %lu", (uint32_t)entry->channel);
         return true;
     }
 
@@ -81,33 +188,27 @@ bool http_open_channel(void) {
 
 
 /**
- * @brief Close the currently open HTTP channel.
+ * @brief Close a slot's HTTP channel.
+ *
+ * @param slot: The slot.
  */
-void http_close_channel(void) {
+static void http_close_channel(uint32_t slot) {
+
+    struct HttpSlot* entry = &http_slots[slot];
 
     // If we have a valid channel handle -- ie. it is non-zero --
     // then ask Microvisor to close it and confirm acceptance of
     // the closure request.
-    if (http_handles.channel != 0) {
-        MvChannelHandle old = http_handles.channel;
-        enum MvStatus status = mvCloseChannel(&http_handles.channel);
+    if (entry->channel != 0) {
+        MvChannelHandle old = entry->channel;
+        enum MvStatus status = mvCloseChannel(&entry->channel);
         do_assert((status == MV_STATUS_OKAY || status == MV_STATUS_CHANNELCLOSED), "Channel closure");
         server_log("HTTP channel %lu closed (status code: %i)", (uint32_t)old, status);
     }
 
     // Confirm the channel handle has been invalidated by Microvisor
-    do_assert(http_handles.channel == 0, "Channel handle not zero");
-}
-
-
-/**
- * @brief Provide the current channel handle.
- *
- * @returns The channel handle.
- */
-MvChannelHandle http_get_handle(void) {
-
-    return http_handles.channel;
+    do_assert(entry->channel == 0, "Channel handle not zero");
+    entry->in_flight = false;
 }
 
 
@@ -116,8 +217,8 @@ MvChannelHandle http_get_handle(void) {
  */
 void http_setup_notification_center(void) {
 
-    // Clear the notification store
-    memset((void *)http_notification_center, 0x00, sizeof(http_notification_center));
+    // Clear the notification store and attach the consumer ring to it
+    nc_ring_init(&http_notification_ring, http_notification_center, sizeof(http_notification_center));
 
     // Configure a notification center for network-centric notifications
     const struct MvNotificationSetup http_notification_setup = {
@@ -139,95 +240,1081 @@ void http_setup_notification_center(void) {
 
 
 /**
- * @brief Send a stock HTTP request.
+ * @brief Start building a request, in place at the back of the queue.
+ *
+ * Add the URL, then any headers, then any body, and queue the request
+ * with `http_request_send()`. Parts that would take the request beyond
+ * the channel's send buffer are refused up front, and the whole request
+ * with them when it's sent. Only one request may be built at a time.
+ *
+ * @param method: The HTTP method, eg. `HTTP_LITERAL("GET")`.
+ * @param length: Its length.
  *
- * @returns `true` if the request was accepted by Microvisor, otherwise `false`
+ * @returns The request, or `NULL` if the queue is full.
  */
-enum MvStatus http_send_request(bool do_reset) {
+struct HttpQueueEntry* http_request_new(const uint8_t* method, uint32_t length) {
 
-    static uint32_t item_number = 1;
+    struct HttpQueueEntry* request = http_queue_free();
+    if (request == NULL) {
+        http_queue_stats.rejected++;
+        return NULL;
+    }
+
+    request->used = 0;
+    request->wire_len = HTTP_REQUEST_LINE_OVERHEAD_B;
+    request->overflow = false;
+    request->num_headers = 0;
+    request->body.offset = 0;
+    request->body.length = 0;
+
+    // The method and an empty URL, each NUL-terminated
+    uint8_t* text = http_request_reserve(request, length + 2, length);
+    if (text == NULL) return request;
+    memcpy(text, method, length);
+    text[length] = 0;
+    text[length + 1] = 0;
+    request->method.offset = 0;
+    request->method.length = (uint16_t)length;
+    request->url.offset = (uint16_t)(length + 1);
+    request->url.length = 0;
+    return request;
+}
+
+
+/**
+ * @brief Add to a request's URL.
+ *
+ * Call as often as needed, before any headers or body are added.
+ *
+ * @param request: The request.
+ * @param text:    The text to add, eg. `HTTP_LITERAL("https://")`.
+ * @param length:  Its length.
+ */
+void http_request_url(struct HttpQueueEntry* request, const uint8_t* text, uint32_t length) {
+
+    // The URL must still be last, so it can be extended over its NUL
+    if (request->num_headers > 0 || request->body.offset != 0) request->overflow = true;
+    uint8_t* space = http_request_reserve(request, length, length);
+    if (space == NULL || length == 0) return;
+
+    memcpy(space - 1, text, length);
+    space[length - 1] = 0;
+    request->url.length += (uint16_t)length;
+}
+
+
+/**
+ * @brief Add a number, in decimal, to a request's URL.
+ *
+ * @param request: The request.
+ * @param value:   The number.
+ */
+void http_request_url_uint(struct HttpQueueEntry* request, uint32_t value) {
+
+    uint8_t digits[10];
+    uint32_t count = 0;
+    do {
+        digits[sizeof(digits) - ++count] = (uint8_t)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    http_request_url(request, &digits[sizeof(digits) - count], count);
+}
+
+
+/**
+ * @brief Add a header to a request, after its URL and before its body.
+ *
+ * @param request:   The request.
+ * @param key:       The header name.
+ * @param key_len:   Its length.
+ * @param value:     The header value.
+ * @param value_len: Its length.
+ */
+void http_request_header(struct HttpQueueEntry* request, const uint8_t* key, uint32_t key_len,
+                         const uint8_t* value, uint32_t value_len) {
+
+    if (request->num_headers == HTTP_MAX_HEADERS || request->body.offset != 0) request->overflow = true;
+    uint8_t* space = http_request_reserve(request, key_len + value_len, key_len + value_len + HTTP_HEADER_OVERHEAD_B);
+    if (space == NULL) return;
+
+    uint32_t index = request->num_headers++;
+    request->keys[index].offset = (uint16_t)(space - request->data);
+    request->keys[index].length = (uint16_t)key_len;
+    request->values[index].offset = (uint16_t)(request->keys[index].offset + key_len);
+    request->values[index].length = (uint16_t)value_len;
+    memcpy(space, key, key_len);
+    memcpy(space + key_len, value, value_len);
+}
+
+
+/**
+ * @brief Make room for a request's body, last of all.
+ *
+ * @param request: The request.
+ * @param length:  The size of the body in bytes.
+ *
+ * @returns Where to write the body, or `NULL` if it won't fit.
+ */
+uint8_t* http_request_body(struct HttpQueueEntry* request, uint32_t length) {
+
+    if (request->body.offset != 0) request->overflow = true;
+    uint8_t* space = http_request_reserve(request, length, length);
+    if (space == NULL) return NULL;
+
+    request->body.offset = (uint16_t)(space - request->data);
+    request->body.length = (uint16_t)length;
+    return space;
+}
+
+
+/**
+ * @brief Compress a request's body, if that makes the request smaller.
+ *
+ * Call once the body is written, before `http_request_send()`. The body
+ * is replaced by its compressed form, and a `Content-Encoding` header of
+ * COMPRESS_ENCODING added, so the server must know how to expand it. A
+ * body that wouldn't shrink by more than the header costs is left as it is.
+ *
+ * @param request: The request.
+ *
+ * @returns `true` if the body was compressed, otherwise `false`.
+ */
+bool http_request_compress(struct HttpQueueEntry* request) {
+
+    uint32_t length = request->body.length;
+    if (request->overflow || length == 0 || request->num_headers == HTTP_MAX_HEADERS) return false;
+
+    compress_init(&http_compressor, http_packed, sizeof(http_packed), NULL, 0);
+    compress_write(&http_compressor, &request->data[request->body.offset], length);
+    uint32_t packed = compress_finish(&http_compressor);
+    uint32_t header_len = sizeof("Content-Encoding") - 1 + sizeof(COMPRESS_ENCODING) - 1 + HTTP_HEADER_OVERHEAD_B;
+    if (packed == 0 || packed + header_len >= length) return false;
+
+    // Take the body back off the request, add the header, then put the
+    // compressed body where the body was
+    request->used = request->body.offset;
+    request->wire_len -= length;
+    request->body.offset = 0;
+    request->body.length = 0;
+    http_request_header(request, HTTP_LITERAL("Content-Encoding"), HTTP_LITERAL(COMPRESS_ENCODING));
+    uint8_t* body = http_request_body(request, packed);
+    if (body == NULL) return false;
+
+    memcpy(body, http_packed, packed);
+    http_queue_stats.compressed++;
+    http_queue_stats.compress_saved_b += length - packed - header_len;
+    return true;
+}
+
+
+/**
+ * @brief Queue a request built with `http_request_new()`.
+ *
+ * @param request:  The request.
+ * @param callback: Called once, with the response or the failure.
+ * @param context:  Passed to `callback`.
+ *
+ * @returns `true` if the request was queued, `false` if any part of it
+ *          didn't fit.
+ */
+bool http_request_send(struct HttpQueueEntry* request, http_callback callback, void* context) {
+
+    return http_request_queue(request, callback, context, false, false);
+}
+
+
+/**
+ * @brief Queue an HTTP request from its parts.
+ *
+ * Every part is copied, so none need outlive the call.
+ *
+ * @param method:      The HTTP method, eg. "GET".
+ * @param url:         The full request URL.
+ * @param headers:     Request headers, or `NULL`.
+ * @param num_headers: The number of headers.
+ * @param body:        The request body, or `NULL`.
+ * @param body_len:    The size of the body in bytes.
+ * @param callback:    Called once, with the response or the failure.
+ * @param context:     Passed to `callback`.
+ *
+ * @returns `true` if the request was queued, otherwise `false`.
+ */
+bool http_enqueue(const char* method, const char* url,
+                  const struct MvHttpHeader* headers, uint32_t num_headers,
+                  const uint8_t* body, uint32_t body_len,
+                  http_callback callback, void* context) {
+
+    struct HttpQueueEntry* request = http_request_new((const uint8_t*)method, strlen(method));
+    if (request == NULL) return false;
+
+    http_request_url(request, (const uint8_t*)url, strlen(url));
+    for (uint32_t i = 0 ; i < num_headers ; ++i) {
+        http_request_header(request, headers[i].key.data, headers[i].key.length, headers[i].value.data, headers[i].value.length);
+    }
+
+    if (body_len > 0) {
+        uint8_t* space = http_request_body(request, body_len);
+        if (space != NULL) memcpy(space, body, body_len);
+    }
+
+    return http_request_send(request, callback, context);
+}
+
+
+/**
+ * @brief Get a queue entry that's neither queued nor in flight.
+ *
+ * @returns The entry, or `NULL` if the queue is full.
+ */
+static struct HttpQueueEntry* http_queue_free(void) {
+
+    for (uint32_t i = 0 ; i < HTTP_QUEUE_DEPTH ; ++i) {
+        if ((http_queue.taken & (1UL << i)) == 0) return &http_queue.entries[i];
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief Free a queue entry once its request is done.
+ *
+ * @param entry: The entry.
+ */
+static void http_queue_release(const struct HttpQueueEntry* entry) {
+
+    http_queue.taken &= ~(1UL << (uint32_t)(entry - http_queue.entries));
+}
 
-    // Make sure we have a valid channel handle
-    if (http_handles.channel == 0) {
-        // There's no open channel, so open
-        // one now and try to send again
-        http_open_channel();
-        return http_send_request(false);
+
+/**
+ * @brief Take space at the end of a request's data.
+ *
+ * @param request:  The request.
+ * @param length:   The bytes of data needed.
+ * @param wire_len: The bytes of send buffer they'll take.
+ *
+ * @returns The space, or `NULL` if the request is full or in error.
+ */
+static uint8_t* http_request_reserve(struct HttpQueueEntry* request, uint32_t length, uint32_t wire_len) {
+
+    if (request->overflow || request->used + length > sizeof(request->data) ||
+        request->wire_len + wire_len > HTTP_TX_BUFFER_SIZE_B) {
+        request->overflow = true;
+        return NULL;
     }
 
+    uint8_t* space = &request->data[request->used];
+    request->used += length;
+    request->wire_len += wire_len;
+    return space;
+}
+
+
+/**
+ * @brief Queue a built request, with its store-and-forward flags.
+ *
+ * @param durable:  Store the request in flash if the network fails it.
+ *                  Its headers are not stored, so it must have none.
+ * @param replayed: The request was read back from flash.
+ */
+static bool http_request_queue(struct HttpQueueEntry* request, http_callback callback, void* context,
+                               bool durable, bool replayed) {
+
+    if (request->overflow) {
+        server_error("HTTP request too large for the send buffer");
+        http_queue_stats.rejected++;
+        return false;
+    }
+
+    request->callback = callback;
+    request->context  = context;
+    request->durable  = durable;
+    request->replayed = replayed;
+
+    uint32_t index = (uint32_t)(request - http_queue.entries);
+    http_queue.taken |= 1UL << index;
+    http_queue.order[(http_queue.head + http_queue.count) % HTTP_QUEUE_DEPTH] = (uint8_t)index;
+    http_queue.count++;
+    http_queue_stats.enqueued++;
+    if (http_queue.count > http_queue_stats.high_water) http_queue_stats.high_water = http_queue.count;
+    return true;
+}
+
+
+/**
+ * @brief Queue the stock HTTP request.
+ *
+ * While the network is down, or earlier requests wait in flash, the
+ * request is stored in flash too, to be sent in order once it's up.
+ *
+ * @param do_reset: `true` to start again from the first item.
+ * @param callback: Called with the response. Also receives replayed requests.
+ *
+ * @returns `true` if the request was queued or stored, otherwise `false`.
+ */
+bool http_send_request(bool do_reset, http_callback callback) {
+
+    static uint32_t item_number = 1;
+    PROFILE_SCOPE("http_send_request");
+
     server_log("Preparing HTTP request");
 
     if (do_reset) item_number = 1;
+    http_spool_callback = callback;
 
     // Set up the request
-    const char verb[] = "GET";
-    const char body[] = "";
-    char url[64] = "";
-    snprintf(url, 64, "https://jsonplaceholder.typicode.com/todos/%lu", item_number++);
-    const struct MvHttpHeader hdrs[] = {};
+    struct HttpQueueEntry* request = http_request_new(HTTP_LITERAL("GET"));
+    if (request == NULL) return false;
+    http_request_url(request, HTTP_LITERAL("https://jsonplaceholder.typicode.com/todos/"));
+    http_request_url_uint(request, item_number++);
+
+    if (!net_is_connected() || spool_pending() > 0 || http_replay_outstanding > 0) {
+        if (!request->overflow && http_spool(request)) return true;
+    }
+
+    return http_request_queue(request, callback, NULL, true, false);
+}
+
+
+/**
+ * @brief Run the request engine from the main loop.
+ *
+ * Hands responses and channel closures flagged by the ISR to their
+ * requests' callbacks, then sends queued requests on free channels.
+ */
+void http_service(void) {
+
+    for (uint32_t slot = 0 ; slot < HTTP_MAX_IN_FLIGHT ; ++slot) {
+        struct HttpSlot* entry = &http_slots[slot];
+
+        if (entry->readable) {
+            entry->readable = false;
+            http_complete(slot);
+        }
+
+        if (entry->closed) {
+            entry->closed = false;
+            enum MvClosureReason reason = 0;
+            if (mvGetChannelClosureReason(entry->channel, &reason) == MV_STATUS_OKAY) {
+                server_error("Channel closed for reason: %lu", (uint32_t)reason);
+            } else {
+                server_error("channel closed for unknown reason");
+            }
+
+            http_fail(slot, MV_STATUS_CHANNELCLOSED);
+            http_close_channel(slot);
+        }
+    }
+
+    // Follow the network: drop idle channels when it goes, as they
+    // won't survive, and send what queued up when it returns
+    if (net_is_connected() != http_online) {
+        http_online = !http_online;
+        if (http_online) {
+            if (http_queue.count > 0) server_log("Network up: sending %lu queued requests", http_queue.count);
+        } else {
+            server_log("Network down: pausing requests");
+            for (uint32_t slot = 0 ; slot < HTTP_MAX_IN_FLIGHT ; ++slot) {
+                if (!http_slots[slot].in_flight) http_close_channel(slot);
+            }
+
+            http_spool_queue();
+        }
+    }
+
+    if (http_online) http_replay();
+    http_pump_queue();
+}
+
+
+/**
+ * @brief Stream a response body to a consumer.
+ *
+ * The body is read in HTTP_BODY_CHUNK_SIZE_B chunks at successive
+ * offsets, so memory use does not depend on the body's length.
+ * Call from a request's callback.
+ *
+ * @param response: The response passed to the callback.
+ * @param consumer: Called with each chunk.
+ * @param context:  Passed to `consumer`.
+ *
+ * @returns The status of the failed read, or MV_STATUS_OKAY.
+ */
+enum MvStatus http_read_body(const struct HttpResponse* response, http_body_consumer consumer, void* context) {
+
+    uint32_t offset = 0;
+    while (offset < response->data.body_length) {
+        uint32_t remaining = response->data.body_length - offset;
+        uint32_t length = remaining < HTTP_BODY_CHUNK_SIZE_B ? remaining : HTTP_BODY_CHUNK_SIZE_B;
+        enum MvStatus status = mvReadHttpResponseBody(response->channel, offset, http_body_chunk, length);
+        if (status != MV_STATUS_OKAY) return status;
+
+        if (!consumer(http_body_chunk, length, offset, context)) break;
+        offset += length;
+    }
+
+    return MV_STATUS_OKAY;
+}
+
+
+/**
+ * @brief Cache what a request's callback made of a 200 response, for
+ *        conditional requests of the same URL to come.
+ *
+ * Call from the callback. A later 304 for the URL will carry a pointer
+ * to a copy of `value`, so the callback needn't read or parse the body.
+ *
+ * @param response: The response passed to the callback.
+ * @param value:    The value to cache, eg. the parsed body.
+ * @param length:   Its size in bytes, up to CACHE_VALUE_MAX_LEN_B.
+ *
+ * @returns `true` if the value was cached, `false` if the response
+ *          can't be cached or had no validator.
+ */
+bool http_cache_put(const struct HttpResponse* response, const void* value, uint32_t length) {
+
+    if (response->url_hash == 0 || response->data.status_code != 200) return false;
+    return cache_store(response->url_hash, &response->validator, response->data.body_length, value, length);
+}
+
+
+/**
+ * @brief Check for work the request engine must do before the main loop sleeps.
+ *
+ * @returns `true` if a response or closure awaits, or a queued or stored
+ *          request could be sent, otherwise `false`.
+ */
+bool http_has_work(void) {
+
+    bool slot_free = false;
+    for (uint32_t slot = 0 ; slot < HTTP_MAX_IN_FLIGHT ; ++slot) {
+        const struct HttpSlot* entry = &http_slots[slot];
+        if (entry->readable || entry->closed) return true;
+        if (!entry->in_flight) slot_free = true;
+    }
+
+    if (!net_is_connected()) return false;
+    if (http_resume_job != SCHED_JOB_NONE) return false;
+    if (spool_pending() > 0 && http_replay_outstanding == 0 && http_spool_callback != NULL && http_queue_free() != NULL) return true;
+    return slot_free && http_queue.count > 0;
+}
+
+
+/**
+ * @brief Copy out the request queue's counters.
+ *
+ * @param stats: Pointer to the record to fill.
+ */
+void http_get_queue_stats(struct HttpQueueStats* stats) {
+
+    *stats = http_queue_stats;
+    stats->depth = http_queue.count;
+}
+
+
+/**
+ * @brief Send queued requests until the queue is empty or no channel is free.
+ *
+ * Free slots with a channel already open are used first. Requests
+ * stay queued while the network is down, or the server has asked us to wait.
+ */
+static void http_pump_queue(void) {
+
+    if (!net_is_connected() || http_resume_job != SCHED_JOB_NONE) return;
+
+    while (http_queue.count > 0) {
+        int32_t slot = -1;
+        for (uint32_t i = 0 ; i < HTTP_MAX_IN_FLIGHT ; ++i) {
+            if (http_slots[i].in_flight) continue;
+            if (slot == -1 || (http_slots[i].channel != 0 && http_slots[slot].channel == 0)) slot = i;
+        }
+
+        if (slot == -1) return;
+
+        // Open the channel before taking the request off the queue, so if
+        // the network has failed the request waits for it to come back
+        bool fresh_channel = false;
+        if (http_slots[slot].channel == 0) {
+            if (!http_open_channel(slot)) {
+                net_report_failure();
+                return;
+            }
+
+            fresh_channel = true;
+        }
+
+        const struct HttpQueueEntry* entry = &http_queue.entries[http_queue.order[http_queue.head]];
+        http_queue.head = (http_queue.head + 1) % HTTP_QUEUE_DEPTH;
+        http_queue.count--;
+        http_issue(slot, entry, fresh_channel);
+    }
+}
+
+
+/**
+ * @brief Send a request on a slot.
+ *
+ * With HTTP_REUSE_CHANNEL set, an open channel is kept for the next
+ * request, otherwise a new channel is opened for every request.
+ * On failure the request's callback is called straight away.
+ *
+ * @param slot:          The slot, with its channel open.
+ * @param request:       The queued request, which stays in its entry until it's done.
+ * @param fresh_channel: Was the channel opened for this request?
+ *
+ * @returns `true` if the request was accepted by Microvisor, otherwise `false`.
+ */
+static bool http_issue(uint32_t slot, const struct HttpQueueEntry* request, bool fresh_channel) {
+
+    struct HttpSlot* state = &http_slots[slot];
+    state->request = request;
+    state->start_tick = http_now();
+    state->fresh_channel = fresh_channel;
+    state->in_flight = true;
+
+    // Point Microvisor at the parts of the request
+    struct MvHttpHeader headers[HTTP_MAX_HEADERS];
+    uint32_t num_headers = request->num_headers;
+    for (uint32_t i = 0 ; i < num_headers ; ++i) {
+        headers[i].key.data = &request->data[request->keys[i].offset];
+        headers[i].key.length = request->keys[i].length;
+        headers[i].value.data = &request->data[request->values[i].offset];
+        headers[i].value.length = request->values[i].length;
+    }
+
+    // Make a GET of a cached URL conditional, so an unchanged resource
+    // comes back as a 304 with no body, if the header fits
+    const char* url = (const char*)&request->data[request->url.offset];
+    state->url_hash = 0;
+    if (num_headers == 0 && request->method.length == 3 && memcmp(request->data, "GET", 3) == 0) {
+        state->url_hash = cache_hash(url);
+        const struct CacheValidator* validator = cache_validator(state->url_hash);
+        if (validator != NULL) {
+            const char* key = validator->type == CACHE_VALIDATOR_ETAG ? "If-None-Match" : "If-Modified-Since";
+            headers[0].key.data = (const uint8_t *)key;
+            headers[0].key.length = strlen(key);
+            headers[0].value.data = (const uint8_t *)validator->value;
+            headers[0].value.length = strlen(validator->value);
+            if (request->wire_len + headers[0].key.length + headers[0].value.length + HTTP_HEADER_OVERHEAD_B <= HTTP_TX_BUFFER_SIZE_B) {
+                num_headers = 1;
+            }
+        }
+    }
+
     const struct MvHttpRequest request_config = {
         .method = {
-            .data = (const uint8_t *)verb,
-            .length = strlen(verb)
+            .data = &request->data[request->method.offset],
+            .length = request->method.length
         },
         .url = {
-            .data = (const uint8_t *)url,
-            .length = strlen(url)
+            .data = &request->data[request->url.offset],
+            .length = request->url.length
         },
-        .num_headers = 0,
-        .headers = hdrs,
+        .num_headers = num_headers,
+        .headers = headers,
         .body = {
-            .data = (const uint8_t *)body,
-            .length = strlen(body)
+            .data = &request->data[request->body.offset],
+            .length = request->body.length
         },
-        .timeout_ms = 10000
+        .timeout_ms = HTTP_REQUEST_TIMEOUT_MS
     };
 
     // Issue the request -- and check its status
-    enum MvStatus status = mvSendHttpRequest(http_handles.channel, &request_config);
+    enum MvStatus status = mvSendHttpRequest(state->channel, &request_config);
     if (status == MV_STATUS_OKAY) {
         server_log("Request sent to the Microvisor Cloud");
-    } else if (status == MV_STATUS_CHANNELCLOSED) {
-        server_error("HTTP channel %lu already closed", (uint32_t)http_handles.channel);
+        if (http_timeout_job == SCHED_JOB_NONE) {
+            http_timeout_job = sched_add(http_check_timeouts, CHANNEL_KILL_PERIOD_US, 0);
+        }
+
+        return true;
+    }
+
+    if (status == MV_STATUS_CHANNELCLOSED) {
+        server_error("HTTP channel %lu already closed", (uint32_t)state->channel);
     } else {
         server_error("Could not issue request. Status: %i", status);
     }
 
-    return status;
+    http_fail(slot, status);
+    http_close_channel(slot);
+    return false;
 }
 
 
 /**
- * @brief The HTTP channel notification interrupt handler.
+ * @brief Pass a slot's response to its request's callback.
  *
- * This is called by Microvisor -- we need to check for key events
- * and extract HTTP response data when it is available.
+ * @param slot: The slot.
  */
-void TIM8_BRK_IRQHandler(void) {
+static void http_complete(uint32_t slot) {
 
-    // Check for a suitable event: readable data in the channel
-    bool got_notification = false;
-    struct MvNotification notification = http_notification_center[current_notification_index];
-    if (notification.event_type == MV_EVENTTYPE_CHANNELDATAREADABLE) {
-        // Flag we need to access received data and to close the HTTP channel
-        // when we're back in the main loop. This lets us exit the ISR quickly.
-        // We should not make Microvisor System Calls in the ISR.
-        received_request = true;
-        got_notification = true;
+    struct HttpSlot* state = &http_slots[slot];
+    if (!state->in_flight) return;
+
+    struct HttpResponse response = { 0 };
+    response.channel = state->channel;
+    response.status = mvReadHttpResponseData(state->channel, &response.data);
+    headers_init(&http_headers, state->channel, response.data.num_headers);
+    response.headers = &http_headers;
+
+    uint64_t elapsed = state->response_tick > state->start_tick ? state->response_tick - state->start_tick : 0;
+    response.latency_us = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+    http_record_latency(state->fresh_channel ? &http_latency.fresh : &http_latency.reused, elapsed);
+
+    if (response.status == MV_STATUS_OKAY && response.data.result == MV_HTTPRESULT_OK) {
+        http_queue_stats.completed++;
+
+        response.url_hash = state->url_hash;
+        if (state->url_hash != 0 && response.data.status_code == 304) {
+            response.cached = cache_hit(state->url_hash, &response.cached_len);
+        } else if (state->url_hash != 0 && response.data.status_code == 200) {
+            http_read_validator(&http_headers, &response.validator);
+        } else if (response.data.status_code == 429 || response.data.status_code == 503) {
+            http_hold(&http_headers);
+        }
+    } else {
+        http_queue_stats.failed++;
     }
 
-    if (notification.event_type == MV_EVENTTYPE_CHANNELNOTCONNECTED) {
-        // The HTTP channel signaled its unexpected closure
-        channel_was_closed = true;
-        got_notification = true;
+    const struct HttpQueueEntry* request = state->request;
+    if (request->callback != NULL) request->callback(&response, request->context);
+    if (request->replayed) http_replay_done();
+    http_queue_release(request);
+    http_release(slot);
+}
+
+
+/**
+ * @brief Tell a slot's in-flight request that it has failed, or store it
+ *        in flash to try again if it's durable.
+ *
+ * @param slot:   The slot.
+ * @param status: The reason.
+ */
+static void http_fail(uint32_t slot, enum MvStatus status) {
+
+    struct HttpSlot* state = &http_slots[slot];
+    if (!state->in_flight) return;
+
+    state->in_flight = false;
+    http_queue_stats.failed++;
+
+    const struct HttpQueueEntry* request = state->request;
+    if (!request->durable || !http_spool(request)) {
+        struct HttpResponse response = { 0 };
+        response.channel = state->channel;
+        response.status = status;
+        if (request->callback != NULL) request->callback(&response, request->context);
+        if (request->replayed) http_replay_done();
+    }
+
+    http_queue_release(request);
+}
+
+
+/**
+ * @brief Finish with a slot's channel once its response has been processed.
+ *
+ * With HTTP_REUSE_CHANNEL set, the channel stays open until it has
+ * been idle for HTTP_CHANNEL_IDLE_US, otherwise it is closed now.
+ *
+ * @param slot: The slot.
+ */
+static void http_release(uint32_t slot) {
+
+    struct HttpSlot* state = &http_slots[slot];
+    state->in_flight = false;
+
+    if (!HTTP_REUSE_CHANNEL) {
+        http_close_channel(slot);
+        return;
+    }
+
+    state->idle_since = http_now();
+    if (http_idle_job == SCHED_JOB_NONE) {
+        http_idle_job = sched_add(http_check_idle, HTTP_CHANNEL_IDLE_US, 0);
+    }
+}
+
+
+/**
+ * @brief Scheduled job: fail requests that have been in flight too long.
+ *
+ * Re-arms itself for the next request due to time out, if any.
+ */
+static void http_check_timeouts(void) {
+
+    http_timeout_job = SCHED_JOB_NONE;
+    uint64_t now = http_now();
+    uint64_t next = UINT64_MAX;
+
+    for (uint32_t slot = 0 ; slot < HTTP_MAX_IN_FLIGHT ; ++slot) {
+        struct HttpSlot* state = &http_slots[slot];
+        if (!state->in_flight) continue;
+
+        uint64_t deadline = state->start_tick + CHANNEL_KILL_PERIOD_US;
+        if (now >= deadline) {
+            server_error("HTTP request timed out");
+            http_fail(slot, MV_STATUS_UNAVAILABLE);
+            http_close_channel(slot);
+        } else if (deadline < next) {
+            next = deadline;
+        }
+    }
+
+    if (next != UINT64_MAX) http_timeout_job = sched_add(http_check_timeouts, next - now, 0);
+}
+
+
+/**
+ * @brief Scheduled job: close reused channels that have gone unused.
+ *
+ * Re-arms itself for the next channel due to idle out, if any.
+ */
+static void http_check_idle(void) {
+
+    http_idle_job = SCHED_JOB_NONE;
+    uint64_t now = http_now();
+    uint64_t next = UINT64_MAX;
+
+    for (uint32_t slot = 0 ; slot < HTTP_MAX_IN_FLIGHT ; ++slot) {
+        struct HttpSlot* state = &http_slots[slot];
+        if (state->in_flight || state->channel == 0) continue;
+
+        uint64_t deadline = state->idle_since + HTTP_CHANNEL_IDLE_US;
+        if (now >= deadline) {
+            server_log("HTTP channel idle");
+            http_close_channel(slot);
+        } else if (deadline < next) {
+            next = deadline;
+        }
+    }
+
+    if (next != UINT64_MAX) http_idle_job = sched_add(http_check_idle, next - now, 0);
+}
+
+
+/**
+ * @brief Read the Microvisor microsecond clock.
+ */
+static uint64_t http_now(void) {
+
+    uint64_t tick = 0;
+    mvGetMicroseconds(&tick);
+    return tick;
+}
+
+
+/**
+ * @brief Log the notification center's counters.
+ *
+ * A non-zero overrun count means HTTP_NT_BUFFER_SIZE_R is too small
+ * for the rate at which notifications arrive between interrupts.
+ */
+void http_report_notifications(void) {
+
+    struct NcRingStats stats;
+    nc_ring_get_stats(&http_notification_ring, &stats);
+    server_log("HTTP notifications: %lu received, %lu overruns, high-water mark %lu of %u records",
+               stats.received, stats.overruns, stats.high_water, HTTP_NT_BUFFER_SIZE_R);
+}
+
+
+/**
+ * @brief Log request latency for new and reused channels.
+ */
+void http_report_latency(void) {
+
+    const struct HttpLatency* modes[2] = { &http_latency.fresh, &http_latency.reused };
+    const char* names[2] = { "new", "reused" };
+    for (uint32_t i = 0 ; i < 2 ; ++i) {
+        const struct HttpLatency* latency = modes[i];
+        if (latency->count == 0) continue;
+        server_log("HTTP latency, %s channel: %lu requests, mean %lu us, min %lu us, max %lu us",
+                   names[i], latency->count, (uint32_t)(latency->total_us / latency->count),
+                   latency->min_us, latency->max_us);
+    }
+}
+
+
+/**
+ * @brief Log the request queue's depth and throughput.
+ *
+ * Throughput is measured over the time since the previous report.
+ */
+void http_report_queue(void) {
+
+    uint64_t now = http_now();
+    uint64_t window_us = now - http_report_tick;
+    uint32_t completed = http_queue_stats.completed - http_report_completed;
+    uint32_t per_hour = window_us > 0 ? (uint32_t)((uint64_t)completed * 3600000000ULL / window_us) : 0;
+
+    server_log("HTTP queue: depth %lu (high-water %lu of %u), %lu queued, %lu rejected, %lu completed, %lu failed, %lu held, %lu compressed (%lu bytes saved), %lu requests/hour",
+               http_queue.count, http_queue_stats.high_water, HTTP_QUEUE_DEPTH,
+               http_queue_stats.enqueued, http_queue_stats.rejected,
+               http_queue_stats.completed, http_queue_stats.failed, http_queue_stats.held,
+               http_queue_stats.compressed, http_queue_stats.compress_saved_b, per_hour);
+
+    http_report_tick = now;
+    http_report_completed = http_queue_stats.completed;
+}
+
+
+/**
+ * @brief Add a request-to-response time to a latency record.
+ *
+ * @param latency:    The record to update.
+ * @param elapsed_us: The request's latency.
+ */
+static void http_record_latency(struct HttpLatency* latency, uint64_t elapsed_us) {
+
+    uint32_t elapsed = elapsed_us > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed_us;
+    if (latency->count == 0 || elapsed < latency->min_us) latency->min_us = elapsed;
+    if (elapsed > latency->max_us) latency->max_us = elapsed;
+    latency->total_us += elapsed;
+    latency->count++;
+}
+
+
+/**
+ * @brief Store a request in flash, to be replayed.
+ *
+ * The record holds the method, URL and body. A replayed request that's
+ * stored again is done with: the new record takes its place.
+ *
+ * @param entry: The request.
+ *
+ * @returns `true` if the request was stored, otherwise `false`.
+ */
+static bool http_spool(const struct HttpQueueEntry* entry) {
+
+    // The method, URL and body lie in that order at the start of the
+    // request's data, so they're stored as they are
+    if (entry->num_headers > 0 || entry->used > SPOOL_RECORD_MAX_LEN_B - SPOOL_HEADER_SIZE_B) return false;
+    if (!spool_push(entry->data, entry->used)) {
+        server_error("Could not store HTTP request in flash");
+        return false;
+    }
+
+    server_log("HTTP request stored for replay: %s", (const char*)&entry->data[entry->url.offset]);
+    if (entry->replayed) http_replay_done();
+    return true;
+}
+
+
+/**
+ * @brief Move durable requests from the queue to flash, where they'll
+ *        survive a reset while the network is down.
+ *
+ * Requests that can't be stored stay queued, in order.
+ */
+static void http_spool_queue(void) {
+
+    uint32_t count = http_queue.count;
+    uint32_t stored = 0;
+    for (uint32_t i = 0 ; i < count ; ++i) {
+        // Take each request off the front, and put those not stored back
+        // at the back. With the queue full, the front entry is the back
+        uint8_t index = http_queue.order[http_queue.head];
+        const struct HttpQueueEntry* entry = &http_queue.entries[index];
+        if (entry->durable && http_spool(entry)) {
+            stored++;
+            http_queue.count--;
+            http_queue_release(entry);
+        } else {
+            http_queue.order[(http_queue.head + http_queue.count) % HTTP_QUEUE_DEPTH] = index;
+        }
+
+        http_queue.head = (http_queue.head + 1) % HTTP_QUEUE_DEPTH;
+    }
+
+    if (stored > 0) server_log("Stored %lu queued HTTP requests in flash", stored);
+}
+
+
+/**
+ * @brief Queue the next batch of stored requests, once the last batch is done.
+ */
+static void http_replay(void) {
+
+    if (http_replay_outstanding > 0 || http_spool_callback == NULL) return;
+
+    // The last batch's commit may have had to wait for this one's reads
+    if (http_replay_uncommitted) http_replay_uncommitted = !spool_commit();
+
+    // Each stored request is read straight into a free queue entry
+    uint32_t read = 0;
+    struct HttpQueueEntry* request = NULL;
+    while (read < HTTP_SPOOL_BATCH && (request = http_queue_free()) != NULL) {
+        uint32_t length = spool_read(request->data, sizeof(request->data));
+        if (length == 0) break;
+        read++;
+
+        if (!http_request_unpack(request, length)) {
+            server_error("Stored HTTP request is malformed");
+            continue;
+        }
+
+        if (http_request_queue(request, http_spool_callback, NULL, true, true)) http_replay_outstanding++;
+    }
+
+    if (http_replay_outstanding > 0) {
+        server_log("Replaying %lu stored HTTP requests", http_replay_outstanding);
+    } else if (read > 0) {
+        http_replay_uncommitted = !spool_commit();
+    }
+}
+
+
+/**
+ * @brief Rebuild a request around a record read back from flash.
+ *
+ * @param request: The request, its data holding the record: the method
+ *                 and URL, each NUL-terminated, then the body.
+ * @param length:  The size of the record.
+ *
+ * @returns `true` if the record is a request that fits the send buffer,
+ *          otherwise `false`.
+ */
+static bool http_request_unpack(struct HttpQueueEntry* request, uint32_t length) {
+
+    const uint8_t* method_end = memchr(request->data, 0, length);
+    if (method_end == NULL) return false;
+    uint32_t url_offset = (uint32_t)(method_end - request->data) + 1;
+    const uint8_t* url_end = memchr(&request->data[url_offset], 0, length - url_offset);
+    if (url_end == NULL) return false;
+    uint32_t body_offset = (uint32_t)(url_end - request->data) + 1;
+
+    request->method.offset = 0;
+    request->method.length = (uint16_t)(url_offset - 1);
+    request->url.offset = (uint16_t)url_offset;
+    request->url.length = (uint16_t)(body_offset - url_offset - 1);
+    request->body.offset = (uint16_t)(body_offset < length ? body_offset : 0);
+    request->body.length = (uint16_t)(length - body_offset);
+    request->num_headers = 0;
+    request->used = length;
+    request->wire_len = HTTP_REQUEST_LINE_OVERHEAD_B + length - 2;
+    request->overflow = request->wire_len > HTTP_TX_BUFFER_SIZE_B;
+    return !request->overflow;
+}
+
+
+/**
+ * @brief Note that a replayed request is done with, and commit its batch
+ *        once they all are.
+ */
+static void http_replay_done(void) {
+
+    if (http_replay_outstanding > 0 && --http_replay_outstanding == 0) {
+        http_replay_uncommitted = !spool_commit();
+    }
+}
+
+
+/**
+ * @brief Find a response's validator: its ETag, or failing that, its Last-Modified date.
+ *
+ * @param headers:   The response's headers.
+ * @param validator: The record to fill. Left empty if there's neither header,
+ *                   or the response may not be stored.
+ */
+static void http_read_validator(struct HeaderTable* headers, struct CacheValidator* validator) {
+
+    const char* cache_control = headers_get(headers, "cache-control");
+    if (cache_control != NULL && strstr(cache_control, "no-store") != NULL) return;
+
+    enum CacheValidatorType type = CACHE_VALIDATOR_ETAG;
+    const char* value = headers_get(headers, "etag");
+    if (value == NULL) {
+        type = CACHE_VALIDATOR_DATE;
+        value = headers_get(headers, "last-modified");
     }
 
-    if (got_notification) {
-        // Point to the next record to be written
-        current_notification_index = (current_notification_index + 1) % HTTP_NT_BUFFER_SIZE_R;
+    if (value == NULL || strlen(value) >= CACHE_VALIDATOR_MAX_LEN_B) return;
+    validator->type = type;
+    strcpy(validator->value, value);
+}
+
+
+/**
+ * @brief Hold back queued requests for as long as a 429 or 503 response's
+ *        Retry-After header asks.
+ *
+ * Without the header, or with a date rather than a delay, we wait
+ * HTTP_RETRY_AFTER_S. Requests already in flight are unaffected.
+ *
+ * @param headers: The response's headers.
+ */
+static void http_hold(struct HeaderTable* headers) {
 
-        // Clear the current notifications event
-        // See https://www.twilio.com/docs/iot/microvisor/microvisor-notifications#buffer-overruns
-        notification.event_type = 0;
+    uint32_t delay_s = HTTP_RETRY_AFTER_S;
+    if (!headers_get_uint(headers, "retry-after", &delay_s)) delay_s = HTTP_RETRY_AFTER_S;
+    if (delay_s > HTTP_RETRY_AFTER_MAX_S) delay_s = HTTP_RETRY_AFTER_MAX_S;
+
+    // Keep the later of this and any hold in force
+    uint64_t now = http_now();
+    uint64_t until = now + (uint64_t)delay_s * 1000000ULL;
+    if (http_resume_job != SCHED_JOB_NONE) {
+        if (until <= http_hold_until) return;
+        sched_cancel(http_resume_job);
     }
+
+    server_log("HTTP server busy: holding requests for %lu s", delay_s);
+    http_queue_stats.held++;
+    http_hold_until = until;
+    http_resume_job = sched_add(http_resume, until - now, 0);
+}
+
+
+/**
+ * @brief Scheduled job: release queued requests once a hold is over.
+ *
+ * The main loop sends them when it next services the engine.
+ */
+static void http_resume(void) {
+
+    http_resume_job = SCHED_JOB_NONE;
+    if (http_queue.count > 0) server_log("HTTP hold over: sending %lu queued requests", http_queue.count);
+}
+
+
+/**
+ * @brief Act on a single HTTP channel notification.
+ *
+ * @param notification: The notification record.
+ */
+static void http_process_notification(const struct MvNotification* notification) {
+
+    // The tag identifies the slot whose channel posted the notification
+    uint32_t slot = notification->tag & 0xFF;
+    if ((notification->tag >> 8) != USER_TAG_HTTP_OPEN_CHANNEL || slot >= HTTP_MAX_IN_FLIGHT) return;
+    struct HttpSlot* state = &http_slots[slot];
+
+    if (notification->event_type == MV_EVENTTYPE_CHANNELDATAREADABLE) {
+        // Flag we need to access received data when we're back in the
+        // main loop. This lets us exit the ISR quickly.
+        // We should not make Microvisor System Calls in the ISR.
+        state->response_tick = notification->microseconds;
+        state->readable = true;
+    } else if (notification->event_type == MV_EVENTTYPE_CHANNELNOTCONNECTED) {
+        // The HTTP channel signaled its unexpected closure
+        state->closed = true;
+    }
+}
+
+
+/**
+ * @brief The HTTP channel notification interrupt handler.
+ *
+ * This is called by Microvisor -- we need to check for key events
+ * and extract HTTP response data when it is available. Microvisor
+ * may post several records before we get here, so consume them all.
+ */
+void TIM8_BRK_IRQHandler(void) {
+
+    PROFILE_SCOPE("TIM8_BRK_IRQHandler");
+    nc_ring_drain(&http_notification_ring, http_process_notification);
 }
@@ -16,6 +16,98 @@
 #define     HTTP_RX_BUFFER_SIZE_B       1536
 #define     HTTP_TX_BUFFER_SIZE_B       512
 #define     HTTP_NT_BUFFER_SIZE_R       8             // NOTE Size in records, not bytes
+#define     HTTP_CHANNEL_IDLE_US        120000 * 1000
+#define     HTTP_REQUEST_TIMEOUT_MS     10000
+#define     HTTP_MAX_IN_FLIGHT          2             // Channels, each carrying one request
+#define     HTTP_QUEUE_DEPTH            8             // Requests, queued or in flight
+#define     HTTP_MAX_HEADERS            4             // Per request
+#define     HTTP_REQUEST_LINE_OVERHEAD_B 16           // Request line and framing, once Microvisor serializes a request
+#define     HTTP_HEADER_OVERHEAD_B      4             // ": " and CRLF
+#define     HTTP_BODY_CHUNK_SIZE_B      256
+#define     HTTP_SPOOL_BATCH            4             // Stored requests replayed, and committed, together
+#define     HTTP_RETRY_AFTER_S          30            // Wait after a 429 or 503 without Retry-After
+#define     HTTP_RETRY_AFTER_MAX_S      3600
+
+// Channel notification tag: identifies the slot that owns the channel
+#define     HTTP_SLOT_TAG(slot)         ((USER_TAG_HTTP_OPEN_CHANNEL << 8) | (slot))
+
+// A string literal and its length, counted by the compiler, as the
+// request builder's arguments, eg. `http_request_url(request, HTTP_LITERAL("https://"))`
+#define     HTTP_LITERAL(text)          (const uint8_t*)("" text), (sizeof(text) - 1)
+
+
+/*
+ * TYPES
+ */
+struct HttpLatency {
+    uint32_t    count;
+    uint32_t    min_us;
+    uint32_t    max_us;
+    uint64_t    total_us;
+};
+
+// What a request's callback receives. On failure, `status` is not
+// MV_STATUS_OKAY and `data` is zeroed. `channel` is valid only for
+// the duration of the callback, eg. to read the response body or,
+// through `headers`, its headers.
+// GETs made without headers are cached: on a 304, `cached` holds what
+// the callback gave `http_cache_put()` for the last 200
+struct HttpResponse {
+    MvChannelHandle             channel;
+    enum MvStatus               status;
+    struct MvHttpResponseData   data;
+    struct HeaderTable*         headers;            // `NULL` on failure
+    uint32_t                    latency_us;
+    uint32_t                    url_hash;           // 0 if the request is not cacheable
+    struct CacheValidator       validator;          // From a 200's ETag or Last-Modified header
+    const void*                 cached;
+    uint32_t                    cached_len;
+};
+
+typedef void (*http_callback)(const struct HttpResponse* response, void* context);
+
+// Receives a response body one chunk at a time, in order. `chunk` is
+// only valid for the call. Return `false` to stop reading
+typedef bool (*http_body_consumer)(const uint8_t* chunk, uint32_t length, uint32_t offset, void* context);
+
+// Where a part of a request lies in its `data`
+struct HttpSpan {
+    uint16_t    offset;
+    uint16_t    length;
+};
+
+// A request, built in place in the queue by the `http_request_*()` calls.
+// Its parts lie in `data` in the order they're added: method, URL,
+// headers, body. The method and URL are NUL-terminated there too.
+// A request that fits has room in the channel's send buffer
+struct HttpQueueEntry {
+    struct HttpSpan             method;
+    struct HttpSpan             url;
+    struct HttpSpan             keys[HTTP_MAX_HEADERS];
+    struct HttpSpan             values[HTTP_MAX_HEADERS];
+    struct HttpSpan             body;
+    uint32_t                    num_headers;
+    uint32_t                    used;               // Bytes of `data`
+    uint32_t                    wire_len;           // Bytes of send buffer
+    bool                        overflow;           // A part didn't fit, or came out of order
+    http_callback               callback;
+    void*                       context;
+    bool                        durable;            // Store in flash, rather than fail, if the network is lost
+    bool                        replayed;           // Read back from flash
+    uint8_t                     data[HTTP_TX_BUFFER_SIZE_B];
+};
+
+struct HttpQueueStats {
+    uint32_t    depth;              // Requests awaiting a channel now
+    uint32_t    high_water;         // Greatest depth seen
+    uint32_t    enqueued;
+    uint32_t    rejected;           // Queue full, or request too large for the send buffer
+    uint32_t    completed;          // Responses with a transport result of OK
+    uint32_t    failed;             // Send errors, timeouts, closures
+    uint32_t    held;               // Times the server asked us to wait
+    uint32_t    compressed;         // Request bodies sent compressed...
+    uint32_t    compress_saved_b;   // ...and the bytes that saved
+};
 
 
 #ifdef __cplusplus
@@ -27,10 +119,27 @@ extern "C" {
  * PROTOTYPES
  */
 void            http_setup_notification_center(void);
-bool            http_open_channel(void);
-void            http_close_channel(void);
-MvChannelHandle http_get_handle(void);
-enum MvStatus   http_send_request(bool do_reset);
+struct HttpQueueEntry* http_request_new(const uint8_t* method, uint32_t length);
+void            http_request_url(struct HttpQueueEntry* request, const uint8_t* text, uint32_t length);
+void            http_request_url_uint(struct HttpQueueEntry* request, uint32_t value);
+void            http_request_header(struct HttpQueueEntry* request, const uint8_t* key, uint32_t key_len,
+                                    const uint8_t* value, uint32_t value_len);
+uint8_t*        http_request_body(struct HttpQueueEntry* request, uint32_t length);
+bool            http_request_compress(struct HttpQueueEntry* request);
+bool            http_request_send(struct HttpQueueEntry* request, http_callback callback, void* context);
+bool            http_enqueue(const char* method, const char* url,
+                             const struct MvHttpHeader* headers, uint32_t num_headers,
+                             const uint8_t* body, uint32_t body_len,
+                             http_callback callback, void* context);
+bool            http_send_request(bool do_reset, http_callback callback);
+void            http_service(void);
+enum MvStatus   http_read_body(const struct HttpResponse* response, http_body_consumer consumer, void* context);
+bool            http_cache_put(const struct HttpResponse* response, const void* value, uint32_t length);
+bool            http_has_work(void);
+void            http_get_queue_stats(struct HttpQueueStats* stats);
+void            http_report_notifications(void);
+void            http_report_latency(void);
+void            http_report_queue(void);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,363 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * CONSTANTS
+ */
+enum {
+    JSON_STATE_VALUE = 0,           // Expecting a value
+    JSON_STATE_VALUE_OR_END,        // Just after '['
+    JSON_STATE_KEY,                 // Just after ',' in an object
+    JSON_STATE_KEY_OR_END,          // Just after '{'
+    JSON_STATE_KEY_STRING,
+    JSON_STATE_KEY_ESCAPE,
+    JSON_STATE_COLON,
+    JSON_STATE_STRING,
+    JSON_STATE_STRING_ESCAPE,
+    JSON_STATE_NUMBER,
+    JSON_STATE_LITERAL,
+    JSON_STATE_AFTER_VALUE,
+    JSON_STATE_DONE,
+    JSON_STATE_ERROR
+};
+
+// Marks a key that was too long to store
+#define     JSON_KEY_OVERFLOW           (JSON_KEY_MAX_LEN_B + 1)
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static uint32_t         json_match_path(const struct JsonParser* parser);
+static enum JsonStatus  json_fail(struct JsonParser* parser, enum JsonStatus error);
+static bool             json_end_scalar(struct JsonParser* parser);
+static void             json_emit(const struct JsonParser* parser, enum JsonType type,
+                                  const char* data, uint32_t length, bool done);
+
+
+/**
+ * @brief Prepare a parser for a new document.
+ *
+ * Paths are dot-separated object keys, with `[]` standing for any array
+ * element, eg. "id", "user.name" or "[].title". Only values at a listed
+ * path are passed to `handler`; everything else is skipped unread.
+ *
+ * @param parser:    The parser record.
+ * @param paths:     The paths to match. Must outlive the parser.
+ * @param num_paths: The number of paths.
+ * @param handler:   Called with each matching value.
+ * @param context:   Passed to `handler`.
+ */
+void json_init(struct JsonParser* parser, const char* const* paths, uint32_t num_paths,
+               json_value_handler handler, void* context) {
+
+    memset((void *)parser, 0x00, sizeof(struct JsonParser));
+    parser->paths = paths;
+    parser->num_paths = num_paths;
+    parser->handler = handler;
+    parser->context = context;
+    parser->state = JSON_STATE_VALUE;
+    parser->match = JSON_NO_MATCH;
+}
+
+
+/**
+ * @brief Tokenize the next chunk of a document.
+ *
+ * The chunk is read in place and need not end on a token boundary.
+ *
+ * @param parser: The parser record.
+ * @param data:   The chunk.
+ * @param length: The size of the chunk in bytes.
+ *
+ * @returns JSON_DONE once the outermost value is complete, JSON_OK if
+ *          more input is expected, or the error that stopped parsing.
+ */
+enum JsonStatus json_feed(struct JsonParser* parser, const uint8_t* data, uint32_t length) {
+
+    const char* p = (const char*)data;
+    const char* end = p + length;
+
+    while (p < end) {
+        char c = *p;
+        switch (parser->state) {
+            case JSON_STATE_VALUE_OR_END:
+            case JSON_STATE_VALUE:
+                if (c == ' ' || c == '\n' || c == '\r' || c == '\t') break;
+                if (c == ']' && parser->state == JSON_STATE_VALUE_OR_END) {
+                    parser->depth--;
+                    parser->state = JSON_STATE_AFTER_VALUE;
+                    break;
+                }
+
+                if (c == '{' || c == '[') {
+                    if (parser->depth == JSON_MAX_DEPTH) return json_fail(parser, JSON_ERROR_DEPTH);
+                    parser->containers[parser->depth] = c;
+                    parser->key_lengths[parser->depth] = 0;
+                    parser->depth++;
+                    parser->state = c == '{' ? JSON_STATE_KEY_OR_END : JSON_STATE_VALUE_OR_END;
+                    break;
+                }
+
+                parser->match = json_match_path(parser);
+                if (c == '"') {
+                    parser->state = JSON_STATE_STRING;
+                } else if (c == '-' || (c >= '0' && c <= '9')) {
+                    parser->scalar[0] = c;
+                    parser->scalar_length = 1;
+                    parser->state = JSON_STATE_NUMBER;
+                } else if (c == 't' || c == 'f' || c == 'n') {
+                    parser->scalar[0] = c;
+                    parser->scalar_length = 1;
+                    parser->state = JSON_STATE_LITERAL;
+                } else {
+                    return json_fail(parser, JSON_ERROR_SYNTAX);
+                }
+                break;
+
+            case JSON_STATE_KEY_OR_END:
+            case JSON_STATE_KEY:
+                if (c == ' ' || c == '\n' || c == '\r' || c == '\t') break;
+                if (c == '}' && parser->state == JSON_STATE_KEY_OR_END) {
+                    parser->depth--;
+                    parser->state = JSON_STATE_AFTER_VALUE;
+                    break;
+                }
+
+                if (c != '"') return json_fail(parser, JSON_ERROR_SYNTAX);
+                parser->key_lengths[parser->depth - 1] = 0;
+                parser->state = JSON_STATE_KEY_STRING;
+                break;
+
+            case JSON_STATE_KEY_ESCAPE:
+            case JSON_STATE_KEY_STRING: {
+                // Keys are stored raw, escapes and all, for path matching
+                uint8_t* key_length = &parser->key_lengths[parser->depth - 1];
+                if (c == '"' && parser->state == JSON_STATE_KEY_STRING) {
+                    parser->state = JSON_STATE_COLON;
+                    break;
+                }
+
+                parser->state = c == '\\' && parser->state == JSON_STATE_KEY_STRING ? JSON_STATE_KEY_ESCAPE : JSON_STATE_KEY_STRING;
+                if (*key_length < JSON_KEY_MAX_LEN_B) {
+                    parser->keys[parser->depth - 1][(*key_length)++] = c;
+                } else {
+                    *key_length = JSON_KEY_OVERFLOW;
+                }
+                break;
+            }
+
+            case JSON_STATE_COLON:
+                if (c == ' ' || c == '\n' || c == '\r' || c == '\t') break;
+                if (c != ':') return json_fail(parser, JSON_ERROR_SYNTAX);
+                parser->state = JSON_STATE_VALUE;
+                break;
+
+            case JSON_STATE_STRING_ESCAPE:
+            case JSON_STATE_STRING: {
+                // Scan to the closing quote without copying. A fragment
+                // is passed on whenever the chunk runs out first
+                const char* start = p;
+                if (parser->state == JSON_STATE_STRING_ESCAPE) {
+                    parser->state = JSON_STATE_STRING;
+                    p++;
+                }
+
+                while (p < end && *p != '"') {
+                    if (*p == '\\' && ++p == end) {
+                        parser->state = JSON_STATE_STRING_ESCAPE;
+                        break;
+                    }
+
+                    p++;
+                }
+
+                bool done = p < end;
+                if (parser->match != JSON_NO_MATCH && (p > start || done)) {
+                    json_emit(parser, JSON_TYPE_STRING, start, (uint32_t)(p - start), done);
+                }
+
+                if (!done) return JSON_OK;
+                parser->state = JSON_STATE_AFTER_VALUE;
+                break;
+            }
+
+            case JSON_STATE_NUMBER:
+            case JSON_STATE_LITERAL: {
+                bool more = parser->state == JSON_STATE_NUMBER
+                    ? (c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-'
+                    : (c >= 'a' && c <= 'z');
+                if (more) {
+                    if (parser->scalar_length == JSON_SCALAR_MAX_LEN_B) return json_fail(parser, JSON_ERROR_TOO_LONG);
+                    parser->scalar[parser->scalar_length++] = c;
+                    break;
+                }
+
+                // The terminator belongs to what follows, so look at it again
+                if (!json_end_scalar(parser)) return json_fail(parser, JSON_ERROR_SYNTAX);
+                continue;
+            }
+
+            case JSON_STATE_AFTER_VALUE:
+                if (parser->depth == 0) {
+                    parser->state = JSON_STATE_DONE;
+                    continue;
+                }
+
+                if (c == ' ' || c == '\n' || c == '\r' || c == '\t') break;
+                if (c == ',') {
+                    parser->state = parser->containers[parser->depth - 1] == '{' ? JSON_STATE_KEY : JSON_STATE_VALUE;
+                } else if (c == (parser->containers[parser->depth - 1] == '{' ? '}' : ']')) {
+                    parser->depth--;
+                } else {
+                    return json_fail(parser, JSON_ERROR_SYNTAX);
+                }
+                break;
+
+            case JSON_STATE_DONE:
+                if (c == ' ' || c == '\n' || c == '\r' || c == '\t') break;
+                return json_fail(parser, JSON_ERROR_SYNTAX);
+
+            default:
+                return (enum JsonStatus)parser->error;
+        }
+
+        p++;
+    }
+
+    if (parser->state == JSON_STATE_AFTER_VALUE && parser->depth == 0) parser->state = JSON_STATE_DONE;
+    return parser->state == JSON_STATE_DONE ? JSON_DONE : JSON_OK;
+}
+
+
+/**
+ * @brief Signal the end of the input.
+ *
+ * Only needed to complete a document that is a bare number; for any
+ * other document, `json_feed()` reports JSON_DONE by itself.
+ *
+ * @param parser: The parser record.
+ *
+ * @returns JSON_DONE if the document was complete, otherwise an error.
+ */
+enum JsonStatus json_finish(struct JsonParser* parser) {
+
+    if (parser->state == JSON_STATE_ERROR) return (enum JsonStatus)parser->error;
+    if ((parser->state == JSON_STATE_NUMBER || parser->state == JSON_STATE_LITERAL) && parser->depth == 0) {
+        if (!json_end_scalar(parser)) return json_fail(parser, JSON_ERROR_SYNTAX);
+        parser->state = JSON_STATE_DONE;
+    }
+
+    return parser->state == JSON_STATE_DONE ? JSON_DONE : json_fail(parser, JSON_ERROR_SYNTAX);
+}
+
+
+/**
+ * @brief Find the path, if any, that names the value about to be read.
+ *
+ * @param parser: The parser record.
+ *
+ * @returns The index of the first matching path, or JSON_NO_MATCH.
+ */
+static uint32_t json_match_path(const struct JsonParser* parser) {
+
+    for (uint32_t i = 0 ; i < parser->num_paths ; ++i) {
+        const char* path = parser->paths[i];
+        uint32_t level = 0;
+        for ( ; level < parser->depth ; ++level) {
+            const char* component = "[]";
+            uint32_t length = 2;
+            if (parser->containers[level] == '{') {
+                component = parser->keys[level];
+                length = parser->key_lengths[level];
+                if (length == JSON_KEY_OVERFLOW) break;
+            }
+
+            if (strncmp(path, component, length) != 0) break;
+            path += length;
+
+            // Components are separated by '.', which is optional before `[]`
+            if (level + 1 < parser->depth) {
+                if (*path == '.') {
+                    path++;
+                } else if (parser->containers[level + 1] != '[') {
+                    break;
+                }
+            }
+        }
+
+        if (level == parser->depth && *path == 0) return i;
+    }
+
+    return JSON_NO_MATCH;
+}
+
+
+/**
+ * @brief Put the parser into its error state.
+ *
+ * @returns The error, for the caller to return.
+ */
+static enum JsonStatus json_fail(struct JsonParser* parser, enum JsonStatus error) {
+
+    parser->state = JSON_STATE_ERROR;
+    parser->error = error;
+    return error;
+}
+
+
+/**
+ * @brief Complete the number or literal accumulated so far.
+ *
+ * @param parser: The parser record.
+ *
+ * @returns `false` if the text is not a valid literal, otherwise `true`.
+ */
+static bool json_end_scalar(struct JsonParser* parser) {
+
+    enum JsonType type = JSON_TYPE_NUMBER;
+    const char* text = parser->scalar;
+    uint32_t length = parser->scalar_length;
+
+    if (parser->state == JSON_STATE_LITERAL) {
+        if (length == 4 && strncmp(text, "true", 4) == 0) {
+            type = JSON_TYPE_TRUE;
+        } else if (length == 5 && strncmp(text, "false", 5) == 0) {
+            type = JSON_TYPE_FALSE;
+        } else if (length == 4 && strncmp(text, "null", 4) == 0) {
+            type = JSON_TYPE_NULL;
+        } else {
+            return false;
+        }
+    }
+
+    if (parser->match != JSON_NO_MATCH) json_emit(parser, type, text, length, true);
+    parser->state = JSON_STATE_AFTER_VALUE;
+    return true;
+}
+
+
+/**
+ * @brief Pass a matching value, or part of one, to the handler.
+ */
+static void json_emit(const struct JsonParser* parser, enum JsonType type,
+                      const char* data, uint32_t length, bool done) {
+
+    const struct JsonValue value = {
+        .path   = parser->match,
+        .type   = type,
+        .data   = data,
+        .length = length,
+        .done   = done
+    };
+
+    parser->handler(&value, parser->context);
+}
@@ -0,0 +1,94 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _JSON_H_
+#define _JSON_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     JSON_MAX_DEPTH              8
+#define     JSON_KEY_MAX_LEN_B          24            // Longer keys never match a path
+#define     JSON_SCALAR_MAX_LEN_B       24            // Numbers and literals
+#define     JSON_NO_MATCH               0xFFFFFFFF
+
+
+/*
+ * TYPES
+ */
+enum JsonStatus {
+    JSON_OK = 0,                    // Input consumed, more expected
+    JSON_DONE,                      // A complete document has been read
+    JSON_ERROR_SYNTAX,
+    JSON_ERROR_DEPTH,               // Nesting exceeds JSON_MAX_DEPTH
+    JSON_ERROR_TOO_LONG             // A number or literal exceeds JSON_SCALAR_MAX_LEN_B
+};
+
+enum JsonType {
+    JSON_TYPE_STRING = 0,
+    JSON_TYPE_NUMBER,
+    JSON_TYPE_TRUE,
+    JSON_TYPE_FALSE,
+    JSON_TYPE_NULL
+};
+
+// A value whose path matched. Strings arrive as one or more fragments
+// pointing into the caller's input, escapes left undecoded; `done` marks
+// the last. Numbers and literals always arrive whole. `data` is only
+// valid for the duration of the handler call
+struct JsonValue {
+    uint32_t        path;           // Index into the parser's path table
+    enum JsonType   type;
+    const char*     data;
+    uint32_t        length;
+    bool            done;
+};
+
+typedef void (*json_value_handler)(const struct JsonValue* value, void* context);
+
+// Tokenizer state. Holds everything needed to resume mid-token, so
+// the input can be fed in chunks of any size
+struct JsonParser {
+    const char* const*  paths;
+    uint32_t            num_paths;
+    json_value_handler  handler;
+    void*               context;
+
+    uint8_t             state;
+    uint8_t             error;                                      // Sticky `enum JsonStatus`
+    uint8_t             depth;
+    uint32_t            match;                                      // Path index of the value being read
+    char                containers[JSON_MAX_DEPTH];                 // '{' or '['
+    char                keys[JSON_MAX_DEPTH][JSON_KEY_MAX_LEN_B];   // Current key at each object level
+    uint8_t             key_lengths[JSON_MAX_DEPTH];
+    char                scalar[JSON_SCALAR_MAX_LEN_B];
+    uint8_t             scalar_length;
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void            json_init(struct JsonParser* parser, const char* const* paths, uint32_t num_paths,
+                          json_value_handler handler, void* context);
+enum JsonStatus json_feed(struct JsonParser* parser, const uint8_t* data, uint32_t length);
+enum JsonStatus json_finish(struct JsonParser* parser);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _JSON_H_
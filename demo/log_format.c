@@ -0,0 +1,237 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static bool     log_put(uint8_t* record, uint32_t* length, uint64_t value, uint32_t bytes);
+
+
+/*
+ * GLOBALS
+ */
+// Start of the format string dictionary, provided by the linker. Weak, so
+// builds that never use `LOG_FORMAT()` still link
+extern const char __start_log_fmt[] __attribute__((weak));
+
+static const char log_base64[64] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+
+/**
+ * @brief Format a log message as text.
+ *
+ * @param buffer:        The output buffer.
+ * @param size:          The size of the buffer in bytes.
+ * @param is_err:        Is the message an error?
+ * @param format_string: Message string with optional formatting.
+ * @param args:          va_list of args from previous call.
+ * @param truncated:     Set `true` if the message was cut to fit, which
+ *                       its last characters then mark. May be `NULL`.
+ *
+ * @returns The length of the message, excluding the NUL.
+ */
+uint32_t log_format_text(char* buffer, uint32_t size, bool is_err, const char* format_string, va_list args, bool* truncated) {
+
+    // Write the message type to the message
+    memcpy(buffer, is_err ? "[ERROR] " : "[DEBUG] ", 8);
+
+    // Write the formatted text to the message
+    int length = vsnprintf(&buffer[8], size - 9, format_string, args);
+    if (length < 0) length = 0;
+    bool cut = (uint32_t)length > size - 10;
+    if (cut) {
+        length = (int)(size - 10);
+        memcpy(&buffer[8 + length - LOG_TRUNCATED_MARK_LEN], LOG_TRUNCATED_MARK, LOG_TRUNCATED_MARK_LEN);
+    }
+
+    if (truncated != NULL) *truncated = cut;
+    return 8 + (uint32_t)length;
+}
+
+
+/**
+ * @brief Encode a log message as a deferred record.
+ *
+ * Nothing is formatted on the device. The record holds a 16-bit ID --
+ * the format string's offset in the `log_fmt` dictionary, with
+ * LOG_DEFERRED_ERROR_FLAG set for errors -- followed by the raw
+ * arguments, little-endian: four bytes for integers, characters and
+ * pointers; eight for `long long` and floating-point values; strings
+ * inline, NUL-terminated and cut to LOG_DEFERRED_STRING_MAX_LEN_B.
+ * Arguments that don't fit in LOG_DEFERRED_RECORD_MAX_LEN_B are dropped.
+ *
+ * The record is base64-encoded after LOG_DEFERRED_MARKER, so it passes
+ * through text log channels. `tools/log_decode.py` turns it back into text.
+ *
+ * @param buffer:        The output buffer.
+ * @param size:          The size of the buffer in bytes.
+ * @param is_err:        Is the message an error?
+ * @param format_string: A format string placed by `LOG_FORMAT()`.
+ * @param args:          va_list of args from previous call.
+ *
+ * @returns The length of the encoded record, excluding the NUL.
+ */
+uint32_t log_format_deferred(char* buffer, uint32_t size, bool is_err, const char* format_string, va_list args) {
+
+    uint8_t record[LOG_DEFERRED_RECORD_MAX_LEN_B];
+    uint32_t length = 0;
+    uint32_t id = (uint32_t)(format_string - __start_log_fmt) & ~LOG_DEFERRED_ERROR_FLAG;
+    log_put(record, &length, id | (is_err ? LOG_DEFERRED_ERROR_FLAG : 0), 2);
+
+    bool room = true;
+    for (const char* p = strchr(format_string, '%') ; room && p != NULL ; p = strchr(p + 1, '%')) {
+        if (*++p == '%') continue;
+
+        // Flags and width
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') p++;
+        if (*p == '*') {
+            room = log_put(record, &length, (uint32_t)va_arg(args, int), 4);
+            p++;
+        }
+
+        while (*p >= '0' && *p <= '9') p++;
+
+        // Precision, which also limits a string's length
+        uint32_t precision = LOG_DEFERRED_STRING_MAX_LEN_B;
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                int value = va_arg(args, int);
+                room = room && log_put(record, &length, (uint32_t)value, 4);
+                if (value >= 0 && (uint32_t)value < precision) precision = (uint32_t)value;
+                p++;
+            } else {
+                uint32_t value = 0;
+                while (*p >= '0' && *p <= '9') value = value * 10 + (uint32_t)(*p++ - '0');
+                if (value < precision) precision = value;
+            }
+        }
+
+        // Length modifiers
+        uint32_t longs = 0;
+        bool is_size = false;
+        while (*p == 'l') { longs++; p++; }
+        while (*p == 'h' || *p == 'z' || *p == 'j' || *p == 't') { is_size = is_size || *p != 'h'; p++; }
+
+        switch (*p) {
+            case 'd':
+            case 'i':
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+            case 'c':
+                if (longs > 1) {
+                    room = room && log_put(record, &length, (uint64_t)va_arg(args, long long), 8);
+                } else if (longs == 1 || is_size) {
+                    room = room && log_put(record, &length, (uint64_t)va_arg(args, long), 4);
+                } else {
+                    room = room && log_put(record, &length, (uint64_t)va_arg(args, int), 4);
+                }
+                break;
+            case 'p':
+                room = room && log_put(record, &length, (uint64_t)(uintptr_t)va_arg(args, void*), 4);
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                double value = va_arg(args, double);
+                uint64_t bits = 0;
+                memcpy(&bits, &value, 8);
+                room = room && log_put(record, &length, bits, 8);
+                break;
+            }
+            case 's': {
+                const char* string = va_arg(args, const char*);
+                if (string == NULL) string = "(null)";
+                if (!room || length == LOG_DEFERRED_RECORD_MAX_LEN_B) {
+                    room = false;
+                    break;
+                }
+
+                uint32_t count = (uint32_t)strnlen(string, precision);
+                if (length + count + 1 > LOG_DEFERRED_RECORD_MAX_LEN_B) {
+                    count = LOG_DEFERRED_RECORD_MAX_LEN_B - length - 1;
+                    room = false;
+                }
+
+                memcpy(&record[length], string, count);
+                length += count;
+                record[length++] = 0;
+                break;
+            }
+            case 0:
+                // Malformed trailing '%'
+                p--;
+                room = false;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return log_armor(buffer, size, LOG_DEFERRED_MARKER, record, length);
+}
+
+
+/**
+ * @brief Append a little-endian value to a record.
+ *
+ * @returns `false` if the record is full, otherwise `true`.
+ */
+static bool log_put(uint8_t* record, uint32_t* length, uint64_t value, uint32_t bytes) {
+
+    if (*length + bytes > LOG_DEFERRED_RECORD_MAX_LEN_B) return false;
+
+    // Both the device and the host are little-endian
+    memcpy(&record[*length], &value, bytes);
+    *length += bytes;
+    return true;
+}
+
+
+/**
+ * @brief Write a binary record as a marker and unpadded base64, so it
+ *        passes through text log channels.
+ *
+ * @param buffer: The output buffer.
+ * @param size:   The size of the buffer in bytes.
+ * @param marker: The character that introduces the record, eg. LOG_DEFERRED_MARKER.
+ * @param record: The record.
+ * @param length: Its length in bytes.
+ *
+ * @returns The length of the text, excluding the NUL, or 0 if it didn't fit.
+ */
+uint32_t log_armor(char* buffer, uint32_t size, char marker, const uint8_t* record, uint32_t length) {
+
+    uint32_t out = 0;
+    if (size < 2 + (length * 4 + 2) / 3) return 0;
+    buffer[out++] = marker;
+
+    for (uint32_t i = 0 ; i < length ; i += 3) {
+        uint32_t group = (uint32_t)record[i] << 16;
+        if (i + 1 < length) group |= (uint32_t)record[i + 1] << 8;
+        if (i + 2 < length) group |= record[i + 2];
+
+        buffer[out++] = log_base64[(group >> 18) & 0x3F];
+        buffer[out++] = log_base64[(group >> 12) & 0x3F];
+        if (i + 1 < length) buffer[out++] = log_base64[(group >> 6) & 0x3F];
+        if (i + 2 < length) buffer[out++] = log_base64[group & 0x3F];
+    }
+
+    buffer[out] = 0;
+    return out;
+}
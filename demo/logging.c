@@ -9,17 +9,79 @@
 #include "main.h"
 
 
+// Deferred records are already packed binary, which LZSS can't shrink:
+// every batch would be sent uncompressed, so the two don't mix
+#if LOG_DEFERRED == true && LOG_COMPRESS == true
+#error "LOG_DEFERRED and LOG_COMPRESS are mutually exclusive: set one of them to false"
+#endif
+
+
 /*
  * STATIC PROTOTYPES
  */
 static void log_start(void);
 static void log_service_setup(void);
-static void post_log(bool is_err, const char* format_string, va_list args);
+static void post_log(bool is_err, const char* key, const char* format_string, va_list args);
+static void log_keyed(bool is_err, const char* key, const char* format_string, ...);
+static bool log_limit_admit(const char* key, bool is_err, uint64_t now, uint32_t* repeats);
+static void log_limit_report(const char* key, bool is_err, uint32_t repeats);
+static void log_limit_sweep(void);
+static uint64_t log_limit_slack(bool is_err);
+static struct LogSlot* log_ring_reserve(void);
+static bool log_fold(struct LogSlot* slot, const char* key, bool is_err, uint64_t now, uint32_t* repeats, bool* repeats_err);
+static void log_fold_sweep(void);
+static void log_slot_write(struct LogSlot* slot, bool is_err, const char* format_string, va_list args);
+static void log_slot_printf(struct LogSlot* slot, bool is_err, const char* format_string, ...);
+static bool log_ring_output(void);
+#if LOG_COMPRESS == true
+static bool log_ring_output_batch(void);
+static void log_hold_due(void);
+#endif
+
+
+/*
+ * TYPES
+ */
+// One ring entry. `sequence` is the lap (the reserving position less
+// its slot index) while the slot is free, plus one once it holds a
+// message. Zeroed storage is therefore an empty ring
+struct LogSlot {
+    uint32_t    sequence;
+    uint16_t    length;
+    char        text[LOG_RING_SLOT_SIZE_B];
+};
+
+// One rate limiter entry. `key` is the message's format string, or an
+// assert's message. Its token bucket is kept as the time it will be
+// full again: each message logged adds LOG_LIMIT_REFILL_US, and a
+// message that would take it more than LOG_LIMIT_BURST messages' worth
+// ahead of now is suppressed. Errors use LOG_LIMIT_ERROR_REFILL_US and
+// LOG_LIMIT_ERROR_BURST
+struct LogLimit {
+    const char* key;
+    uint64_t    full_us;
+    uint32_t    suppressed;         // Since the key was last logged
+    bool        is_err;
+};
 
 
 /*
  * GLOBALS
  */
+// Each module's level at runtime: see `logging.h`
+volatile uint8_t log_levels[LOG_MODULE_COUNT] = {
+    [LOG_MODULE_MAIN] = LOG_LEVEL_MAIN,
+    [LOG_MODULE_HTTP] = LOG_LEVEL_HTTP,
+    [LOG_MODULE_NET]  = LOG_LEVEL_NET,
+    [LOG_MODULE_UART] = LOG_LEVEL_UART
+};
+
+#if LOG_DEFERRED == true
+// The format string dictionary, provided by the linker: see `log_format.c`
+extern const char __start_log_fmt[] __attribute__((weak));
+extern const char __stop_log_fmt[] __attribute__((weak));
+#endif
+
 // Entities for Microvisor application logging
 static uint8_t  log_buffer[LOG_BUFFER_SIZE_B] __attribute__((aligned(512))) = {0};
 static uint32_t log_state = USER_HANDLE_LOGGING_OFF;
@@ -29,6 +91,40 @@ static bool uart_available = false;
 // Declared in `uart_logging.c`
 extern UART_HandleTypeDef uart;
 
+// Messages awaiting output. Any context may add to the ring; only
+// the main loop's idle slot removes from it
+static struct LogSlot log_ring[LOG_RING_SLOTS];
+static uint32_t log_ring_head = 0;          // Next position to reserve
+static uint32_t log_ring_tail = 0;          // Next position to output
+static struct LogStats log_stats = { 0 };
+
+// Rate limiter entries, found by a hash of the key's address. Messages
+// may be logged from any context, so an entry is only read and updated
+// with interrupts masked
+static struct LogLimit log_limits[LOG_LIMIT_SLOTS];
+static uint32_t log_limits_pending = 0;     // Entries with suppressed messages to report
+
+// The last message queued, by its key and a hash of its text, and its
+// repeats since, which are counted rather than queued. Masked as for
+// the rate limiter
+static struct {
+    const char* key;
+    uint32_t    hash;
+    uint32_t    repeats;
+    uint64_t    last_us;            // When it was last repeated
+    bool        is_err;
+} log_last = { 0 };
+
+#if LOG_COMPRESS == true
+// Messages are held until LOG_DRAIN_BATCH await output or the first has
+// waited LOG_COMPRESS_HOLD_US, then compressed together
+static struct Compressor log_compressor;
+static uint8_t log_packed[COMPRESS_BOUND(LOG_COMPRESS_BATCH_MAX_B)];
+static char log_record[LOG_MESSAGE_MAX_LEN_B];
+static SchedJobId log_hold_job = SCHED_JOB_NONE;
+static bool log_hold_over = false;
+#endif
+
 
 /**
  * @brief  Open a logging channel.
@@ -61,6 +157,13 @@ static void log_service_setup(void) {
     // Set a mock handle as a proxy for a 'logging enabled' flag
     if (status == MV_STATUS_OKAY) log_state = USER_HANDLE_LOGGING_STARTED;
     do_assert(status == MV_STATUS_OKAY, "Could not start logging");
+
+#if LOG_DEFERRED == true
+    // A deferred record's ID is its format string's offset, below the
+    // error flag, so every offset must be too. The build checks this
+    // as well, in `tools/check_logdict.cmake`
+    do_assert(__stop_log_fmt - __start_log_fmt <= LOG_DEFERRED_ERROR_FLAG, "Log format dictionary too large for deferred IDs");
+#endif
 }
 
 
@@ -70,14 +173,14 @@ static void log_service_setup(void) {
  * @param format_string Message string with optional formatting
  * @param ...           Optional injectable values
  */
-void server_log(const char* format_string, ...) {
+// NOTE The parentheses stop the `server_log()` macro applying here. The
+//      macro has already checked the caller's log level
+void (server_log)(const char* format_string, ...) {
 
-    if (LOG_DEBUG_MESSAGES) {
-        va_list args;
-        va_start(args, format_string);
-        post_log(false, format_string, args);
-        va_end(args);
-    }
+    va_list args;
+    va_start(args, format_string);
+    post_log(false, format_string, format_string, args);
+    va_end(args);
 }
 
 
@@ -87,11 +190,28 @@ void server_log(const char* format_string, ...) {
  * @param format_string Message string with optional formatting
  * @param ...           Optional injectable values
  */
-void server_error(const char* format_string, ...) {
+void (server_error)(const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    post_log(true, format_string, format_string, args);
+    va_end(args);
+}
+
+
+/**
+ * @brief Issue a log message rate limited by a key other than its format string.
+ *
+ * @param is_err        Is the message an error?
+ * @param key           The message's rate limiter key, or `NULL` to bypass the limiter.
+ * @param format_string Message string with optional formatting
+ * @param ...           Optional injectable values
+ */
+static void log_keyed(bool is_err, const char* key, const char* format_string, ...) {
 
     va_list args;
     va_start(args, format_string);
-    post_log(true, format_string, args);
+    post_log(is_err, key, format_string, args);
     va_end(args);
 }
 
@@ -99,28 +219,544 @@ void server_error(const char* format_string, ...) {
 /**
  * @brief Issue any log message.
  *
+ * Repeats of a message beyond its rate limit are dropped before they
+ * are formatted. When it's next logged, a count of those dropped
+ * goes first. A message the same as the last one queued is counted
+ * rather than output, and the count goes before the next different one.
+ *
  * @param is_err        Is the message an error?
+ * @param key           The message's rate limiter key, usually its format string
  * @param format_string Message string with optional formatting
  * @param args          va_list of args from previous call
  */
-static void post_log(bool is_err, const char* format_string, va_list args) {
+static void post_log(bool is_err, const char* key, const char* format_string, va_list args) {
 
-    static char buffer[LOG_MESSAGE_MAX_LEN_B] = {0};
+    PROFILE_SCOPE("post_log");
+
+    uint64_t now = 0;
+    mvGetMicroseconds(&now);
+    uint32_t repeats = 0;
+    if (!log_limit_admit(key, is_err, now, &repeats)) return;
+    if (repeats > 0) log_limit_report(key, is_err, repeats);
 
     // Initialize logging if we need to
     log_start();
 
-    // Write the message type to the message
-    sprintf(buffer, is_err ? "[ERROR] " : "[DEBUG] ");
+    // Claim a slot in the ring. If the ring is full, the message is lost
+    struct LogSlot* slot = log_ring_reserve();
+    if (slot == NULL) {
+        __atomic_fetch_add(&log_stats.dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    // Keep the arguments, in case the message has to be written twice
+    va_list again;
+    va_copy(again, args);
+    log_slot_write(slot, is_err, format_string, args);
 
-    // Write the formatted text to the message
-    vsnprintf(&buffer[8], sizeof(buffer) - 9, format_string, args);
+    // A repeat is published empty, which the consumer skips. The count of
+    // repeats must go out before a different message, but the message
+    // already has its slot: the count takes the slot, and the message
+    // the next one
+    uint32_t folded = 0;
+    bool folded_err = false;
+    if (log_fold(slot, key, is_err, now, &folded, &folded_err)) {
+        slot->length = 0;
+    } else if (folded > 0) {
+        log_slot_printf(slot, folded_err, LOG_FORMAT("Last message repeated %lu times"), folded);
+        __atomic_store_n(&slot->sequence, slot->sequence + 1, __ATOMIC_RELEASE);
 
-    // Output the message using the system call
-    mvServerLog((const uint8_t*)buffer, (uint16_t)strlen(buffer));
+        slot = log_ring_reserve();
+        if (slot == NULL) {
+            __atomic_fetch_add(&log_stats.dropped, 1, __ATOMIC_RELAXED);
+            va_end(again);
+            return;
+        }
 
-    // Do we output via UART too?
-    if (uart_available) log_uart_output(buffer);
+        log_slot_write(slot, is_err, format_string, again);
+    }
+
+    va_end(again);
+
+    // Publish the message to the consumer
+    __atomic_store_n(&slot->sequence, slot->sequence + 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief Format a message, or encode it for decoding off the device,
+ *        straight into a ring slot.
+ *
+ * @param slot          The claimed slot.
+ * @param is_err        Is the message an error?
+ * @param format_string Message string with optional formatting
+ * @param args          va_list of args from previous call
+ */
+static void log_slot_write(struct LogSlot* slot, bool is_err, const char* format_string, va_list args) {
+
+#if LOG_DEFERRED == true
+    slot->length = (uint16_t)log_format_deferred(slot->text, sizeof(slot->text), is_err, format_string, args);
+#else
+    bool truncated = false;
+    slot->length = (uint16_t)log_format_text(slot->text, sizeof(slot->text), is_err, format_string, args, &truncated);
+    if (truncated) __atomic_fetch_add(&log_stats.truncated, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+
+/**
+ * @brief Write a message into a ring slot.
+ *
+ * @param slot          The claimed slot.
+ * @param is_err        Is the message an error?
+ * @param format_string Message string with optional formatting
+ * @param ...           Optional injectable values
+ */
+static void log_slot_printf(struct LogSlot* slot, bool is_err, const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    log_slot_write(slot, is_err, format_string, args);
+    va_end(args);
+}
+
+
+/**
+ * @brief Check whether a queued message repeats the last one, and make
+ *        it the last one if not.
+ *
+ * Messages without a key, such as the counts of repeats, are never
+ * repeats themselves.
+ *
+ * @param slot:        The message's slot, written but not published.
+ * @param key:         The message's key.
+ * @param is_err:      Is the message an error?
+ * @param now:         The time, in microseconds.
+ * @param repeats:     Receives, for a different message, the number of
+ *                     repeats of the last one still to report.
+ * @param repeats_err: Receives whether they were errors.
+ *
+ * @returns `true` if the message is a repeat, otherwise `false`.
+ */
+static bool log_fold(struct LogSlot* slot, const char* key, bool is_err, uint64_t now, uint32_t* repeats, bool* repeats_err) {
+
+    uint32_t hash = 2166136261UL;
+    for (uint32_t i = 0 ; i < slot->length ; ++i) hash = (hash ^ (uint8_t)slot->text[i]) * 16777619UL;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool repeat = key != NULL && key == log_last.key && hash == log_last.hash;
+    if (repeat) {
+        log_last.last_us = now;
+        log_last.repeats++;
+    } else {
+        *repeats = log_last.repeats;
+        *repeats_err = log_last.is_err;
+        log_last.key = key;
+        log_last.hash = hash;
+        log_last.repeats = 0;
+        log_last.is_err = is_err;
+    }
+
+    __set_PRIMASK(primask);
+    if (repeat) __atomic_fetch_add(&log_stats.folded, 1, __ATOMIC_RELAXED);
+    return repeat;
+}
+
+
+/**
+ * @brief Report repeats of the last message once it has stopped.
+ *
+ * Repeats are otherwise only reported when a different message is
+ * logged, which may not be for some time.
+ */
+static void log_fold_sweep(void) {
+
+    if (__atomic_load_n(&log_last.repeats, __ATOMIC_RELAXED) == 0) return;
+
+    uint64_t now = 0;
+    mvGetMicroseconds(&now);
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t repeats = 0;
+    bool is_err = log_last.is_err;
+    if (log_last.repeats > 0 && now - log_last.last_us >= LOG_FOLD_QUIET_US) {
+        repeats = log_last.repeats;
+        log_last.repeats = 0;
+    }
+
+    __set_PRIMASK(primask);
+    if (repeats > 0) log_keyed(is_err, NULL, LOG_FORMAT("Last message repeated %lu times"), repeats);
+}
+
+
+/**
+ * @brief Check a message against its rate limit, and take a token if
+ *        it's within it.
+ *
+ * A key whose entry is taken by another is let through untracked. An
+ * entry is only taken over once its bucket is full and it has no
+ * suppressed messages to report.
+ *
+ * @param key:     The message's key.
+ * @param is_err:  Is the message an error?
+ * @param now:     The time, in microseconds.
+ * @param repeats: Receives the number of its repeats suppressed since it
+ *                 was last logged, to report.
+ *
+ * @returns `true` if the message should be logged, otherwise `false`.
+ */
+static bool log_limit_admit(const char* key, bool is_err, uint64_t now, uint32_t* repeats) {
+
+    if (key == NULL) return true;
+
+    struct LogLimit* entry = &log_limits[(((uint32_t)(uintptr_t)key * 2654435761u) >> 16) % LOG_LIMIT_SLOTS];
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if (entry->key != key) {
+        if (entry->key != NULL && (entry->full_us > now || entry->suppressed > 0)) {
+            __set_PRIMASK(primask);
+            __atomic_fetch_add(&log_stats.untracked, 1, __ATOMIC_RELAXED);
+            return true;
+        }
+
+        entry->key = key;
+        entry->full_us = now;
+        entry->suppressed = 0;
+        entry->is_err = is_err;
+    }
+
+    if (entry->full_us < now) entry->full_us = now;
+    if (entry->full_us - now > log_limit_slack(entry->is_err)) {
+        if (entry->suppressed++ == 0) __atomic_fetch_add(&log_limits_pending, 1, __ATOMIC_RELAXED);
+        __set_PRIMASK(primask);
+        __atomic_fetch_add(&log_stats.suppressed, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    entry->full_us += entry->is_err ? LOG_LIMIT_ERROR_REFILL_US : LOG_LIMIT_REFILL_US;
+    *repeats = entry->suppressed;
+    if (entry->suppressed > 0) {
+        entry->suppressed = 0;
+        __atomic_fetch_sub(&log_limits_pending, 1, __ATOMIC_RELAXED);
+    }
+
+    __set_PRIMASK(primask);
+    return true;
+}
+
+
+/**
+ * @brief Log how many repeats of a message were suppressed.
+ *
+ * The repeats were dropped before they were formatted, so they have no
+ * text to show: the summary names them by their key, quoted so it's
+ * not taken for a message itself. In deferred builds the key is sent
+ * as a string argument, like any other, not as a dictionary ID.
+ *
+ * Summaries are not limited themselves: there can be no more of them
+ * than the messages they count are let through.
+ */
+static void log_limit_report(const char* key, bool is_err, uint32_t repeats) {
+
+    log_keyed(is_err, NULL, LOG_FORMAT("Suppressed %lu repeats of \"%s\""), repeats, key);
+}
+
+
+/**
+ * @brief Report suppressed messages that have not been logged again,
+ *        once their buckets have room.
+ *
+ * Repeats are otherwise only reported when the message is next logged,
+ * which, for a message that has stopped, is never.
+ */
+static void log_limit_sweep(void) {
+
+    if (__atomic_load_n(&log_limits_pending, __ATOMIC_RELAXED) == 0) return;
+
+    uint64_t now = 0;
+    mvGetMicroseconds(&now);
+    for (uint32_t i = 0 ; i < LOG_LIMIT_SLOTS ; ++i) {
+        struct LogLimit* entry = &log_limits[i];
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        uint32_t repeats = 0;
+        const char* key = entry->key;
+        bool is_err = entry->is_err;
+        if (entry->suppressed > 0 && entry->full_us <= now + log_limit_slack(is_err)) {
+            repeats = entry->suppressed;
+            entry->suppressed = 0;
+            __atomic_fetch_sub(&log_limits_pending, 1, __ATOMIC_RELAXED);
+        }
+
+        __set_PRIMASK(primask);
+        if (repeats > 0) log_limit_report(key, is_err, repeats);
+    }
+}
+
+
+/**
+ * @brief How far ahead of now a key's bucket may be full again before
+ *        its messages are suppressed.
+ *
+ * Errors are held to a smaller burst and a slower refill than debug
+ * messages, which a normal request cycle repeats every cycle.
+ *
+ * @param is_err: Is the key an error?
+ *
+ * @returns The time in microseconds.
+ */
+static uint64_t log_limit_slack(bool is_err) {
+
+    if (is_err) return (uint64_t)(LOG_LIMIT_ERROR_BURST - 1) * LOG_LIMIT_ERROR_REFILL_US;
+    return (uint64_t)(LOG_LIMIT_BURST - 1) * LOG_LIMIT_REFILL_US;
+}
+
+
+/**
+ * @brief Claim the next free ring slot.
+ *
+ * Lock-free and safe to call from any context: producers race for the
+ * head with a compare-and-swap, and a producer that is interrupted
+ * between claiming and publishing only holds up the output, not other
+ * producers.
+ *
+ * @returns The slot, or `NULL` if the ring is full.
+ */
+static struct LogSlot* log_ring_reserve(void) {
+
+    uint32_t position = __atomic_load_n(&log_ring_head, __ATOMIC_RELAXED);
+    while (true) {
+        struct LogSlot* slot = &log_ring[position % LOG_RING_SLOTS];
+        uint32_t lap = position - position % LOG_RING_SLOTS;
+        int32_t state = (int32_t)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - lap);
+
+        if (state == 0) {
+            // The slot is free: try to claim it. On failure,
+            // `position` is updated to the current head
+            if (__atomic_compare_exchange_n(&log_ring_head, &position, position + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                uint32_t used = position + 1 - __atomic_load_n(&log_ring_tail, __ATOMIC_RELAXED);
+                if (used > log_stats.high_water) log_stats.high_water = used;
+                __atomic_fetch_add(&log_stats.written, 1, __ATOMIC_RELAXED);
+                return slot;
+            }
+        } else if (state < 0) {
+            // The slot still holds a message from the previous lap
+            return NULL;
+        } else {
+            // Another producer claimed the slot first
+            position = __atomic_load_n(&log_ring_head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+
+/**
+ * @brief Output the oldest message in the ring and free its slot.
+ *
+ * @returns `false` if there was no published message, otherwise `true`.
+ */
+static bool log_ring_output(void) {
+
+    uint32_t position = log_ring_tail;
+    struct LogSlot* slot = &log_ring[position % LOG_RING_SLOTS];
+    uint32_t lap = position - position % LOG_RING_SLOTS;
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != lap + 1) return false;
+
+    // Output the message using the system call, unless it was a
+    // repeat of the last one, which is left empty
+    if (slot->length > 0) {
+        mvServerLog((const uint8_t*)slot->text, slot->length);
+
+        // Do we output via UART too?
+        if (uart_available) log_uart_output(slot->text);
+    }
+
+    // Hand the slot to the next lap's producer
+    __atomic_store_n(&slot->sequence, lap + LOG_RING_SLOTS, __ATOMIC_RELEASE);
+    __atomic_store_n(&log_ring_tail, position + 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+
+#if LOG_COMPRESS == true
+/**
+ * @brief Output the oldest messages in the ring as one compressed record,
+ *        and free their slots.
+ *
+ * Up to LOG_DRAIN_BATCH messages, LOG_COMPRESS_BATCH_MAX_B of text
+ * between them, are joined with newlines and compressed, with
+ * LOG_COMPRESS_DICTIONARY preloaded. The record is sent as
+ * LOG_COMPRESS_MARKER and base64, if that's shorter than the messages,
+ * otherwise the messages are sent as they are. Each batch is compressed
+ * on its own, so a lost record loses only its own messages.
+ *
+ * @returns `false` if there was no published message, otherwise `true`.
+ */
+static bool log_ring_output_batch(void) {
+
+    struct LogSlot* slots[LOG_DRAIN_BATCH];
+    uint32_t count = 0;
+    uint32_t text = 0;
+    compress_init(&log_compressor, log_packed, sizeof(log_packed),
+                  (const uint8_t*)LOG_COMPRESS_DICTIONARY, sizeof(LOG_COMPRESS_DICTIONARY) - 1);
+
+    while (count < LOG_DRAIN_BATCH) {
+        uint32_t position = log_ring_tail + count;
+        struct LogSlot* slot = &log_ring[position % LOG_RING_SLOTS];
+        uint32_t lap = position - position % LOG_RING_SLOTS;
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != lap + 1) break;
+        if (count > 0 && text + count + slot->length > LOG_COMPRESS_BATCH_MAX_B) break;
+        if (slot->length == 0) {
+            slots[count++] = slot;
+            continue;
+        }
+
+        if (text > 0) compress_write(&log_compressor, (const uint8_t*)"\n", 1);
+        compress_write(&log_compressor, (const uint8_t*)slot->text, slot->length);
+        text += slot->length;
+        slots[count++] = slot;
+    }
+
+    if (count == 0) return false;
+
+    uint32_t packed = compress_finish(&log_compressor);
+    uint32_t length = packed > 0 ? log_armor(log_record, sizeof(log_record), LOG_COMPRESS_MARKER, log_packed, packed) : 0;
+    log_stats.text_b += text;
+    if (length == 0 || length >= text) {
+        log_stats.sent_b += text;
+        for (uint32_t i = 0 ; i < count ; ++i) log_ring_output();
+        return true;
+    }
+
+    mvServerLog((const uint8_t*)log_record, (uint16_t)length);
+    log_stats.batches++;
+    log_stats.sent_b += length;
+
+    // UART output stays as text, a message at a time
+    for (uint32_t i = 0 ; i < count ; ++i) {
+        if (uart_available && slots[i]->length > 0) log_uart_output(slots[i]->text);
+
+        uint32_t position = log_ring_tail;
+        uint32_t lap = position - position % LOG_RING_SLOTS;
+        __atomic_store_n(&slots[i]->sequence, lap + LOG_RING_SLOTS, __ATOMIC_RELEASE);
+        __atomic_store_n(&log_ring_tail, position + 1, __ATOMIC_RELAXED);
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Scheduled job: end the wait for more messages to share a record.
+ */
+static void log_hold_due(void) {
+
+    log_hold_job = SCHED_JOB_NONE;
+    log_hold_over = true;
+}
+#endif
+
+
+/**
+ * @brief Output a batch of queued messages.
+ *
+ * Registered as the scheduler's idle job, so it runs when the main
+ * loop has nothing else to do. At most LOG_DRAIN_BATCH messages are
+ * output at a time, so logging never holds off due jobs for long.
+ *
+ * With LOG_COMPRESS, fewer than LOG_DRAIN_BATCH messages are held
+ * for up to LOG_COMPRESS_HOLD_US, for more to join them.
+ */
+void log_service(void) {
+
+    log_limit_sweep();
+    log_fold_sweep();
+
+#if LOG_COMPRESS == true
+    uint32_t pending = __atomic_load_n(&log_ring_head, __ATOMIC_RELAXED) - log_ring_tail;
+    if (pending == 0) return;
+
+    if (pending < LOG_DRAIN_BATCH && !log_hold_over) {
+        if (log_hold_job == SCHED_JOB_NONE) log_hold_job = sched_add(log_hold_due, LOG_COMPRESS_HOLD_US, 0);
+
+        // Without a job to end the wait, don't wait
+        if (log_hold_job != SCHED_JOB_NONE) return;
+    }
+
+    // Once the ring is empty, the next message starts a new wait
+    if (log_ring_output_batch() && __atomic_load_n(&log_ring_head, __ATOMIC_RELAXED) == log_ring_tail) {
+        sched_cancel(log_hold_job);
+        log_hold_job = SCHED_JOB_NONE;
+        log_hold_over = false;
+    }
+#else
+    for (uint32_t i = 0 ; i < LOG_DRAIN_BATCH ; ++i) {
+        if (!log_ring_output()) break;
+    }
+#endif
+}
+
+
+/**
+ * @brief Output every queued message.
+ */
+void log_flush(void) {
+
+#if LOG_COMPRESS == true
+    while (log_ring_output_batch()) { }
+#else
+    while (log_ring_output()) { }
+#endif
+}
+
+
+/**
+ * @brief Check for queued messages.
+ *
+ * @returns `true` if a message awaits output, otherwise `false`. With
+ *          LOG_COMPRESS, messages held for others to join them don't count.
+ */
+bool log_has_pending(void) {
+
+    uint32_t pending = __atomic_load_n(&log_ring_head, __ATOMIC_RELAXED) - log_ring_tail;
+#if LOG_COMPRESS == true
+    if (pending > 0 && pending < LOG_DRAIN_BATCH && !log_hold_over && log_hold_job != SCHED_JOB_NONE) return false;
+#endif
+    return pending > 0;
+}
+
+
+/**
+ * @brief Copy out the log ring's counters.
+ *
+ * @param stats: Pointer to the record to fill.
+ */
+void log_get_stats(struct LogStats* stats) {
+
+    *stats = log_stats;
+}
+
+
+/**
+ * @brief Log the log ring's counters.
+ *
+ * A non-zero drop count means LOG_RING_SLOTS is too small for the
+ * bursts of messages logged between idle slots.
+ */
+void log_report(void) {
+
+    server_log("Log ring: %lu written, %lu dropped, %lu truncated, high-water mark %lu of %u slots, %lu suppressed by the rate limiter, %lu untracked, %lu repeats folded",
+               log_stats.written, log_stats.dropped, log_stats.truncated, log_stats.high_water, LOG_RING_SLOTS,
+               log_stats.suppressed, log_stats.untracked, log_stats.folded);
+#if LOG_COMPRESS == true
+    uint32_t percent = log_stats.text_b > 0 ? (uint32_t)(log_stats.sent_b * 100 / log_stats.text_b) : 0;
+    server_log("Log compression: %lu records, %lu of %lu message bytes sent (%lu%%)",
+               log_stats.batches, (uint32_t)log_stats.sent_b, (uint32_t)log_stats.text_b, percent);
+#endif
 }
 
 
@@ -133,7 +769,11 @@ static void post_log(bool is_err, const char* format_string, va_list args) {
 void do_assert(bool condition, const char* message) {
 
     if (!condition) {
-        server_error("%s", message);
+        // Keyed by the message, so each assert is rate limited on its own
+        log_keyed(true, message, LOG_FORMAT("%s"), message);
+
+        // Get the message out before halting
+        log_flush();
         assert(false);
     }
 }
@@ -20,21 +20,144 @@
 #define     USER_HANDLE_LOGGING_STARTED         0xFFFF
 #define     USER_HANDLE_LOGGING_OFF             0
 
+// The longest log record output in one piece. NOTE Each message is cut
+// to fit its ring slot first: LOG_RING_SLOT_SIZE_B less the "[DEBUG] "
+// prefix and two bytes, so 182 characters of text. A message cut short
+// ends with LOG_TRUNCATED_MARK, and is counted in `LogStats.truncated`
 #define     LOG_MESSAGE_MAX_LEN_B               1024
 #define     LOG_BUFFER_SIZE_B                   8192
 
+// Log levels: a module logs the messages at or below its level
+#define     LOG_LEVEL_NONE                      0
+#define     LOG_LEVEL_ERROR                     1             // `server_error()`
+#define     LOG_LEVEL_DEBUG                     2             // `server_log()`
+
+// Modules, each with its own level: set LOG_LEVEL_MAIN, LOG_LEVEL_HTTP,
+// LOG_LEVEL_NET and LOG_LEVEL_UART in CMakeLists.txt. A source file joins
+// a module by defining LOG_MODULE before it includes `main.h`
+#define     LOG_MODULE_MAIN                     0             // The default
+#define     LOG_MODULE_HTTP                     1
+#define     LOG_MODULE_NET                      2
+#define     LOG_MODULE_UART                     3
+#define     LOG_MODULE_COUNT                    4
+
+// Messages queued for output, and the most output per idle slot
+#define     LOG_RING_SLOTS                      32            // NOTE Must be a power of two
+#define     LOG_RING_SLOT_SIZE_B                192           // NOTE Bounds the length of every message
+#define     LOG_TRUNCATED_MARK                  "..."
+#define     LOG_TRUNCATED_MARK_LEN              3
+#define     LOG_DRAIN_BATCH                     8
+
+// Deferred logging: see `log_format.c`
+#define     LOG_DEFERRED_MARKER                 '~'
+#define     LOG_DEFERRED_RECORD_MAX_LEN_B       96
+#define     LOG_DEFERRED_STRING_MAX_LEN_B       48
+#define     LOG_DEFERRED_ERROR_FLAG             0x8000
+
+// Per-message rate limiting: see `logging.c`
+#define     LOG_LIMIT_SLOTS                     64            // NOTE Must be a power of two
+#define     LOG_LIMIT_BURST                     16            // Repeats of a debug message logged at once before any are suppressed...
+#define     LOG_LIMIT_REFILL_US                 6000 * 1000   // ...then one this often
+#define     LOG_LIMIT_ERROR_BURST               3             // Repeats of an error, eg. one a failing request cycle logs every cycle...
+#define     LOG_LIMIT_ERROR_REFILL_US           600000 * 1000 // ...then one this often
+
+// Repeats of the last message: see `logging.c`
+#define     LOG_FOLD_QUIET_US                   10000 * 1000  // Repeats are counted once the message has stopped this long
+
+// Compressed logging: see `logging.c`
+#define     LOG_COMPRESS_MARKER                 '^'
+#define     LOG_COMPRESS_BATCH_MAX_B            640           // Message text compressed into one record
+#define     LOG_COMPRESS_HOLD_US                1000 * 1000   // Longest a message waits for others to share its record
+
+// Text the app's messages repeat, preloaded as the compressor's history so
+// that even a short batch finds matches. NOTE `tools/log_decode.py` holds a copy
+#define     LOG_COMPRESS_DICTIONARY             "[ERROR] HTTP status code: \n[DEBUG] HTTP server busy: holding requests for \n" \
+                                                "[DEBUG] HTTP hold over: sending queued requests\n" \
+                                                "[DEBUG] HTTP response received. Body length:  bytes, type: application/json; charset=utf-8\n" \
+                                                "[DEBUG] Todo : \" (not completed)\n[DEBUG] Debug test variable value: \n" \
+                                                "[DEBUG] Preparing HTTP request\n[DEBUG] Request sent to the Microvisor Cloud\n"
+
+
+/*
+ * TYPES
+ */
+struct LogStats {
+    uint32_t    written;            // Messages queued
+    uint32_t    dropped;            // Messages lost to a full ring
+    uint32_t    truncated;          // Messages cut to fit a slot
+    uint32_t    high_water;         // Most slots in use at once
+    uint32_t    suppressed;         // Messages dropped by the rate limiter
+    uint32_t    untracked;          // Messages let through for want of a rate limiter entry
+    uint32_t    folded;             // Repeats of the last message counted instead of logged
+    uint32_t    batches;            // Compressed records sent
+    uint64_t    text_b;             // Message bytes output...
+    uint64_t    sent_b;             // ...and the bytes sent for them
+};
+
+
+/*
+ * MACROS
+ */
+// Place a format string in the `log_fmt` section, whose contents are
+// extracted at build time as the deferred-logging dictionary
+#define     LOG_FORMAT(format)                  ({ static const char log_format_[] __attribute__((section("log_fmt"))) = format; log_format_; })
+
+#ifndef LOG_MODULE
+#define     LOG_MODULE                          LOG_MODULE_MAIN
+#endif
+
+// A module's level as built. A constant, so calls above it, and the
+// evaluation of their arguments, are compiled out
+#define     LOG_BUILT_LEVEL(module)             ((module) == LOG_MODULE_HTTP ? LOG_LEVEL_HTTP : \
+                                                 (module) == LOG_MODULE_NET  ? LOG_LEVEL_NET  : \
+                                                 (module) == LOG_MODULE_UART ? LOG_LEVEL_UART : LOG_LEVEL_MAIN)
+
+// Is a message at `level` logged by the calling file's module? Built
+// in, and not turned down at runtime through `log_levels`
+#define     LOG_ENABLED(level)                  (LOG_BUILT_LEVEL(LOG_MODULE) >= (level) && log_levels[LOG_MODULE] >= (level))
+
+#if LOG_DEFERRED == true
+// Route every call's format string through the dictionary
+#define     LOG_FORMAT_ARG(format)              LOG_FORMAT(format)
+#else
+#define     LOG_FORMAT_ARG(format)              format
+#endif
+
+// NOTE These hide the functions of the same names: a call's arguments
+//      are only evaluated if the message will be logged
+#define     server_log(format, ...)             do { if (LOG_ENABLED(LOG_LEVEL_DEBUG)) (server_log)(LOG_FORMAT_ARG(format), ##__VA_ARGS__); } while (0)
+#define     server_error(format, ...)           do { if (LOG_ENABLED(LOG_LEVEL_ERROR)) (server_error)(LOG_FORMAT_ARG(format), ##__VA_ARGS__); } while (0)
+
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
+/*
+ * GLOBALS
+ */
+// Each module's level at runtime, initially as built. Set an entry from
+// a debugger to quieten a module, eg. `set var log_levels[1] = 1` to log
+// only HTTP errors. NOTE Raising one above its built level has no effect
+extern volatile uint8_t log_levels[LOG_MODULE_COUNT];
+
+
 /*
  * PROTOTYPES
  */
-void server_log(const char* format_string, ...)        __attribute__ ((__format__ (__printf__, 1, 2)));
-void server_error(const char* format_string, ...)      __attribute__ ((__format__ (__printf__, 1, 2)));
+void (server_log)(const char* format_string, ...)      __attribute__ ((__format__ (__printf__, 1, 2)));
+void (server_error)(const char* format_string, ...)    __attribute__ ((__format__ (__printf__, 1, 2)));
 void do_assert(bool condition, const char* message);
+void log_service(void);
+void log_flush(void);
+bool log_has_pending(void);
+void log_get_stats(struct LogStats* stats);
+void log_report(void);
+
+uint32_t log_format_text(char* buffer, uint32_t size, bool is_err, const char* format_string, va_list args, bool* truncated);
+uint32_t log_format_deferred(char* buffer, uint32_t size, bool is_err, const char* format_string, va_list args);
+uint32_t log_armor(char* buffer, uint32_t size, char marker, const uint8_t* record, uint32_t length);
 
 
 #ifdef __cplusplus
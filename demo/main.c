@@ -13,7 +13,14 @@
  * STATIC PROTOTYPES
  */
 static void gpio_init(void);
-static void process_http_response(void);
+static void process_http_response(const struct HttpResponse* response, void* context);
+static bool parse_body_chunk(const uint8_t* chunk, uint32_t length, uint32_t offset, void* context);
+static void read_todo_value(const struct JsonValue* value, void* context);
+static void flash_led(void);
+static void send_request(void);
+static void sample_telemetry(void);
+static bool has_work(void);
+static void report_metrics(void);
 
 
 /*
@@ -21,13 +28,16 @@ static void process_http_response(void);
  */
 static bool reset_count = false;
 
-/**
- *  Theses variables may be changed by interrupt handler code,
- *  so we mark them as `volatile` to ensure compiler optimization
- *  doesn't render them immutable at runtime
- */
-volatile bool received_request = false;
-volatile bool channel_was_closed = false;
+// Remote debug demo variables
+static uint32_t store = 42;
+
+// The todo fields we parse out of each response, in `enum TodoPath` order
+static const char* const todo_paths[] = { "id", "title", "completed" };
+enum TodoPath {
+    TODO_PATH_ID = 0,
+    TODO_PATH_TITLE,
+    TODO_PATH_COMPLETED
+};
 
 
 /**
@@ -35,9 +45,15 @@ volatile bool channel_was_closed = false;
  */
 int main(void) {
 
+    // Paint the stack so its high-water mark can be measured
+    mem_paint_stack();
+
     // Reset of all peripherals, Initializes the Flash interface and the sys tick.
     HAL_Init();
 
+    // Start the cycle counter for PROFILE_SCOPE()
+    profile_init();
+
     // Configure the system clock
     system_clock_config();
 
@@ -54,95 +70,125 @@ int main(void) {
     // Set up channel notifications
     http_setup_notification_center();
 
-    // Start the network
-    net_open_network();
+    // Recover HTTP requests stored in flash before a reset
+    spool_init();
+    if (spool_pending() > 0) server_log("%lu HTTP requests stored in flash", spool_pending());
 
-    // Tick counters
-    uint64_t kill_tick = 0;
-    uint64_t last_send_tick = 0;
-    uint64_t last_led_flash_tick = 0;
-    uint64_t tick = 0;
-    enum MvStatus result = MV_STATUS_OKAY;
+    // Start the network. Microvisor connects in the background, while
+    // the main loop runs: requests wait in the queue until it's up
+    net_open_network();
 
-    // HTTP channel management
-    bool do_close_channel = false;
+    // Register the periodic jobs and run the main loop
+    sched_init();
+    sched_set_idle(log_service);
+    sched_add(flash_led, LED_FLASH_PERIOD_US, LED_FLASH_PERIOD_US);
+    sched_add(send_request, REQUEST_SEND_PERIOD_US, REQUEST_SEND_PERIOD_US);
+    sched_add(sample_telemetry, TELEMETRY_SAMPLE_PERIOD_US / 2, TELEMETRY_SAMPLE_PERIOD_US);
+    sched_add(report_metrics, SCHED_REPORT_PERIOD_US, SCHED_REPORT_PERIOD_US);
+    sched_add(mem_scan, MEM_SCAN_PERIOD_US, MEM_SCAN_PERIOD_US);
 
-    // Remote debug demo variables
-    uint32_t store = 42;
     server_log("Debug test variable start value: %lu", store);
 
     // Main program loop
     while (1) {
-        enum MvStatus status = mvGetMicroseconds(&tick);
-        if (status == MV_STATUS_OKAY && tick - last_led_flash_tick > LED_FLASH_PERIOD_US) {
-            // Toggle the USER LED's GPIO pin every LED_FLASH_PERIOD_US microseconds
-            HAL_GPIO_TogglePin(LED_GPIO_BANK, LED_GPIO_PIN);
-            last_led_flash_tick = tick;
-        }
+        {
+            PROFILE_SCOPE("main_loop");
 
-        // Send a periodic HTTP request
-        if (status == MV_STATUS_OKAY && tick - last_send_tick > REQUEST_SEND_PERIOD_US) {
-
-            /* **********************************************
-             *
-             * Remote Debug Demo Entry Point
-             * Step into this function with GDB's 's' command
-             *
-             * **********************************************
-             */
-            debug_function_parent(&store);
-            server_log("Debug test variable value: %lu", store);
-
-            // No channel open? Try and send the temperature
-            if (http_get_handle() == 0 && http_open_channel()) {
-                result = http_send_request(reset_count);
-                if (reset_count) reset_count = false;
-                if (result > 0) do_close_channel = true;
-                kill_tick = tick;
-            } else {
-                server_error("Channel handle not zero");
-            }
+            // Run any jobs that have fallen due
+            sched_dispatch();
+
+            // Track the network connection
+            net_service();
 
-            last_send_tick = tick;
+            // Hand responses to their callbacks and send queued requests
+            http_service();
         }
 
-        // Respond to unexpected channel closure
-        if (channel_was_closed) {
-            enum MvClosureReason reason = 0;
-            if (mvGetChannelClosureReason(http_get_handle(), &reason) == MV_STATUS_OKAY) {
-                server_error("Channel closed for reason: %lu", (uint32_t)reason);
-            } else {
-                server_error("channel closed for unknown reason");
-            }
+        // Output queued log messages, then sleep until
+        // the next job falls due or an ISR flags work
+        sched_sleep(has_work);
+    }
+}
 
-            channel_was_closed = false;
-            do_close_channel = true;
-        }
 
-        // Use 'kill_tick' to force-close an open HTTP channel
-        // if it's been left open too long
-        if (kill_tick > 0 && tick - kill_tick > CHANNEL_KILL_PERIOD_US) {
-            server_error("HTTP request timed out");
-            do_close_channel = true;
-        }
+/**
+ * @brief Scheduled job: toggle the USER LED.
+ */
+static void flash_led(void) {
 
-        // Process a request's response if indicated by the ISR
-        if (received_request) {
-            process_http_response();
-        }
+    HAL_GPIO_TogglePin(LED_GPIO_BANK, LED_GPIO_PIN);
+}
 
-        // If we've received a response in an interrupt handler,
-        // we can close the HTTP channel for the time being
-        if (received_request || do_close_channel) {
-            do_close_channel = false;
-            received_request = false;
-            kill_tick = 0;
-            http_close_channel();
-        }
+
+/**
+ * @brief Scheduled job: send a periodic HTTP request.
+ */
+static void send_request(void) {
+
+    /* **********************************************
+     *
+     * Remote Debug Demo Entry Point
+     * Step into this function with GDB's 's' command
+     *
+     * **********************************************
+     */
+    debug_function_parent(&store);
+    server_log("Debug test variable value: %lu", store);
+
+    // Queue the next request. It's sent as soon as a channel is free
+    if (http_send_request(reset_count, process_http_response)) {
+        reset_count = false;
+    } else {
+        server_error("HTTP request not queued");
     }
 }
 
 
+/**
+ * @brief Scheduled job: record the debug test variable for upload.
+ *
+ * Runs between requests, so a telemetry post finds the open channel free.
+ */
+static void sample_telemetry(void) {
+
+    telemetry_sample(store);
+}
+
+
+/**
+ * @brief Check for work the main loop must do before it sleeps.
+ *
+ * @returns `true` if network or HTTP work, or log output, awaits,
+ *          otherwise `false`.
+ */
+static bool has_work(void) {
+
+    return net_has_work() || http_has_work() || log_has_pending();
+}
+
+
+/**
+ * @brief Scheduled job: log the periodic runtime metrics.
+ */
+static void report_metrics(void) {
+
+    sched_report();
+    net_report();
+    http_report_notifications();
+    http_report_latency();
+    http_report_queue();
+    spool_report();
+    cache_report();
+    headers_report();
+    telemetry_report();
+    log_report();
+    log_uart_report();
+    pool_report();
+    mem_report();
+    profile_report();
+}
+
+
 /**
  * @brief Initialize the MCU GPIO.
  *
@@ -191,43 +237,106 @@ bool debug_function_child(uint32_t* vptr) {
 
 /**
  * @brief Process HTTP response data
+ *
+ * @param response: The response, or the reason the request failed.
+ * @param context:  Unused.
  */
-static void process_http_response(void) {
+static void process_http_response(const struct HttpResponse* response, void* context) {
 
-    // We have received data via the active HTTP channel so establish
-    // an `MvHttpResponseData` record to hold response metadata
-    static struct MvHttpResponseData resp_data;
-    enum MvStatus status = mvReadHttpResponseData(http_get_handle(), &resp_data);
+    PROFILE_SCOPE("process_http_response");
+    UNUSED(context);
+
+    // The engine has already read the response metadata
+    const struct MvHttpResponseData* resp_data = &response->data;
+    enum MvStatus status = response->status;
     if (status == MV_STATUS_OKAY) {
         // Check we successfully issued the request (`result` is OK) and
         // the request was successful (status code 200)
-        if (resp_data.result == MV_HTTPRESULT_OK) {
-            if (resp_data.status_code == 200) {
-                server_log("HTTP response received. Body length: %lu bytes, %lu headers", resp_data.body_length, resp_data.num_headers);
-
-                // Set up a buffer that we'll get Microvisor to write
-                // the response body into
-                uint8_t buffer[resp_data.body_length + 1];
-                memset((void *)buffer, 0x00, resp_data.body_length + 1);
-                status = mvReadHttpResponseBody(http_get_handle(), 0, buffer, resp_data.body_length);
-                if (status == MV_STATUS_OKAY) {
-                    // Retrieved the body data successfully so log it
-                    server_log("Message JSON:\n%s", buffer);
-                } else {
+        if (resp_data->result == MV_HTTPRESULT_OK) {
+            if (resp_data->status_code == 200) {
+                const char* type = headers_get(response->headers, "Content-Type");
+                server_log("HTTP response received. Body length: %lu bytes, type: %s", resp_data->body_length, type != NULL ? type : "unknown");
+
+                // Parse the body as it's read, a chunk at a time
+                struct Todo todo = { 0 };
+                struct JsonParser parser;
+                json_init(&parser, todo_paths, 3, read_todo_value, &todo);
+                status = http_read_body(response, parse_body_chunk, &parser);
+                if (status != MV_STATUS_OKAY) {
                     server_error("HTTP response body read status %i", status);
+                } else if (json_finish(&parser) != JSON_DONE) {
+                    server_error("HTTP response body is not valid JSON");
+                } else {
+                    server_log("Todo %lu: \"%s\" (%s)", todo.id, todo.title, todo.completed ? "completed" : "not completed");
+                    http_cache_put(response, &todo, sizeof(todo));
                 }
-            } else if (resp_data.status_code == 404) {
+            } else if (resp_data->status_code == 304 && response->cached != NULL) {
+                // Unchanged since we last fetched it: use the todo parsed then
+                const struct Todo* todo = (const struct Todo*)response->cached;
+                server_log("Todo %lu: \"%s\" (%s), not modified", todo->id, todo->title, todo->completed ? "completed" : "not completed");
+            } else if (resp_data->status_code == 404) {
                 // Reached the end of available items, so reset the counter
                 reset_count = true;
                 server_log("Resetting ping count");
             } else {
-                server_error("HTTP status code: %lu", resp_data.status_code);
+                server_error("HTTP status code: %lu", resp_data->status_code);
             }
         } else {
-            server_error("Request failed. Status: %i", resp_data.result);
+            server_error("Request failed. Status: %i", resp_data->result);
         }
     } else {
-        server_error("Response data read failed. Status: %i", status);
+        server_error("Request not completed. Status: %i", status);
+    }
+}
+
+
+/**
+ * @brief Pass one chunk of a response body to the JSON parser.
+ *
+ * @param chunk:   The body data.
+ * @param length:  The size of the chunk in bytes.
+ * @param offset:  The chunk's position in the body.
+ * @param context: The parser.
+ *
+ * @returns `false` to stop reading once the parser has failed, otherwise `true`.
+ */
+static bool parse_body_chunk(const uint8_t* chunk, uint32_t length, uint32_t offset, void* context) {
+
+    UNUSED(offset);
+    enum JsonStatus status = json_feed((struct JsonParser*)context, chunk, length);
+    return status == JSON_OK || status == JSON_DONE;
+}
+
+
+/**
+ * @brief Store a todo field found by the JSON parser.
+ *
+ * @param value:   The matched value, or a fragment of it.
+ * @param context: The `Todo` record to fill.
+ */
+static void read_todo_value(const struct JsonValue* value, void* context) {
+
+    struct Todo* todo = (struct Todo*)context;
+    switch (value->path) {
+        case TODO_PATH_ID:
+            todo->id = 0;
+            for (uint32_t i = 0 ; i < value->length && value->data[i] >= '0' && value->data[i] <= '9' ; ++i) {
+                todo->id = todo->id * 10 + (value->data[i] - '0');
+            }
+            break;
+        case TODO_PATH_TITLE:
+            // Titles arrive in fragments: keep what fits
+            if (value->type != JSON_TYPE_STRING) break;
+            for (uint32_t i = 0 ; i < value->length && todo->title_length < TODO_TITLE_MAX_LEN_B - 1 ; ++i) {
+                todo->title[todo->title_length++] = value->data[i];
+            }
+            todo->title[todo->title_length] = 0;
+            break;
+        case TODO_PATH_COMPLETED:
+            todo->completed = value->type == JSON_TYPE_TRUE;
+            break;
+        default:
+            break;
     }
 }
 
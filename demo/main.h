@@ -14,6 +14,7 @@
  * INCLUDES
  */
 #include <string.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -29,10 +30,23 @@
 
 // App includes
 #include "logging.h"
+#include "memory.h"
+#include "nc_ring.h"
+#include "pool.h"
+#include "profile.h"
+#include "json.h"
+#include "cbor.h"
+#include "compress.h"
+#include "timestamp.h"
 #include "uart_logging.h"
+#include "cache.h"
+#include "headers.h"
 #include "http.h"
 #include "network.h"
 #include "generic.h"
+#include "scheduler.h"
+#include "spool.h"
+#include "telemetry.h"
 
 
 /*
@@ -44,6 +58,21 @@
 #define     REQUEST_SEND_PERIOD_US      30000 * 1000
 #define     CHANNEL_KILL_PERIOD_US      15000 * 1000
 #define     LED_FLASH_PERIOD_US         250 * 1000
+#define     TELEMETRY_SAMPLE_PERIOD_US  30000 * 1000
+
+#define     TODO_TITLE_MAX_LEN_B        64
+
+
+/*
+ * TYPES
+ */
+// The fields we extract from a jsonplaceholder todo
+struct Todo {
+    uint32_t    id;
+    char        title[TODO_TITLE_MAX_LEN_B];
+    uint32_t    title_length;
+    bool        completed;
+};
 
 
 #ifdef __cplusplus
@@ -0,0 +1,124 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static uint32_t* mem_heap_end(void);
+
+
+/*
+ * GLOBALS
+ */
+#if MEM_STACK_WINDOW_B == 0
+// The end of .bss, where the heap starts, and the heap's current end.
+// Provided by the linker and `sysmem.c`
+extern char end asm("end");
+extern void* _sbrk(int incr);
+#endif
+
+// The painted region runs from `mem_floor` up to `mem_top`
+static uint32_t* mem_floor = NULL;
+static uint32_t* mem_top = NULL;
+static uint32_t* mem_stack_base = NULL;     // main()'s frame
+static struct MemStats mem_stats = { 0 };
+
+
+/**
+ * @brief Fill the unused stack with MEM_PAINT_WORD.
+ *
+ * Call first thing in `main()`. Every word from the heap end up to
+ * MEM_PAINT_MARGIN_B below this function's frame is painted; `mem_scan()` later finds the
+ * deepest word the stack has overwritten.
+ */
+__attribute__((noinline)) void mem_paint_stack(void) {
+
+    uint32_t marker = 0;
+    mem_stack_base = (uint32_t*)((uintptr_t)&marker & ~(uintptr_t)3);
+    mem_top = (uint32_t*)((uintptr_t)mem_stack_base - MEM_PAINT_MARGIN_B);
+
+#if MEM_STACK_WINDOW_B == 0
+    mem_floor = mem_heap_end();
+#else
+    mem_floor = (uint32_t*)((uintptr_t)mem_stack_base - MEM_STACK_WINDOW_B);
+#endif
+
+    // Volatile, so the compiler can't hand the loop to memset(), whose
+    // frame would be painted over
+    for (volatile uint32_t* word = mem_floor ; word < mem_top ; ++word) *word = MEM_PAINT_WORD;
+    mem_stats.stack_b = (uint32_t)((uintptr_t)mem_stack_base - (uintptr_t)mem_floor);
+}
+
+
+/**
+ * @brief Find the stack's deepest point and the heap's end.
+ *
+ * Scans up from the heap end to the first overwritten word. Runs as a
+ * scheduler job every MEM_SCAN_PERIOD_US, so the figures reflect the
+ * worst case seen, not just the moment of reporting.
+ */
+void mem_scan(void) {
+
+    if (mem_top == NULL) return;
+
+    uint32_t* heap_end = mem_heap_end();
+    uint32_t* word = heap_end > mem_floor ? heap_end : mem_floor;
+    while (word < mem_top && *word == MEM_PAINT_WORD) word++;
+
+    uint32_t peak = (uint32_t)((uintptr_t)mem_stack_base - (uintptr_t)word);
+    if (peak > mem_stats.stack_peak_b) mem_stats.stack_peak_b = peak;
+    mem_stats.headroom_b = (uint32_t)((uintptr_t)word - (uintptr_t)(heap_end > mem_floor ? heap_end : mem_floor));
+    mem_stats.heap_b = 0;
+#if MEM_STACK_WINDOW_B == 0
+    mem_stats.heap_b = (uint32_t)((uintptr_t)heap_end - (uintptr_t)&end);
+#endif
+    mem_stats.scans++;
+}
+
+
+/**
+ * @brief Copy out the latest scan's figures.
+ *
+ * @param stats: Pointer to the record to fill.
+ */
+void mem_get_stats(struct MemStats* stats) {
+
+    *stats = mem_stats;
+}
+
+
+/**
+ * @brief Log the stack and heap figures as one compact record.
+ *
+ * Use the stack peak to size the stack and the buffers that live on it;
+ * zero headroom means the stack has reached the heap.
+ */
+void mem_report(void) {
+
+    mem_scan();
+    server_log("Memory: stack peak %lu of %lu B, heap %lu B, headroom %lu B (%u B log slots, %u B HTTP buffers)",
+               mem_stats.stack_peak_b, mem_stats.stack_b, mem_stats.heap_b, mem_stats.headroom_b,
+               LOG_RING_SLOT_SIZE_B, HTTP_RX_BUFFER_SIZE_B);
+}
+
+
+/**
+ * @brief Get the heap's current end, word-aligned.
+ */
+static uint32_t* mem_heap_end(void) {
+
+#if MEM_STACK_WINDOW_B == 0
+    uintptr_t heap_end = (uintptr_t)_sbrk(0);
+    return (uint32_t*)((heap_end + 3) & ~(uintptr_t)3);
+#else
+    return mem_floor;
+#endif
+}
@@ -0,0 +1,59 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _MEMORY_H_
+#define _MEMORY_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     MEM_PAINT_WORD              0xC0FFEE55UL
+#define     MEM_PAINT_MARGIN_B          256           // Left unpainted below the painter's frame
+#define     MEM_SCAN_PERIOD_US          60ULL * 1000 * 1000
+
+// The stack may grow down until it meets the heap. Set a non-zero size
+// to treat only that much of the stack below `main()` as ours, and ignore
+// the heap -- as the simulator, whose host process has its own, does
+#ifndef MEM_STACK_WINDOW_B
+#define     MEM_STACK_WINDOW_B          0
+#endif
+
+
+/*
+ * TYPES
+ */
+struct MemStats {
+    uint32_t    stack_b;            // Room between main()'s frame and the heap end at startup
+    uint32_t    stack_peak_b;       // Deepest stack use seen
+    uint32_t    heap_b;             // Heap grown by _sbrk()
+    uint32_t    headroom_b;         // Untouched gap between stack and heap at the last scan
+    uint32_t    scans;
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        mem_paint_stack(void);
+void        mem_scan(void);
+void        mem_get_stats(struct MemStats* stats);
+void        mem_report(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _MEMORY_H_
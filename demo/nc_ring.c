@@ -0,0 +1,89 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/**
+ * @brief Attach a ring to a notification center's buffer and clear it.
+ *
+ * Call this before passing the buffer to `mvSetupNotifications()`.
+ *
+ * @param ring:       The ring record.
+ * @param buffer:     The notification center's record store.
+ * @param size_bytes: The size of the store in bytes.
+ */
+void nc_ring_init(struct NcRing* ring, struct MvNotification* buffer, uint32_t size_bytes) {
+
+    memset((void *)buffer, 0x00, size_bytes);
+    memset((void *)ring, 0x00, sizeof(struct NcRing));
+    ring->buffer = buffer;
+    ring->size = size_bytes / sizeof(struct MvNotification);
+}
+
+
+/**
+ * @brief Consume every pending notification.
+ *
+ * Call from the notification center's ISR. Each record is copied out
+ * and passed to `handler`, then its `event_type` is zeroed in place to
+ * hand the slot back to Microvisor.
+ * See https://www.twilio.com/docs/iot/microvisor/microvisor-notifications#buffer-overruns
+ *
+ * @param ring:    The ring record.
+ * @param handler: Function called with each record, in arrival order.
+ *
+ * @returns The number of records consumed.
+ */
+uint32_t nc_ring_drain(struct NcRing* ring, nc_ring_handler handler) {
+
+    uint32_t count = 0;
+    uint32_t tail = ring->tail;
+
+    while (count < ring->size) {
+        volatile struct MvNotification* slot = &ring->buffer[tail];
+        if (slot->event_type == 0) break;
+
+        // Don't read the record's other fields ahead of its `event_type`
+        __DMB();
+        struct MvNotification notification = {
+            .microseconds = slot->microseconds,
+            .event_type   = slot->event_type,
+            .tag          = slot->tag
+        };
+
+        // Finish reading the record before releasing it to Microvisor
+        __DMB();
+        slot->event_type = 0;
+
+        tail = (tail + 1) % ring->size;
+        count++;
+        handler(&notification);
+    }
+
+    ring->tail = tail;
+    ring->stats.received += count;
+    if (count > ring->stats.high_water) ring->stats.high_water = count;
+
+    // Every slot was full, so Microvisor had nowhere to write:
+    // records may have been dropped since the last drain
+    if (count == ring->size) ring->stats.overruns++;
+    return count;
+}
+
+
+/**
+ * @brief Copy out a ring's counters.
+ *
+ * @param ring:  The ring record.
+ * @param stats: Pointer to the record to fill.
+ */
+void nc_ring_get_stats(const struct NcRing* ring, struct NcRingStats* stats) {
+
+    *stats = ring->stats;
+}
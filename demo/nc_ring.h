@@ -0,0 +1,54 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _NC_RING_H_
+#define _NC_RING_H_
+
+
+/*
+ * TYPES
+ */
+typedef void (*nc_ring_handler)(const struct MvNotification* notification);
+
+struct NcRingStats {
+    uint32_t    received;           // Records consumed
+    uint32_t    overruns;           // Drains that found every record full
+    uint32_t    high_water;         // Most records consumed by one drain
+};
+
+// Consumer side of a Microvisor notification center. Microvisor is the
+// single producer: it writes records in order and owns the head, which
+// the app never sees -- a non-zero `event_type` marks a record as ready.
+// The app is the single consumer and owns the tail.
+struct NcRing {
+    struct MvNotification*  buffer;
+    uint32_t                size;   // In records
+    volatile uint32_t       tail;
+    struct NcRingStats      stats;
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        nc_ring_init(struct NcRing* ring, struct MvNotification* buffer, uint32_t size_bytes);
+uint32_t    nc_ring_drain(struct NcRing* ring, nc_ring_handler handler);
+void        nc_ring_get_stats(const struct NcRing* ring, struct NcRingStats* stats);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _NC_RING_H_
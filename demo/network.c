@@ -6,6 +6,7 @@
  * Licence: MIT
  *
  */
+#define     LOG_MODULE      LOG_MODULE_NET
 #include "main.h"
 
 
@@ -13,6 +14,14 @@
  * STATIC PROTOTYPES
  */
 static void net_setup_notification_center(void);
+static void net_process_notification(const struct MvNotification* notification);
+static void net_update_state(void);
+static void net_request(void);
+static void net_lost(void);
+static void net_retry(void);
+static void net_schedule_retry(void);
+static uint32_t net_seed(uint64_t tick);
+static uint64_t net_now(void);
 
 
 /*
@@ -28,10 +37,29 @@ static struct {
 // Central store for network management notification records.
 // Holds 'NET_NC_BUFFER_SIZE_R' records at a time -- each record is 16 bytes in size.
 static struct MvNotification net_notification_buffer[NET_NC_BUFFER_SIZE_R] __attribute__((aligned(8)));
+static struct NcRing net_notification_ring;
+
+// Connection state. The ISR only flags a status change: the main loop
+// reads the new status, as system calls don't belong in an ISR
+static enum NetState net_state = NET_STATE_OFFLINE;
+static volatile bool net_status_changed = false;
+static volatile uint64_t net_event_tick = 0;
+static uint64_t net_request_tick = 0;
+static struct NetStats net_stats = { 0 };
+
+// Reconnection engine
+static uint64_t net_backoff_us = NET_BACKOFF_MIN_US;
+static uint64_t net_offline_tick = 0;
+static uint32_t net_jitter = 0;
+static SchedJobId net_retry_job = SCHED_JOB_NONE;
 
 
 /**
- * @brief Configure and connect to the network.
+ * @brief Ask Microvisor to connect to the network.
+ *
+ * Returns at once: Microvisor attaches asynchronously and posts a
+ * notification when the connection's status changes, which
+ * `net_service()` acts on. Until then, `net_is_connected()` is `false`.
  */
 void net_open_network(void) {
 
@@ -39,38 +67,205 @@ void net_open_network(void) {
     net_setup_notification_center();
 
     if (net_handles.network == 0) {
-        // Configure the network connection request
-        const struct MvRequestNetworkParams network_config = {
-            .version = 1,
-            .v1 = {
-                .notification_handle = net_handles.notification,
-                .notification_tag = USER_TAG_LOGGING_REQUEST_NETWORK,
-            }
-        };
+        net_request_tick = net_now();
+        net_jitter = net_seed(net_request_tick);
+        net_request();
+    }
+}
 
-        // Ask Microvisor to establish the network connection
-        // and confirm that it has accepted the request
-        enum MvStatus status = mvRequestNetwork(&network_config, &net_handles.network);
-        do_assert(status == MV_STATUS_OKAY, "Could not open network");
-
-        // The network connection is established by Microvisor asynchronously,
-        // so we wait for it to come up before opening the data channel -- which
-        // would fail otherwise
-        enum MvNetworkStatus net_status;
-        while (1) {
-            // Request the status of the network connection, identified by its handle.
-            // If we're good to continue, break out of the loop...
-            if (mvGetNetworkStatus(net_handles.network, &net_status) == MV_STATUS_OKAY && net_status == MV_NETWORKSTATUS_CONNECTED) {
-                break;
-            }
-
-            // ... or wait a short period before retrying
-            for (size_t i = 0; i < 50000; ++i) {
-                // No op
-                __asm("nop");
-            }
+
+/**
+ * @brief Request the network connection.
+ */
+static void net_request(void) {
+
+    // Configure the network connection request
+    const struct MvRequestNetworkParams network_config = {
+        .version = 1,
+        .v1 = {
+            .notification_handle = net_handles.notification,
+            .notification_tag = USER_TAG_LOGGING_REQUEST_NETWORK,
         }
+    };
+
+    // Ask Microvisor to establish the network connection
+    // and confirm that it has accepted the request
+    enum MvStatus status = mvRequestNetwork(&network_config, &net_handles.network);
+    do_assert(status == MV_STATUS_OKAY, "Could not open network");
+    net_state = NET_STATE_CONNECTING;
+
+    // The network may already be up, in which case
+    // no notification will come: check now
+    net_event_tick = net_now();
+    net_status_changed = true;
+}
+
+
+/**
+ * @brief Act on a change in the network's status.
+ *
+ * Call from the main loop.
+ */
+void net_service(void) {
+
+    if (net_status_changed) {
+        net_status_changed = false;
+        net_update_state();
+    }
+}
+
+
+/**
+ * @brief Check for a network status change awaiting `net_service()`.
+ *
+ * @returns `true` if there is one, otherwise `false`.
+ */
+bool net_has_work(void) {
+
+    return net_status_changed;
+}
+
+
+/**
+ * @brief Check the network connection.
+ *
+ * @returns `true` if the network is connected, otherwise `false`.
+ */
+bool net_is_connected(void) {
+
+    return net_state == NET_STATE_CONNECTED;
+}
+
+
+/**
+ * @brief Read the network's status and move to the matching state.
+ */
+static void net_update_state(void) {
+
+    enum MvNetworkStatus status = MV_NETWORKSTATUS_DELIBERATELYOFFLINE;
+    if (mvGetNetworkStatus(net_handles.network, &status) != MV_STATUS_OKAY) return;
+
+    if (status == MV_NETWORKSTATUS_CONNECTED && net_state != NET_STATE_CONNECTED) {
+        net_state = NET_STATE_CONNECTED;
+        if (net_retry_job != SCHED_JOB_NONE) {
+            sched_cancel(net_retry_job);
+            net_retry_job = SCHED_JOB_NONE;
+        }
+
+        // Timed by the notification, not by when the main loop got to it
+        uint64_t tick = net_event_tick;
+        if (net_stats.connects++ == 0) {
+            net_stats.connect_us = tick > net_request_tick ? tick - net_request_tick : 0;
+            server_log("Network connected in %lu us", (uint32_t)net_stats.connect_us);
+        } else {
+            uint64_t offline_us = tick > net_offline_tick ? tick - net_offline_tick : 0;
+            net_stats.offline_us += offline_us;
+            net_stats.reconnects++;
+            server_log("Network reconnected after %lu ms offline", (uint32_t)(offline_us / 1000));
+        }
+
+        net_backoff_us = NET_BACKOFF_MIN_US;
+    } else if (status != MV_NETWORKSTATUS_CONNECTED && net_state == NET_STATE_CONNECTED) {
+        net_offline_tick = net_event_tick;
+        net_lost();
+    }
+}
+
+
+/**
+ * @brief Report that the network failed the app, eg. that a channel
+ *        could not be opened, though Microvisor reports a connection.
+ *
+ * Treated as a loss: sends pause while the connection is retried.
+ */
+void net_report_failure(void) {
+
+    if (net_state == NET_STATE_CONNECTED) {
+        net_offline_tick = net_now();
+        net_lost();
+    }
+}
+
+
+/**
+ * @brief Pause on losing the network, and schedule a reconnection attempt.
+ */
+static void net_lost(void) {
+
+    net_state = NET_STATE_WAITING;
+    net_stats.disconnects++;
+    server_error("Network disconnected");
+    net_schedule_retry();
+}
+
+
+/**
+ * @brief Scheduled job: try to reconnect.
+ *
+ * Microvisor may restore the connection on its own before this runs,
+ * in which case the job is cancelled. Otherwise the network request is
+ * released and made afresh, and the next attempt scheduled further off
+ * in case this one doesn't succeed.
+ */
+static void net_retry(void) {
+
+    net_retry_job = SCHED_JOB_NONE;
+
+    enum MvNetworkStatus status = MV_NETWORKSTATUS_DELIBERATELYOFFLINE;
+    if (mvGetNetworkStatus(net_handles.network, &status) == MV_STATUS_OKAY && status == MV_NETWORKSTATUS_CONNECTED) {
+        // It's back, or was never really gone
+        net_event_tick = net_now();
+        net_update_state();
+        return;
     }
+
+    net_stats.attempts++;
+    server_log("Network reconnection attempt %lu", net_stats.attempts);
+    mvReleaseNetwork(&net_handles.network);
+    net_request();
+    net_schedule_retry();
+}
+
+
+/**
+ * @brief Seed the jitter generator.
+ *
+ * Devices running the same firmware reach this point at almost the same
+ * tick, so the seed is mostly the device's ID, which is unique to it.
+ *
+ * @param tick: The time of the first network request.
+ *
+ * @returns A non-zero seed.
+ */
+static uint32_t net_seed(uint64_t tick) {
+
+    uint8_t id[34] = { 0 };
+    mvGetDeviceId(id, sizeof(id));
+
+    // FNV-1a over the ID, then the tick
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0 ; i < sizeof(id) ; ++i) hash = (hash ^ id[i]) * 16777619u;
+    hash = (hash ^ (uint32_t)tick) * 16777619u;
+    return hash != 0 ? hash : 1;
+}
+
+
+/**
+ * @brief Schedule the next reconnection attempt, and double the backoff.
+ */
+static void net_schedule_retry(void) {
+
+    // xorshift32: plenty for jitter
+    net_jitter ^= net_jitter << 13;
+    net_jitter ^= net_jitter >> 17;
+    net_jitter ^= net_jitter << 5;
+
+    uint64_t half = net_backoff_us / 2;
+    uint64_t delay = half + net_jitter % (half + 1);
+    if (net_retry_job == SCHED_JOB_NONE) net_retry_job = sched_add(net_retry, delay, 0);
+
+    net_backoff_us *= 2;
+    if (net_backoff_us > NET_BACKOFF_MAX_US) net_backoff_us = NET_BACKOFF_MAX_US;
 }
 
 
@@ -80,8 +275,8 @@ void net_open_network(void) {
 static void net_setup_notification_center(void) {
 
     if (net_handles.notification == 0) {
-        // Clear the notification store
-        memset((void*)net_notification_buffer, 0xff, sizeof(net_notification_buffer));
+        // Clear the notification store and attach the consumer ring to it
+        nc_ring_init(&net_notification_ring, net_notification_buffer, sizeof(net_notification_buffer));
 
         // Configure a notification center for network-centric notifications
         const struct MvNotificationSetup net_notification_config = {
@@ -115,12 +310,59 @@ MvNetworkHandle net_get_handle(void) {
 
 
 /**
- * @brief Network notification ISR.
+ * @brief Copy out the network counters.
+ *
+ * @param stats: Pointer to the record to fill.
  */
-void TIM2_IRQHandler(void) {
+void net_get_stats(struct NetStats* stats) {
+
+    *stats = net_stats;
+}
+
+
+/**
+ * @brief Log the network counters.
+ */
+void net_report(void) {
+
+    uint64_t offline_us = net_stats.offline_us;
+    if (net_state != NET_STATE_CONNECTED && net_stats.connects > 0) offline_us += net_now() - net_offline_tick;
+
+    server_log("Network: %s, connected in %lu us, %lu disconnects, %lu attempts, %lu reconnects, %lu s offline",
+               net_state == NET_STATE_CONNECTED ? "online" : "offline", (uint32_t)net_stats.connect_us,
+               net_stats.disconnects, net_stats.attempts, net_stats.reconnects, (uint32_t)(offline_us / 1000000));
+}
+
+
+/**
+ * @brief Read the Microvisor microsecond clock.
+ */
+static uint64_t net_now(void) {
 
-    // Network notifications interrupt service handler
-    // Add your own notification processing code here
+    uint64_t tick = 0;
+    mvGetMicroseconds(&tick);
+    return tick;
 }
 
 
+/**
+ * @brief Record a network notification. Called from the ISR.
+ */
+static void net_process_notification(const struct MvNotification* notification) {
+
+    if (notification->event_type == MV_EVENTTYPE_NETWORKSTATUSCHANGED) {
+        net_event_tick = notification->microseconds;
+        net_status_changed = true;
+    }
+}
+
+
+/**
+ * @brief Network notification ISR.
+ *
+ * Microvisor may post several records before we get here, so consume them all.
+ */
+void TIM2_IRQHandler(void) {
+
+    nc_ring_drain(&net_notification_ring, net_process_notification);
+}
@@ -15,6 +15,32 @@
  */
 #define     NET_NC_BUFFER_SIZE_R                8
 
+// Reconnection attempts back off exponentially between these limits.
+// Each delay is jittered to between half and all of the backoff, so a
+// fleet that lost the network together doesn't retry in step
+#define     NET_BACKOFF_MIN_US                  5ULL * 1000 * 1000
+#define     NET_BACKOFF_MAX_US                  320ULL * 1000 * 1000
+
+
+/*
+ * TYPES
+ */
+enum NetState {
+    NET_STATE_OFFLINE = 0,          // Not yet requested
+    NET_STATE_CONNECTING,           // Requested; Microvisor is attaching
+    NET_STATE_CONNECTED,
+    NET_STATE_WAITING               // Lost; backing off before the next attempt
+};
+
+struct NetStats {
+    uint64_t    connect_us;         // Request to first connection
+    uint64_t    offline_us;         // Time spent disconnected since the first connection
+    uint32_t    connects;
+    uint32_t    disconnects;        // Includes failures reported by `net_report_failure()`
+    uint32_t    attempts;           // Network requests re-made after a loss
+    uint32_t    reconnects;
+};
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,7 +51,13 @@ extern "C" {
  * PROTOTYPES
  */
 void            net_open_network(void);
+void            net_service(void);
+bool            net_has_work(void);
+bool            net_is_connected(void);
+void            net_report_failure(void);
 MvNetworkHandle net_get_handle(void);
+void            net_get_stats(struct NetStats* stats);
+void            net_report(void);
 
 
 #ifdef __cplusplus
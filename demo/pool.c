@@ -0,0 +1,348 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+#if POOL_HOOK_MALLOC == true
+#include <reent.h>
+#endif
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     pool_init(void);
+static uint32_t pool_class_of(size_t size);
+static uint32_t pool_find(const uint8_t* block);
+
+
+/*
+ * TYPES
+ */
+// A free block holds a pointer to the next free block in its class
+struct PoolFreeBlock {
+    struct PoolFreeBlock*   next;
+};
+
+struct PoolClass {
+    uint8_t*                base;           // The class' first block in the arena
+    struct PoolFreeBlock*   free;           // Blocks returned by `pool_free()`
+    uint16_t                first;          // The index of the class' first block in `pool_requested`
+    uint16_t                carved;         // Blocks handed out at least once
+};
+
+
+/*
+ * GLOBALS
+ */
+// The heap: every allocation comes from here, and it never grows
+static uint8_t  pool_arena[POOL_ARENA_SIZE_B] __attribute__((aligned(8)));
+
+static const uint16_t pool_block_counts[POOL_CLASS_COUNT] = {
+    POOL_BLOCKS_16B, POOL_BLOCKS_32B, POOL_BLOCKS_64B, POOL_BLOCKS_128B, POOL_BLOCKS_256B
+};
+
+static struct PoolClass pool_classes[POOL_CLASS_COUNT];
+static bool pool_ready = false;
+
+// The size asked for by each block's current allocation
+static uint16_t pool_requested[POOL_BLOCK_TOTAL];
+static struct PoolStats pool_stats = { 0 };
+
+
+/**
+ * @brief Allocate a block from the pool.
+ *
+ * O(1): the request is rounded up to its size class and takes that
+ * class' most recently freed block, or its next never-used one. If the
+ * class is exhausted, the next larger class is tried. Safe to call
+ * from any context: interrupts are masked while the pool is updated,
+ * then left as the caller had them.
+ *
+ * @param size: The number of bytes required.
+ *
+ * @returns The block, or `NULL` if no block is free or `size` exceeds
+ *          POOL_MAX_BLOCK_SIZE_B.
+ */
+void* pool_alloc(size_t size) {
+
+    if (size > POOL_MAX_BLOCK_SIZE_B) {
+        __atomic_fetch_add(&pool_stats.failed, 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+
+    uint8_t* block = NULL;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!pool_ready) pool_init();
+
+    for (uint32_t i = pool_class_of(size) ; i < POOL_CLASS_COUNT ; ++i) {
+        struct PoolClass* class = &pool_classes[i];
+        struct PoolClassStats* stats = &pool_stats.classes[i];
+        uint32_t index = 0;
+        if (class->free != NULL) {
+            block = (uint8_t*)class->free;
+            class->free = class->free->next;
+            index = (uint32_t)(block - class->base) / stats->block_size_b;
+        } else if (class->carved < stats->blocks) {
+            index = class->carved++;
+            block = class->base + index * stats->block_size_b;
+        } else {
+            stats->spilled++;
+            continue;
+        }
+
+        pool_requested[class->first + index] = (uint16_t)size;
+        stats->allocs++;
+        if (++stats->in_use > stats->high_water) stats->high_water = stats->in_use;
+
+        pool_stats.requested_b += (uint32_t)size;
+        pool_stats.in_use_b += stats->block_size_b;
+        if (pool_stats.in_use_b > pool_stats.high_water_b) pool_stats.high_water_b = pool_stats.in_use_b;
+        break;
+    }
+
+    if (block == NULL) pool_stats.failed++;
+    __set_PRIMASK(primask);
+    return block;
+}
+
+
+/**
+ * @brief Resize an allocation.
+ *
+ * The block is kept if the new size still fits it; otherwise the
+ * contents move to a new block.
+ *
+ * @param block: The block, or `NULL` to allocate a new one.
+ * @param size:  The number of bytes required.
+ *
+ * @returns The block, or `NULL` -- leaving the original intact -- if no
+ *          block is free.
+ */
+void* pool_realloc(void* block, size_t size) {
+
+    if (block == NULL) return pool_alloc(size);
+
+    uint32_t index = pool_find((const uint8_t*)block);
+    if (index == POOL_CLASS_COUNT) return NULL;
+
+    uint32_t offset = pool_classes[index].first + (uint32_t)((uint8_t*)block - pool_classes[index].base) / pool_stats.classes[index].block_size_b;
+    uint32_t old_size = pool_requested[offset];
+    if (size <= pool_stats.classes[index].block_size_b) {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        pool_stats.requested_b = pool_stats.requested_b - old_size + (uint32_t)size;
+        pool_requested[offset] = (uint16_t)size;
+        __set_PRIMASK(primask);
+        return block;
+    }
+
+    void* moved = pool_alloc(size);
+    if (moved != NULL) {
+        memcpy(moved, block, old_size);
+        pool_free(block);
+    }
+
+    return moved;
+}
+
+
+/**
+ * @brief Return a block to the pool.
+ *
+ * @param block: The block, or `NULL`. Pointers the pool did not
+ *               allocate are ignored.
+ */
+void pool_free(void* block) {
+
+    uint32_t index = pool_find((const uint8_t*)block);
+    if (index == POOL_CLASS_COUNT) return;
+
+    struct PoolClass* class = &pool_classes[index];
+    struct PoolClassStats* stats = &pool_stats.classes[index];
+    struct PoolFreeBlock* entry = (struct PoolFreeBlock*)block;
+    uint32_t offset = class->first + (uint32_t)((uint8_t*)block - class->base) / stats->block_size_b;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    entry->next = class->free;
+    class->free = entry;
+    stats->in_use--;
+    pool_stats.requested_b -= pool_requested[offset];
+    pool_stats.in_use_b -= stats->block_size_b;
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief Copy out the pool's counters.
+ *
+ * @param stats: Pointer to the record to fill.
+ */
+void pool_get_stats(struct PoolStats* stats) {
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!pool_ready) pool_init();
+    *stats = pool_stats;
+    __set_PRIMASK(primask);
+
+    // The largest class with a block to spare
+    stats->largest_free_b = 0;
+    for (uint32_t i = 0 ; i < POOL_CLASS_COUNT ; ++i) {
+        if (stats->classes[i].in_use < stats->classes[i].blocks) stats->largest_free_b = stats->classes[i].block_size_b;
+    }
+}
+
+
+/**
+ * @brief Log the pool's counters.
+ *
+ * Internal fragmentation is the share of the blocks in use that their
+ * allocations didn't ask for. Fixed blocks can't fragment externally;
+ * instead, a class runs out. A spill means a larger block was used in
+ * its place: raise the smaller class' POOL_BLOCKS_*. Any failure means
+ * the pool is too small for the app.
+ */
+void pool_report(void) {
+
+    struct PoolStats stats;
+    pool_get_stats(&stats);
+
+    for (uint32_t i = 0 ; i < POOL_CLASS_COUNT ; ++i) {
+        struct PoolClassStats* class = &stats.classes[i];
+        if (class->allocs > 0) {
+            server_log("Pool %lu B blocks: %lu of %lu in use, high-water mark %lu, %lu allocations, %lu spilled",
+                       class->block_size_b, class->in_use, class->blocks, class->high_water,
+                       class->allocs, class->spilled);
+        }
+    }
+
+    uint32_t internal_pct = stats.in_use_b > 0 ? (stats.in_use_b - stats.requested_b) * 100 / stats.in_use_b : 0;
+    server_log("Pool: %lu of %lu B in use, high-water mark %lu B, largest free block %lu B, %lu failed, %lu%% internal fragmentation",
+               stats.in_use_b, (uint32_t)POOL_ARENA_SIZE_B, stats.high_water_b, stats.largest_free_b,
+               stats.failed, internal_pct);
+}
+
+
+/**
+ * @brief Lay the size classes out in the arena. Call with IRQs disabled.
+ */
+static void pool_init(void) {
+
+    uint32_t offset = 0;
+    uint32_t first = 0;
+    for (uint32_t i = 0 ; i < POOL_CLASS_COUNT ; ++i) {
+        uint32_t size = POOL_MIN_BLOCK_SIZE_B << i;
+        pool_classes[i].base = &pool_arena[offset];
+        pool_classes[i].first = (uint16_t)first;
+        pool_stats.classes[i].block_size_b = size;
+        pool_stats.classes[i].blocks = pool_block_counts[i];
+        offset += size * pool_block_counts[i];
+        first += pool_block_counts[i];
+    }
+
+    pool_ready = true;
+}
+
+
+/**
+ * @brief Get the smallest size class whose blocks hold `size` bytes.
+ */
+static uint32_t pool_class_of(size_t size) {
+
+    if (size <= POOL_MIN_BLOCK_SIZE_B) return 0;
+    return (uint32_t)(32 - __builtin_clz((uint32_t)size - 1)) - 4;
+}
+
+
+/**
+ * @brief Get the size class of a pool block.
+ *
+ * @returns The class' index, or POOL_CLASS_COUNT if the pool did not
+ *          allocate the block.
+ */
+static uint32_t pool_find(const uint8_t* block) {
+
+    if (!pool_ready || block < pool_arena || block >= &pool_arena[POOL_ARENA_SIZE_B]) return POOL_CLASS_COUNT;
+
+    uint32_t index = POOL_CLASS_COUNT - 1;
+    while (block < pool_classes[index].base) index--;
+    return index;
+}
+
+
+#if POOL_HOOK_MALLOC == true
+/*
+ * NEWLIB HOOKS
+ *
+ * Newlib's own code -- `vsnprintf()`'s floating-point conversions, for
+ * example -- calls the reentrant `_malloc_r()` family, and applications
+ * call `malloc()`. Defining both here keeps newlib's allocator, and its
+ * `_sbrk()` heap growth, out of the link: every allocation comes from
+ * the pool.
+ */
+void* _malloc_r(struct _reent* reent, size_t size) {
+
+    void* block = pool_alloc(size);
+    if (block == NULL) reent->_errno = ENOMEM;
+    return block;
+}
+
+
+void _free_r(struct _reent* reent, void* block) {
+
+    UNUSED(reent);
+    pool_free(block);
+}
+
+
+void* _realloc_r(struct _reent* reent, void* block, size_t size) {
+
+    void* moved = pool_realloc(block, size);
+    if (moved == NULL) reent->_errno = ENOMEM;
+    return moved;
+}
+
+
+void* _calloc_r(struct _reent* reent, size_t count, size_t size) {
+
+    if (size != 0 && count > POOL_MAX_BLOCK_SIZE_B / size) {
+        reent->_errno = ENOMEM;
+        return NULL;
+    }
+
+    void* block = _malloc_r(reent, count * size);
+    if (block != NULL) memset(block, 0, count * size);
+    return block;
+}
+
+
+void* malloc(size_t size) {
+
+    return _malloc_r(_REENT, size);
+}
+
+
+void free(void* block) {
+
+    _free_r(_REENT, block);
+}
+
+
+void* realloc(void* block, size_t size) {
+
+    return _realloc_r(_REENT, block, size);
+}
+
+
+void* calloc(size_t count, size_t size) {
+
+    return _calloc_r(_REENT, count, size);
+}
+#endif
@@ -0,0 +1,76 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _POOL_H_
+#define _POOL_H_
+
+
+/*
+ * CONSTANTS
+ */
+// Block sizes double from class to class: 16, 32, 64, 128 and 256 bytes
+#define     POOL_CLASS_COUNT            5
+#define     POOL_MIN_BLOCK_SIZE_B       16
+#define     POOL_MAX_BLOCK_SIZE_B       (POOL_MIN_BLOCK_SIZE_B << (POOL_CLASS_COUNT - 1))
+
+// Blocks per class
+#define     POOL_BLOCKS_16B             16
+#define     POOL_BLOCKS_32B             16
+#define     POOL_BLOCKS_64B             8
+#define     POOL_BLOCKS_128B            4
+#define     POOL_BLOCKS_256B            2
+
+#define     POOL_BLOCK_TOTAL            (POOL_BLOCKS_16B + POOL_BLOCKS_32B + POOL_BLOCKS_64B + \
+                                         POOL_BLOCKS_128B + POOL_BLOCKS_256B)
+#define     POOL_ARENA_SIZE_B           (16 * POOL_BLOCKS_16B + 32 * POOL_BLOCKS_32B + 64 * POOL_BLOCKS_64B + \
+                                         128 * POOL_BLOCKS_128B + 256 * POOL_BLOCKS_256B)
+
+
+/*
+ * TYPES
+ */
+struct PoolClassStats {
+    uint32_t    block_size_b;
+    uint32_t    blocks;
+    uint32_t    in_use;
+    uint32_t    high_water;         // Most blocks ever in use at once
+    uint32_t    allocs;
+    uint32_t    spilled;            // Allocations passed up to the next class because this one was full
+};
+
+struct PoolStats {
+    struct PoolClassStats classes[POOL_CLASS_COUNT];
+    uint32_t    requested_b;        // Bytes asked for by live allocations
+    uint32_t    in_use_b;           // Bytes of the blocks that hold them
+    uint32_t    high_water_b;       // Most block bytes ever in use at once
+    uint32_t    largest_free_b;     // Largest block that could be allocated now
+    uint32_t    failed;             // Allocations that found no block, or were too big
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void*       pool_alloc(size_t size);
+void*       pool_realloc(void* block, size_t size);
+void        pool_free(void* block);
+void        pool_get_stats(struct PoolStats* stats);
+void        pool_report(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _POOL_H_
@@ -0,0 +1,122 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+#if PROFILE_ENABLED == true
+/*
+ * STATIC PROTOTYPES
+ */
+static uint32_t profile_bin(uint32_t cycles);
+
+
+/*
+ * GLOBALS
+ */
+// Every scope that has run, in the order they first ran
+static struct ProfileScope* profile_scopes[PROFILE_MAX_SCOPES];
+static uint32_t profile_scope_count = 0;
+#endif
+
+
+/**
+ * @brief Start the Cortex-M33 DWT cycle counter.
+ */
+void profile_init(void) {
+
+#if PROFILE_ENABLED == true
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+
+/**
+ * @brief Record the time spent in a scope.
+ *
+ * Called by the compiler as a `PROFILE_SCOPE()` timer goes out of
+ * scope. Scopes entered both in and out of interrupts may
+ * occasionally lose a sample to a race: it's a profile, not a count.
+ *
+ * @param timer: The scope's timer.
+ */
+void profile_end(struct ProfileTimer* timer) {
+
+#if PROFILE_ENABLED == true
+    // Unsigned subtraction copes with the counter wrapping
+    uint32_t cycles = DWT->CYCCNT - timer->start;
+    struct ProfileScope* scope = timer->scope;
+
+    if (!scope->registered) {
+        uint32_t index = __atomic_fetch_add(&profile_scope_count, 1, __ATOMIC_RELAXED);
+        if (index < PROFILE_MAX_SCOPES) profile_scopes[index] = scope;
+        scope->registered = true;
+    }
+
+    if (scope->calls == 0 || cycles < scope->min_cycles) scope->min_cycles = cycles;
+    if (cycles > scope->max_cycles) scope->max_cycles = cycles;
+    scope->total_cycles += cycles;
+    scope->histogram[profile_bin(cycles)]++;
+    scope->calls++;
+#else
+    UNUSED(timer);
+#endif
+}
+
+
+/**
+ * @brief Log each scope's cycle counts since the last report, then
+ *        clear them.
+ *
+ * The histogram lists the calls in each bin, shortest first: see
+ * PROFILE_HISTOGRAM_MIN_CYCLES.
+ */
+void profile_report(void) {
+
+#if PROFILE_ENABLED == true
+    uint32_t count = profile_scope_count < PROFILE_MAX_SCOPES ? profile_scope_count : PROFILE_MAX_SCOPES;
+    for (uint32_t i = 0 ; i < count ; ++i) {
+        // Snapshot and clear the scope, so the report's own logging isn't counted
+        __disable_irq();
+        struct ProfileScope scope = *profile_scopes[i];
+        profile_scopes[i]->calls = 0;
+        profile_scopes[i]->min_cycles = 0;
+        profile_scopes[i]->max_cycles = 0;
+        profile_scopes[i]->total_cycles = 0;
+        memset(profile_scopes[i]->histogram, 0, sizeof(scope.histogram));
+        __enable_irq();
+
+        if (scope.calls == 0) continue;
+        const uint32_t* bins = scope.histogram;
+        server_log("Profile %s: %lu calls, min %lu, mean %lu, max %lu cycles, histogram %lu/%lu/%lu/%lu/%lu/%lu/%lu/%lu",
+                   scope.name, scope.calls, scope.min_cycles, (uint32_t)(scope.total_cycles / scope.calls),
+                   scope.max_cycles, bins[0], bins[1], bins[2], bins[3], bins[4], bins[5], bins[6], bins[7]);
+    }
+
+    if (profile_scope_count > PROFILE_MAX_SCOPES) {
+        server_error("%lu profile scopes not reported: raise PROFILE_MAX_SCOPES", profile_scope_count - PROFILE_MAX_SCOPES);
+    }
+#endif
+}
+
+
+#if PROFILE_ENABLED == true
+/**
+ * @brief Get the histogram bin for a duration.
+ */
+static uint32_t profile_bin(uint32_t cycles) {
+
+    if (cycles < PROFILE_HISTOGRAM_MIN_CYCLES) return 0;
+
+    // Bin 1 starts at PROFILE_HISTOGRAM_MIN_CYCLES; each bin spans two powers of two
+    uint32_t bin = (uint32_t)(__builtin_clz(PROFILE_HISTOGRAM_MIN_CYCLES) - __builtin_clz(cycles)) / 2 + 1;
+    return bin < PROFILE_HISTOGRAM_BINS ? bin : PROFILE_HISTOGRAM_BINS - 1;
+}
+#endif
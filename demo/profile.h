@@ -0,0 +1,80 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     PROFILE_MAX_SCOPES          12
+
+// Histogram bins are powers of four wide: under 64 cycles, under 256,
+// under 1024, and so on, with the last bin catching everything longer
+#define     PROFILE_HISTOGRAM_BINS      8
+#define     PROFILE_HISTOGRAM_MIN_CYCLES 64
+
+
+/*
+ * TYPES
+ */
+struct ProfileScope {
+    const char* name;
+    bool        registered;         // Entered in the table printed by `profile_report()`
+    uint32_t    calls;
+    uint32_t    min_cycles;
+    uint32_t    max_cycles;
+    uint64_t    total_cycles;
+    uint32_t    histogram[PROFILE_HISTOGRAM_BINS];
+};
+
+struct ProfileTimer {
+    struct ProfileScope*    scope;
+    uint32_t                start;
+};
+
+
+/*
+ * MACROS
+ */
+#if PROFILE_ENABLED == true
+#define     PROFILE_CONCAT_(A, B)       A##B
+#define     PROFILE_CONCAT(A, B)        PROFILE_CONCAT_(A, B)
+
+// Time the rest of the enclosing block, however it is left, in DWT
+// cycles. `label` must be a string literal
+#define     PROFILE_SCOPE(label)                                                                \
+    static struct ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__) = { .name = label };   \
+    struct ProfileTimer PROFILE_CONCAT(profile_timer_, __LINE__)                                \
+        __attribute__((cleanup(profile_end), unused)) =                                         \
+        { &PROFILE_CONCAT(profile_scope_, __LINE__), DWT->CYCCNT }
+#else
+#define     PROFILE_SCOPE(label)        do { } while (0)
+#endif
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        profile_init(void);
+void        profile_end(struct ProfileTimer* timer);
+void        profile_report(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _PROFILE_H_
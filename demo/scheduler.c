@@ -0,0 +1,391 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static uint64_t sched_now(void);
+static void     sched_heap_swap(uint32_t a, uint32_t b);
+static void     sched_heap_up(uint32_t pos);
+static void     sched_heap_down(uint32_t pos);
+static void     sched_heap_push(uint32_t slot);
+static void     sched_heap_remove(uint32_t pos);
+static void     sched_wake_timer_init(void);
+static void     sched_wake_timer_arm(uint64_t span_us);
+static void     sched_wake_timer_disarm(void);
+
+
+/*
+ * TYPES
+ */
+struct SchedJob {
+    sched_job_fn    fn;
+    uint64_t        deadline;
+    uint64_t        period;             // 0 for a one-shot job
+    uint8_t         generation;
+    uint8_t         heap_pos;           // Valid only while the job is queued
+    bool            active;
+};
+
+
+/*
+ * GLOBALS
+ */
+// Job slots, plus a binary min-heap of slot indices ordered by deadline,
+// so the next job due is always at `sched_heap[0]`
+static struct SchedJob  sched_jobs[SCHED_MAX_JOBS];
+static uint8_t          sched_heap[SCHED_MAX_JOBS];
+static uint32_t         sched_heap_count = 0;
+
+static struct SchedStats sched_stats = { 0 };
+static uint64_t          sched_last_wake = 0;
+
+// Background work run before each sleep
+static sched_job_fn      sched_idle_job = NULL;
+
+// One-shot timer used to end a sleep at the next deadline
+static TIM_HandleTypeDef sched_wake_timer;
+
+
+/**
+ * @brief Prepare the scheduler and its wake timer.
+ */
+void sched_init(void) {
+
+    memset(sched_jobs, 0, sizeof(sched_jobs));
+    sched_heap_count = 0;
+    sched_wake_timer_init();
+    sched_last_wake = sched_now();
+}
+
+
+/**
+ * @brief Register a job.
+ *
+ * @param job:       The function to call when the job falls due.
+ * @param delay_us:  Microseconds from now until the first run.
+ * @param period_us: Microseconds between runs, or 0 for a one-shot job.
+ *
+ * @returns The job's ID, or `SCHED_JOB_NONE` if all slots are in use.
+ */
+SchedJobId sched_add(sched_job_fn job, uint64_t delay_us, uint64_t period_us) {
+
+    for (uint32_t slot = 0 ; slot < SCHED_MAX_JOBS ; ++slot) {
+        struct SchedJob* entry = &sched_jobs[slot];
+        if (entry->active) continue;
+
+        entry->fn       = job;
+        entry->deadline = sched_now() + delay_us;
+        entry->period   = period_us;
+        entry->active   = true;
+        entry->generation++;
+        sched_heap_push(slot);
+
+        // Fold the slot's generation into the ID so that a stale ID
+        // can't cancel whichever job later reuses the slot
+        return ((SchedJobId)entry->generation << 8) | (slot + 1);
+    }
+
+    server_error("Scheduler has no free job slots");
+    return SCHED_JOB_NONE;
+}
+
+
+/**
+ * @brief Remove a job before it next runs.
+ *
+ * @param id: The job's ID. Stale and `SCHED_JOB_NONE` IDs are ignored.
+ */
+void sched_cancel(SchedJobId id) {
+
+    uint32_t slot = (id & 0xFF) - 1;
+    if (id == SCHED_JOB_NONE || slot >= SCHED_MAX_JOBS) return;
+
+    struct SchedJob* entry = &sched_jobs[slot];
+    if (!entry->active || entry->generation != (uint8_t)(id >> 8)) return;
+
+    sched_heap_remove(entry->heap_pos);
+    entry->active = false;
+}
+
+
+/**
+ * @brief Run every job whose deadline has passed.
+ *
+ * Periodic jobs are re-queued a whole period after their previous
+ * deadline, so they don't drift with loop latency. A job that has
+ * fallen more than a period behind skips the missed runs.
+ */
+void sched_dispatch(void) {
+
+    uint64_t now = sched_now();
+    while (sched_heap_count > 0) {
+        uint32_t slot = sched_heap[0];
+        struct SchedJob* entry = &sched_jobs[slot];
+        if (entry->deadline > now) break;
+
+        sched_heap_remove(0);
+        if (entry->period > 0) {
+            entry->deadline += entry->period;
+            if (entry->deadline <= now) entry->deadline = now + entry->period;
+            sched_heap_push(slot);
+        } else {
+            entry->active = false;
+        }
+
+        entry->fn();
+    }
+}
+
+
+/**
+ * @brief Register the idle job.
+ *
+ * The idle job runs at the start of every `sched_sleep()`, once the
+ * main loop's other work is done. It should do a bounded amount of
+ * work and leave anything more for `has_work()` to report.
+ *
+ * @param job: The function to call, or `NULL` for none.
+ */
+void sched_set_idle(sched_job_fn job) {
+
+    sched_idle_job = job;
+}
+
+
+/**
+ * @brief Sleep until the next job falls due or an interrupt arrives.
+ *
+ * Interrupts are masked while we decide whether to sleep, so an ISR
+ * that sets a flag after `has_work()` is checked still wakes WFI: the
+ * core wakes on a pending IRQ even with PRIMASK set, and the handler
+ * runs when interrupts are re-enabled. The HAL tick is suspended so
+ * its 1ms interrupt doesn't end every sleep early.
+ *
+ * @param has_work: Returns `true` if ISR-flagged work awaits the main loop.
+ */
+void sched_sleep(bool (*has_work)(void)) {
+
+    uint64_t now = sched_now();
+    sched_stats.passes++;
+    sched_stats.awake_us += now - sched_last_wake;
+    sched_last_wake = now;
+
+    if (sched_idle_job != NULL) sched_idle_job();
+
+    __disable_irq();
+    if ((has_work != NULL && has_work()) || sched_heap_count == 0) {
+        __enable_irq();
+        return;
+    }
+
+    uint64_t deadline = sched_jobs[sched_heap[0]].deadline;
+    if (deadline <= now) {
+        __enable_irq();
+        return;
+    }
+
+    uint64_t span = deadline - now;
+    if (span > SCHED_MAX_SLEEP_US) span = SCHED_MAX_SLEEP_US;
+
+    sched_wake_timer_arm(span);
+    HAL_SuspendTick();
+    __WFI();
+    HAL_ResumeTick();
+    sched_wake_timer_disarm();
+    __enable_irq();
+
+    uint64_t wake = sched_now();
+    sched_stats.wakeups++;
+    sched_stats.slept_us += wake - now;
+    sched_last_wake = wake;
+
+    // Woken by the timer short of a deadline (a capped sleep)
+    // or by an interrupt that left the main loop nothing to do
+    if (wake < sched_jobs[sched_heap[0]].deadline && (has_work == NULL || !has_work())) {
+        sched_stats.idle_wakeups++;
+    }
+}
+
+
+/**
+ * @brief Copy out the scheduler's counters.
+ *
+ * @param stats: Pointer to the record to fill.
+ */
+void sched_get_stats(struct SchedStats* stats) {
+
+    *stats = sched_stats;
+}
+
+
+/**
+ * @brief Log the scheduler's counters and start a new reporting window.
+ *
+ * The busy-poll estimate is the time spent asleep divided by the mean
+ * awake duration of a loop pass: the number of passes the old polling
+ * loop would have made in that time.
+ */
+void sched_report(void) {
+
+    uint64_t total = sched_stats.slept_us + sched_stats.awake_us;
+    uint32_t asleep_pct = total > 0 ? (uint32_t)(sched_stats.slept_us * 100 / total) : 0;
+    uint64_t pass_us = sched_stats.passes > 0 ? sched_stats.awake_us / sched_stats.passes : 0;
+    uint64_t polls_saved = sched_stats.slept_us / (pass_us > 0 ? pass_us : 1);
+
+    server_log("Scheduler: %lu passes, %lu wakeups (%lu idle), %lu%% asleep, ~%lu polls saved",
+               sched_stats.passes, sched_stats.wakeups, sched_stats.idle_wakeups,
+               asleep_pct, (uint32_t)polls_saved);
+
+    memset(&sched_stats, 0, sizeof(sched_stats));
+}
+
+
+/**
+ * @brief Read the Microvisor microsecond clock.
+ */
+static uint64_t sched_now(void) {
+
+    uint64_t tick = 0;
+    mvGetMicroseconds(&tick);
+    return tick;
+}
+
+
+/*
+ * MIN-HEAP
+ */
+static void sched_heap_swap(uint32_t a, uint32_t b) {
+
+    uint8_t slot = sched_heap[a];
+    sched_heap[a] = sched_heap[b];
+    sched_heap[b] = slot;
+    sched_jobs[sched_heap[a]].heap_pos = a;
+    sched_jobs[sched_heap[b]].heap_pos = b;
+}
+
+
+static void sched_heap_up(uint32_t pos) {
+
+    while (pos > 0) {
+        uint32_t parent = (pos - 1) / 2;
+        if (sched_jobs[sched_heap[parent]].deadline <= sched_jobs[sched_heap[pos]].deadline) break;
+        sched_heap_swap(pos, parent);
+        pos = parent;
+    }
+}
+
+
+static void sched_heap_down(uint32_t pos) {
+
+    while (true) {
+        uint32_t least = pos;
+        uint32_t left = 2 * pos + 1;
+        uint32_t right = left + 1;
+        if (left < sched_heap_count && sched_jobs[sched_heap[left]].deadline < sched_jobs[sched_heap[least]].deadline) least = left;
+        if (right < sched_heap_count && sched_jobs[sched_heap[right]].deadline < sched_jobs[sched_heap[least]].deadline) least = right;
+        if (least == pos) break;
+        sched_heap_swap(pos, least);
+        pos = least;
+    }
+}
+
+
+static void sched_heap_push(uint32_t slot) {
+
+    uint32_t pos = sched_heap_count++;
+    sched_heap[pos] = slot;
+    sched_jobs[slot].heap_pos = pos;
+    sched_heap_up(pos);
+}
+
+
+static void sched_heap_remove(uint32_t pos) {
+
+    uint32_t last = --sched_heap_count;
+    if (pos != last) {
+        sched_heap_swap(pos, last);
+        sched_heap_down(pos);
+        sched_heap_up(pos);
+    }
+}
+
+
+/*
+ * WAKE TIMER
+ */
+
+/**
+ * @brief Configure TIM7 as a one-pulse timer counting at `SCHED_WAKE_TIMER_HZ`.
+ */
+static void sched_wake_timer_init(void) {
+
+    RCC_ClkInitTypeDef clkconfig;
+    uint32_t flash_latency = 0;
+    uint32_t timer_clock = 0;
+
+    __HAL_RCC_TIM7_CLK_ENABLE();
+
+    // As per the HAL timebase, TIM7 runs at twice PCLK1 if APB1 is divided
+    HAL_RCC_GetClockConfig(&clkconfig, &flash_latency);
+    mvGetPClk1(&timer_clock);
+    if (clkconfig.APB1CLKDivider != RCC_HCLK_DIV1) timer_clock *= 2UL;
+
+    sched_wake_timer.Instance = TIM7;
+    sched_wake_timer.Init.Prescaler = (timer_clock / SCHED_WAKE_TIMER_HZ) - 1;
+    sched_wake_timer.Init.CounterMode = TIM_COUNTERMODE_UP;
+    sched_wake_timer.Init.Period = 0xFFFF;
+    sched_wake_timer.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    HAL_StatusTypeDef status = HAL_TIM_OnePulse_Init(&sched_wake_timer, TIM_OPMODE_SINGLE);
+    do_assert(status == HAL_OK, "Could not initialize scheduler wake timer");
+
+    HAL_NVIC_SetPriority(TIM7_IRQn, TICK_INT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(TIM7_IRQn);
+}
+
+
+/**
+ * @brief Start the wake timer.
+ *
+ * @param span_us: Microseconds until the timer fires. Rounded up to
+ *                 the timer's resolution.
+ */
+static void sched_wake_timer_arm(uint64_t span_us) {
+
+    uint32_t ticks = (uint32_t)((span_us * SCHED_WAKE_TIMER_HZ + 999999) / 1000000);
+    if (ticks == 0) ticks = 1;
+    if (ticks > 0x10000) ticks = 0x10000;
+
+    __HAL_TIM_SET_AUTORELOAD(&sched_wake_timer, ticks - 1);
+    __HAL_TIM_SET_COUNTER(&sched_wake_timer, 0);
+    __HAL_TIM_CLEAR_FLAG(&sched_wake_timer, TIM_FLAG_UPDATE);
+    HAL_TIM_Base_Start_IT(&sched_wake_timer);
+}
+
+
+/**
+ * @brief Stop the wake timer if it's still running.
+ */
+static void sched_wake_timer_disarm(void) {
+
+    HAL_TIM_Base_Stop_IT(&sched_wake_timer);
+}
+
+
+/**
+ * @brief The wake timer's interrupt handler.
+ *
+ * Its only job is to wake the core from WFI.
+ */
+void TIM7_IRQHandler(void) {
+
+    __HAL_TIM_CLEAR_IT(&sched_wake_timer, TIM_IT_UPDATE);
+}
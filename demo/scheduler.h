@@ -0,0 +1,65 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     SCHED_MAX_JOBS                  12            // Five periodic jobs, and up to six one-shot timers
+#define     SCHED_JOB_NONE                  0
+
+// The wake timer counts at 10kHz, so a 16-bit reload value
+// caps a single sleep at just over 6.5s
+#define     SCHED_WAKE_TIMER_HZ             10000
+#define     SCHED_MAX_SLEEP_US              6000 * 1000
+
+#define     SCHED_REPORT_PERIOD_US          3600ULL * 1000 * 1000
+
+
+/*
+ * TYPES
+ */
+typedef void (*sched_job_fn)(void);
+typedef uint32_t SchedJobId;
+
+struct SchedStats {
+    uint32_t    passes;             // Main loop passes
+    uint32_t    wakeups;            // Returns from WFI
+    uint32_t    idle_wakeups;       // Wakeups that found nothing to do
+    uint64_t    slept_us;
+    uint64_t    awake_us;
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        sched_init(void);
+SchedJobId  sched_add(sched_job_fn job, uint64_t delay_us, uint64_t period_us);
+void        sched_cancel(SchedJobId id);
+void        sched_dispatch(void);
+void        sched_set_idle(sched_job_fn job);
+void        sched_sleep(bool (*has_work)(void));
+void        sched_get_stats(struct SchedStats* stats);
+void        sched_report(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _SCHEDULER_H_
@@ -0,0 +1,507 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#define     LOG_MODULE      LOG_MODULE_HTTP
+#include "main.h"
+
+
+/*
+ * NOTE The spool is an append-only log across SPOOL_FLASH_PAGES pages of
+ *      flash, which are used in turn, as a ring, so they all wear at the
+ *      same rate. Each page opens with a header that numbers it -- the
+ *      highest number marks the page being written -- and counts its
+ *      erases. Records follow, each checked by a CRC-32:
+ *
+ *      - Data records hold a payload and a sequence number.
+ *      - Ack records mark every data record up to their sequence number
+ *        as consumed. Flash can't be rewritten in place, so consuming
+ *        records appends an ack rather than clearing them.
+ *
+ *      A page is erased for reuse only once all its data records have
+ *      been acked. A record torn by a reset or power loss fails its CRC:
+ *      the rest of its page is left unused until the page is erased.
+ */
+
+
+/*
+ * TYPES
+ */
+// Page and record headers share a layout
+struct SpoolHeader {
+    uint32_t    magic;
+    uint32_t    sequence;           // Page: order of use. Data: the record's. Ack: the last consumed
+    uint32_t    value;              // Page: erase count. Data: payload length. Ack: 0
+    uint32_t    crc;                // Over the fields above, then any payload
+};
+
+struct SpoolPosition {
+    uint32_t    page;
+    uint32_t    offset;
+};
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static bool     spool_append(uint32_t magic, uint32_t sequence, const uint8_t* data, uint32_t length);
+static bool     spool_open_page(uint32_t acked);
+static bool     spool_program(uint32_t page, uint32_t offset, uint32_t length);
+static bool     spool_next(struct SpoolPosition* position, struct SpoolHeader* header);
+static bool     spool_read_header(uint32_t page, uint32_t offset, struct SpoolHeader* header);
+static bool     spool_is_erased(uint32_t page, uint32_t offset);
+static uint32_t spool_record_size(uint32_t length);
+static uint32_t spool_crc32(uint32_t crc, const uint8_t* data, uint32_t length);
+static const uint8_t* spool_flash(uint32_t page, uint32_t offset);
+
+
+/*
+ * GLOBALS
+ */
+// Records are assembled here, then programmed a quad-word at a time
+static uint8_t spool_staging[SPOOL_RECORD_MAX_LEN_B] __attribute__((aligned(16)));
+
+static struct {
+    uint32_t    sequence;           // From the page header, or 0 if the page isn't in use
+    uint32_t    erases;
+    uint32_t    last;               // The page's greatest data sequence number
+} spool_pages[SPOOL_FLASH_PAGES];
+
+static struct SpoolPosition spool_head;     // Where the next record goes
+static struct SpoolPosition spool_cursor;   // Where `spool_read()` resumes
+static uint32_t spool_page_sequence = 0;    // The head page's
+static uint32_t spool_next_sequence = 1;
+static uint32_t spool_acked = 0;            // Consumed, with an ack record to show it
+static uint32_t spool_read_sequence = 0;    // Read, but perhaps not yet acked
+static struct SpoolStats spool_stats = { 0 };
+
+// CRC-32 (IEEE 802.3), a nibble at a time
+static const uint32_t spool_crc_table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+
+/**
+ * @brief Recover the spool's state from flash.
+ *
+ * Call once at start-up, before any other spool function. Records stored
+ * before a reset, and read but not committed, will be read again.
+ */
+void spool_init(void) {
+
+    memset(spool_pages, 0, sizeof(spool_pages));
+    spool_stats = (struct SpoolStats){ 0 };
+    spool_next_sequence = 1;
+    spool_acked = 0;
+
+    // Scan every page for its header, its records and the end of its log
+    uint32_t head = SPOOL_FLASH_PAGES;
+    uint32_t ends[SPOOL_FLASH_PAGES];
+    for (uint32_t page = 0 ; page < SPOOL_FLASH_PAGES ; ++page) {
+        struct SpoolHeader header;
+        ends[page] = FLASH_PAGE_SIZE;
+        if (!spool_read_header(page, 0, &header) || header.magic != SPOOL_MAGIC_PAGE) continue;
+
+        spool_pages[page].sequence = header.sequence;
+        spool_pages[page].erases = header.value;
+        if (head == SPOOL_FLASH_PAGES || header.sequence > spool_pages[head].sequence) head = page;
+
+        uint32_t offset = SPOOL_HEADER_SIZE_B;
+        while (offset + SPOOL_HEADER_SIZE_B <= FLASH_PAGE_SIZE && !spool_is_erased(page, offset)) {
+            if (!spool_read_header(page, offset, &header)) {
+                spool_stats.corrupt++;
+                offset = FLASH_PAGE_SIZE;
+                break;
+            }
+
+            if (header.magic == SPOOL_MAGIC_DATA) {
+                spool_pages[page].last = header.sequence;
+                if (header.sequence >= spool_next_sequence) spool_next_sequence = header.sequence + 1;
+            } else if (header.magic == SPOOL_MAGIC_ACK && header.sequence > spool_acked) {
+                spool_acked = header.sequence;
+            }
+
+            offset += spool_record_size(header.magic == SPOOL_MAGIC_DATA ? header.value : 0);
+        }
+
+        ends[page] = offset;
+    }
+
+    spool_read_sequence = spool_acked;
+    if (head == SPOOL_FLASH_PAGES) {
+        // A blank spool: the first record opens page 0
+        spool_page_sequence = 0;
+        spool_head = (struct SpoolPosition){ SPOOL_FLASH_PAGES - 1, FLASH_PAGE_SIZE };
+        spool_cursor = spool_head;
+        return;
+    }
+
+    spool_page_sequence = spool_pages[head].sequence;
+    spool_head = (struct SpoolPosition){ head, ends[head] };
+
+    // Reading starts from the oldest page in use, the first after the head
+    spool_cursor = spool_head;
+    for (uint32_t i = 1 ; i < SPOOL_FLASH_PAGES ; ++i) {
+        uint32_t page = (head + i) % SPOOL_FLASH_PAGES;
+        if (spool_pages[page].sequence != 0) {
+            spool_cursor = (struct SpoolPosition){ page, SPOOL_HEADER_SIZE_B };
+            break;
+        }
+    }
+
+    if (spool_cursor.page == head) spool_cursor.offset = SPOOL_HEADER_SIZE_B;
+
+    // Count what's left to read
+    struct SpoolPosition position = spool_cursor;
+    struct SpoolHeader header;
+    while (spool_next(&position, &header)) {
+        spool_stats.pending++;
+        position.offset += spool_record_size(header.value);
+    }
+}
+
+
+/**
+ * @brief Store a record.
+ *
+ * @param data:   The record.
+ * @param length: Its size in bytes: at least 1, and up to SPOOL_RECORD_MAX_LEN_B
+ *                less the header.
+ *
+ * @returns `true` if the record was written, `false` if the spool is full
+ *          or the write failed.
+ */
+bool spool_push(const uint8_t* data, uint32_t length) {
+
+    if (length == 0 || SPOOL_HEADER_SIZE_B + length > SPOOL_RECORD_MAX_LEN_B) {
+        spool_stats.rejected++;
+        return false;
+    }
+
+    if (!spool_append(SPOOL_MAGIC_DATA, spool_next_sequence, data, length)) return false;
+
+    spool_next_sequence++;
+    spool_stats.pending++;
+    spool_stats.stored++;
+    return true;
+}
+
+
+/**
+ * @brief Read the oldest record not yet read.
+ *
+ * The record stays in flash until `spool_commit()` is called, so if the
+ * app resets first, it will be read again.
+ *
+ * @param buffer: Where to copy the record.
+ * @param size:   The size of the buffer. A longer record is truncated.
+ *
+ * @returns The record's length, or 0 if there are none to read.
+ */
+uint32_t spool_read(uint8_t* buffer, uint32_t size) {
+
+    struct SpoolHeader header;
+    if (!spool_next(&spool_cursor, &header)) return 0;
+
+    memcpy(buffer, spool_flash(spool_cursor.page, spool_cursor.offset + SPOOL_HEADER_SIZE_B),
+           header.value < size ? header.value : size);
+    spool_cursor.offset += spool_record_size(header.value);
+    spool_read_sequence = header.sequence;
+    spool_stats.pending--;
+    spool_stats.replayed++;
+    return header.value;
+}
+
+
+/**
+ * @brief Mark every record read so far as consumed.
+ *
+ * Writes a single ack record, so commit once per batch rather than per
+ * record. May fail while the spool is full and the records read so far
+ * don't free a page: read more, and commit again.
+ *
+ * @returns `true` if nothing read remains unacked, otherwise `false`.
+ */
+bool spool_commit(void) {
+
+    if (spool_read_sequence <= spool_acked) return true;
+    if (!spool_append(SPOOL_MAGIC_ACK, spool_read_sequence, NULL, 0)) return false;
+
+    spool_acked = spool_read_sequence;
+    return true;
+}
+
+
+/**
+ * @brief Count the records stored and not yet read.
+ */
+uint32_t spool_pending(void) {
+
+    return spool_stats.pending;
+}
+
+
+/**
+ * @brief Copy out the spool's counters.
+ *
+ * @param stats: Pointer to the record to fill.
+ */
+void spool_get_stats(struct SpoolStats* stats) {
+
+    *stats = spool_stats;
+    stats->used_b = 0;
+    stats->min_page_erases = UINT32_MAX;
+    stats->max_page_erases = 0;
+    for (uint32_t page = 0 ; page < SPOOL_FLASH_PAGES ; ++page) {
+        if (spool_pages[page].sequence != 0) stats->used_b += page == spool_head.page ? spool_head.offset : FLASH_PAGE_SIZE;
+        if (spool_pages[page].erases < stats->min_page_erases) stats->min_page_erases = spool_pages[page].erases;
+        if (spool_pages[page].erases > stats->max_page_erases) stats->max_page_erases = spool_pages[page].erases;
+    }
+}
+
+
+/**
+ * @brief Log the spool's counters.
+ */
+void spool_report(void) {
+
+    struct SpoolStats stats;
+    spool_get_stats(&stats);
+    server_log("Spool: %lu pending, %lu stored, %lu replayed, %lu rejected, %lu corrupt, %lu write errors, %lu of %lu bytes used, %lu erases (%lu-%lu per page)",
+               stats.pending, stats.stored, stats.replayed, stats.rejected, stats.corrupt, stats.write_errors,
+               stats.used_b, (uint32_t)(SPOOL_FLASH_PAGES * FLASH_PAGE_SIZE), stats.erases,
+               stats.min_page_erases, stats.max_page_erases);
+}
+
+
+/**
+ * @brief Write a record at the head of the log, opening a new page if
+ *        this one is full.
+ *
+ * @param magic:    SPOOL_MAGIC_DATA or SPOOL_MAGIC_ACK.
+ * @param sequence: The record's sequence number.
+ * @param data:     The payload, or `NULL`.
+ * @param length:   The size of the payload in bytes.
+ *
+ * @returns `true` if the record was written, otherwise `false`.
+ */
+static bool spool_append(uint32_t magic, uint32_t sequence, const uint8_t* data, uint32_t length) {
+
+    // Data leaves a quad-word in the page for an ack, so that what's
+    // been read can always be committed, even with the spool full
+    uint32_t size = spool_record_size(length);
+    uint32_t reserve = magic == SPOOL_MAGIC_DATA ? SPOOL_QUADWORD_B : 0;
+    if (spool_head.offset + size + reserve > FLASH_PAGE_SIZE) {
+        if (!spool_open_page(magic == SPOOL_MAGIC_ACK ? sequence : spool_acked)) {
+            spool_stats.rejected++;
+            return false;
+        }
+    }
+
+    struct SpoolHeader header = { magic, sequence, length, 0 };
+    header.crc = spool_crc32(spool_crc32(0, (const uint8_t*)&header, 12), data, length);
+    memcpy(spool_staging, &header, SPOOL_HEADER_SIZE_B);
+    if (length > 0) memcpy(&spool_staging[SPOOL_HEADER_SIZE_B], data, length);
+    memset(&spool_staging[SPOOL_HEADER_SIZE_B + length], 0, size - SPOOL_HEADER_SIZE_B - length);
+
+    if (!spool_program(spool_head.page, spool_head.offset, size)) {
+        // Whatever part was written will fail its CRC: skip the rest of the page
+        spool_stats.write_errors++;
+        spool_head.offset = FLASH_PAGE_SIZE;
+        return false;
+    }
+
+    spool_head.offset += size;
+    if (magic == SPOOL_MAGIC_DATA) spool_pages[spool_head.page].last = sequence;
+    return true;
+}
+
+
+/**
+ * @brief Erase the next page in the ring and make it the head.
+ *
+ * @param acked: The sequence number through which records will have been
+ *               consumed, once the record that needs the page is written.
+ *
+ * @returns `true` if the page is ready, or `false` if it still holds
+ *          unconsumed records or could not be erased.
+ */
+static bool spool_open_page(uint32_t acked) {
+
+    uint32_t page = (spool_head.page + 1) % SPOOL_FLASH_PAGES;
+    if (spool_pages[page].sequence != 0 && spool_pages[page].last > acked) return false;
+
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_PAGES,
+        .Banks     = SPOOL_FLASH_BANK,
+        .Page      = SPOOL_FLASH_FIRST_PAGE + page,
+        .NbPages   = 1
+    };
+
+    uint32_t page_error = 0;
+    HAL_FLASH_Unlock();
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &page_error);
+    HAL_FLASH_Lock();
+
+    spool_pages[page].sequence = 0;
+    spool_pages[page].last = 0;
+    if (status != HAL_OK) {
+        spool_stats.write_errors++;
+        return false;
+    }
+
+    spool_pages[page].erases++;
+    spool_stats.erases++;
+
+    // If the reader had finished with the page, it moves on to the next
+    if (spool_cursor.page == page) spool_cursor = (struct SpoolPosition){ (page + 1) % SPOOL_FLASH_PAGES, SPOOL_HEADER_SIZE_B };
+
+    struct SpoolHeader header = { SPOOL_MAGIC_PAGE, spool_page_sequence + 1, spool_pages[page].erases, 0 };
+    header.crc = spool_crc32(0, (const uint8_t*)&header, 12);
+    memcpy(spool_staging, &header, SPOOL_HEADER_SIZE_B);
+    if (!spool_program(page, 0, SPOOL_HEADER_SIZE_B)) {
+        spool_stats.write_errors++;
+        return false;
+    }
+
+    spool_page_sequence++;
+    spool_pages[page].sequence = spool_page_sequence;
+    spool_head = (struct SpoolPosition){ page, SPOOL_HEADER_SIZE_B };
+    return true;
+}
+
+
+/**
+ * @brief Program the staged record into flash.
+ *
+ * @param page:   The spool page.
+ * @param offset: Where in the page, a multiple of SPOOL_QUADWORD_B.
+ * @param length: The bytes to write from `spool_staging`, a multiple of SPOOL_QUADWORD_B.
+ *
+ * @returns `true` if every quad-word was written, otherwise `false`.
+ */
+static bool spool_program(uint32_t page, uint32_t offset, uint32_t length) {
+
+    uint32_t address = SPOOL_FLASH_ADDR + page * FLASH_PAGE_SIZE + offset;
+    HAL_StatusTypeDef status = HAL_OK;
+
+    HAL_FLASH_Unlock();
+    for (uint32_t i = 0 ; i < length && status == HAL_OK ; i += SPOOL_QUADWORD_B) {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_QUADWORD, address + i, (uintptr_t)&spool_staging[i]);
+    }
+
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
+
+
+/**
+ * @brief Find the next unread data record, from a position in the log.
+ *
+ * @param position: Where to start. Left at the record, if one is found.
+ * @param header:   Receives the record's header.
+ *
+ * @returns `true` if a record was found, otherwise `false`.
+ */
+static bool spool_next(struct SpoolPosition* position, struct SpoolHeader* header) {
+
+    while (position->page != spool_head.page || position->offset < spool_head.offset) {
+        if (position->offset + SPOOL_HEADER_SIZE_B > FLASH_PAGE_SIZE || !spool_read_header(position->page, position->offset, header)) {
+            // The end of this page's log: go on to the next page
+            if (position->page == spool_head.page) return false;
+            position->page = (position->page + 1) % SPOOL_FLASH_PAGES;
+            position->offset = SPOOL_HEADER_SIZE_B;
+            continue;
+        }
+
+        if (header->magic == SPOOL_MAGIC_DATA && header->sequence > spool_read_sequence) return true;
+        position->offset += spool_record_size(header->magic == SPOOL_MAGIC_DATA ? header->value : 0);
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Read and check a page or record header.
+ *
+ * @param page:   The spool page.
+ * @param offset: Where in the page.
+ * @param header: Receives the header.
+ *
+ * @returns `true` if the header -- and a data record's payload -- pass
+ *          their CRC, otherwise `false`.
+ */
+static bool spool_read_header(uint32_t page, uint32_t offset, struct SpoolHeader* header) {
+
+    memcpy(header, spool_flash(page, offset), SPOOL_HEADER_SIZE_B);
+
+    uint32_t length = 0;
+    if (header->magic == SPOOL_MAGIC_DATA) {
+        length = header->value;
+        if (offset + SPOOL_HEADER_SIZE_B + length > FLASH_PAGE_SIZE) return false;
+    } else if (header->magic != SPOOL_MAGIC_ACK && header->magic != SPOOL_MAGIC_PAGE) {
+        return false;
+    }
+
+    uint32_t crc = spool_crc32(0, (const uint8_t*)header, 12);
+    return spool_crc32(crc, spool_flash(page, offset + SPOOL_HEADER_SIZE_B), length) == header->crc;
+}
+
+
+/**
+ * @brief Check whether a quad-word has never been written since its page's erase.
+ */
+static bool spool_is_erased(uint32_t page, uint32_t offset) {
+
+    const uint8_t* flash = spool_flash(page, offset);
+    for (uint32_t i = 0 ; i < SPOOL_QUADWORD_B ; ++i) {
+        if (flash[i] != 0xFF) return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief The flash a record occupies: its header and payload, in whole quad-words.
+ */
+static uint32_t spool_record_size(uint32_t length) {
+
+    return (SPOOL_HEADER_SIZE_B + length + SPOOL_QUADWORD_B - 1) & ~(SPOOL_QUADWORD_B - 1);
+}
+
+
+/**
+ * @brief Update a CRC-32 with more data.
+ *
+ * @param crc:    The CRC so far, or 0 to start.
+ * @param data:   The data.
+ * @param length: Its size in bytes.
+ *
+ * @returns The updated CRC.
+ */
+static uint32_t spool_crc32(uint32_t crc, const uint8_t* data, uint32_t length) {
+
+    crc = ~crc;
+    for (uint32_t i = 0 ; i < length ; ++i) {
+        crc = (crc >> 4) ^ spool_crc_table[(crc ^ data[i]) & 0x0F];
+        crc = (crc >> 4) ^ spool_crc_table[(crc ^ (data[i] >> 4)) & 0x0F];
+    }
+
+    return ~crc;
+}
+
+
+/**
+ * @brief Get a pointer into the spool's flash, which is memory mapped.
+ */
+static const uint8_t* spool_flash(uint32_t page, uint32_t offset) {
+
+    return (const uint8_t*)(uintptr_t)(SPOOL_FLASH_ADDR + page * FLASH_PAGE_SIZE + offset);
+}
@@ -0,0 +1,73 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _SPOOL_H_
+#define _SPOOL_H_
+
+
+/*
+ * CONSTANTS
+ */
+// The spool's flash: the last pages of bank 2. The app's linker script
+// must keep its image clear of them
+#define     SPOOL_FLASH_BANK            FLASH_BANK_2
+#define     SPOOL_FLASH_FIRST_PAGE      (FLASH_PAGE_NB - SPOOL_FLASH_PAGES)
+#define     SPOOL_FLASH_PAGES           4
+#define     SPOOL_FLASH_BANK_SIZE_B     0x100000UL
+#define     SPOOL_FLASH_ADDR            (FLASH_BASE + SPOOL_FLASH_BANK_SIZE_B + SPOOL_FLASH_FIRST_PAGE * FLASH_PAGE_SIZE)
+
+// Flash is written in quad-words, so records are padded to a multiple
+#define     SPOOL_QUADWORD_B            16
+#define     SPOOL_HEADER_SIZE_B         16
+#define     SPOOL_RECORD_MAX_LEN_B      512           // Header included
+
+#define     SPOOL_MAGIC_PAGE            0x53504C50UL  // "SPLP"
+#define     SPOOL_MAGIC_DATA            0x53504C44UL  // "SPLD"
+#define     SPOOL_MAGIC_ACK             0x53504C41UL  // "SPLA"
+
+
+/*
+ * TYPES
+ */
+struct SpoolStats {
+    uint32_t    pending;            // Records stored and not yet read
+    uint32_t    used_b;             // Flash in use by the log, including consumed records
+    uint32_t    stored;
+    uint32_t    replayed;           // Records read back
+    uint32_t    rejected;           // Spool full, or record too large
+    uint32_t    corrupt;            // Records that failed their CRC when the spool was scanned
+    uint32_t    write_errors;
+    uint32_t    erases;
+    uint32_t    min_page_erases;    // Lifetime erases of the least and most worn pages
+    uint32_t    max_page_erases;
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        spool_init(void);
+bool        spool_push(const uint8_t* data, uint32_t length);
+uint32_t    spool_read(uint8_t* buffer, uint32_t size);
+bool        spool_commit(void);
+uint32_t    spool_pending(void);
+void        spool_get_stats(struct SpoolStats* stats);
+void        spool_report(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _SPOOL_H_
@@ -0,0 +1,247 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * NOTE Samples are held in RAM and posted in batches: every request
+ *      costs its request line, headers and response on top of its body,
+ *      so one request for ten samples costs far less than ten requests.
+ *
+ *      The body is CBOR, written straight into the queued request: a map
+ *      of the first sample's uptime, then each sample as an array of its
+ *      uptime relative to that and its values. In JSON terms,
+ *      `{"t":30,"s":[[0,43,4164,0],[30,44,4164,0]]}`, but in 25 bytes, not 43.
+ *      The server's reply is CBOR too, if it says so. The body is offered
+ *      for compression as well, which pays once a batch saves more than
+ *      the Content-Encoding header costs: at 10 samples it doesn't yet.
+ */
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     telemetry_flush_due(void);
+static void     telemetry_encode(struct CborWriter* writer);
+static void     telemetry_posted(const struct HttpResponse* response, void* context);
+static bool     telemetry_read_reply(const uint8_t* chunk, uint32_t length, uint32_t offset, void* context);
+
+
+/*
+ * GLOBALS
+ */
+static struct TelemetrySample telemetry_batch[TELEMETRY_BATCH_SAMPLES];
+static uint32_t telemetry_count = 0;
+static uint8_t telemetry_reply[TELEMETRY_REPLY_MAX_LEN_B];
+static SchedJobId telemetry_age_job = SCHED_JOB_NONE;
+static struct TelemetryStats telemetry_stats = { 0 };
+
+// Post rate reporting window
+static uint64_t telemetry_report_tick = 0;
+static uint32_t telemetry_report_posts = 0;
+
+
+/**
+ * @brief Take a sample: the uptime, a counter and the memory watermarks.
+ *
+ * The batch is posted once it's full, or TELEMETRY_MAX_AGE_US after its
+ * first sample, whichever is sooner.
+ *
+ * @param counter: The value to record, eg. the debug test variable.
+ */
+void telemetry_sample(uint32_t counter) {
+
+    uint64_t now = 0;
+    mvGetMicroseconds(&now);
+    struct MemStats memory;
+    mem_get_stats(&memory);
+
+    struct TelemetrySample* sample = &telemetry_batch[telemetry_count++];
+    sample->uptime_s = (uint32_t)(now / 1000000ULL);
+    sample->counter = counter;
+    sample->stack_peak_b = memory.stack_peak_b;
+    sample->heap_b = memory.heap_b;
+    telemetry_stats.samples++;
+
+    if (telemetry_count == TELEMETRY_BATCH_SAMPLES) {
+        telemetry_stats.size_flushes++;
+        telemetry_flush();
+    } else if (telemetry_age_job == SCHED_JOB_NONE) {
+        telemetry_age_job = sched_add(telemetry_flush_due, TELEMETRY_MAX_AGE_US, 0);
+    }
+}
+
+
+/**
+ * @brief Post the samples held, if any, as one request.
+ *
+ * The samples are let go whether or not the request can be queued.
+ */
+void telemetry_flush(void) {
+
+    if (telemetry_age_job != SCHED_JOB_NONE) {
+        sched_cancel(telemetry_age_job);
+        telemetry_age_job = SCHED_JOB_NONE;
+    }
+
+    if (telemetry_count == 0) return;
+    uint32_t samples = telemetry_count;
+
+    // Measure the body, then write it in place in the request
+    struct CborWriter writer;
+    cbor_writer_init(&writer, NULL, 0);
+    telemetry_encode(&writer);
+    uint32_t length = writer.length;
+
+    struct HttpQueueEntry* request = http_request_new(HTTP_LITERAL("POST"));
+    if (request != NULL) {
+        http_request_url(request, HTTP_LITERAL(TELEMETRY_URL));
+        http_request_header(request, HTTP_LITERAL("Content-Type"), HTTP_LITERAL("application/cbor"));
+        uint8_t* body = http_request_body(request, length);
+        if (body != NULL) {
+            cbor_writer_init(&writer, body, length);
+            telemetry_encode(&writer);
+            http_request_compress(request);
+        }
+
+        telemetry_count = 0;
+        uint32_t wire_len = request->wire_len;
+        uint32_t body_len = request->body.length;
+        if (http_request_send(request, telemetry_posted, NULL)) {
+            telemetry_stats.posts++;
+            telemetry_stats.bytes += wire_len;
+            server_log("Posting %lu telemetry samples, %lu bytes", samples, body_len);
+            return;
+        }
+    }
+
+    server_error("Telemetry batch not queued: %lu samples lost", samples);
+    telemetry_stats.dropped += samples;
+    telemetry_count = 0;
+}
+
+
+/**
+ * @brief Copy out the uploader's counters.
+ *
+ * @param stats: Pointer to the record to fill.
+ */
+void telemetry_get_stats(struct TelemetryStats* stats) {
+
+    *stats = telemetry_stats;
+}
+
+
+/**
+ * @brief Log the uploader's counters, and its post rate since the last report.
+ */
+void telemetry_report(void) {
+
+    uint64_t now = 0;
+    mvGetMicroseconds(&now);
+    uint64_t window_us = now - telemetry_report_tick;
+    uint32_t posts = telemetry_stats.posts - telemetry_report_posts;
+    uint32_t per_hour = window_us > 0 ? (uint32_t)((uint64_t)posts * 3600000000ULL / window_us) : 0;
+    uint32_t sent = telemetry_stats.samples - telemetry_stats.dropped - telemetry_count;
+    uint32_t per_sample = sent > 0 ? (uint32_t)(telemetry_stats.bytes / sent) : 0;
+
+    server_log("Telemetry: %lu samples, %lu posts (%lu accepted, %lu failed), %lu samples dropped, %lu size and %lu age flushes, %lu bytes/sample, %lu requests/hour",
+               telemetry_stats.samples, telemetry_stats.posts, telemetry_stats.posted, telemetry_stats.failed,
+               telemetry_stats.dropped, telemetry_stats.size_flushes, telemetry_stats.age_flushes, per_sample, per_hour);
+
+    telemetry_report_tick = now;
+    telemetry_report_posts = telemetry_stats.posts;
+}
+
+
+/**
+ * @brief Scheduled job: post a batch whose first sample has reached TELEMETRY_MAX_AGE_US.
+ */
+static void telemetry_flush_due(void) {
+
+    telemetry_age_job = SCHED_JOB_NONE;
+    telemetry_stats.age_flushes++;
+    telemetry_flush();
+}
+
+
+/**
+ * @brief Write the batch as a request body.
+ *
+ * @param writer: The writer, or counter.
+ */
+static void telemetry_encode(struct CborWriter* writer) {
+
+    uint32_t start = telemetry_batch[0].uptime_s;
+    cbor_map(writer, 2);
+    cbor_text(writer, CBOR_LITERAL("t"));
+    cbor_uint(writer, start);
+    cbor_text(writer, CBOR_LITERAL("s"));
+    cbor_array(writer, telemetry_count);
+    for (uint32_t i = 0 ; i < telemetry_count ; ++i) {
+        const struct TelemetrySample* sample = &telemetry_batch[i];
+        cbor_array(writer, 4);
+        cbor_uint(writer, sample->uptime_s - start);
+        cbor_uint(writer, sample->counter);
+        cbor_uint(writer, sample->stack_peak_b);
+        cbor_uint(writer, sample->heap_b);
+    }
+}
+
+
+/**
+ * @brief Count a batch's response.
+ *
+ * @param response: The response, or the reason the request failed.
+ * @param context:  Unused.
+ */
+static void telemetry_posted(const struct HttpResponse* response, void* context) {
+
+    UNUSED(context);
+    if (response->status == MV_STATUS_OKAY && response->data.result == MV_HTTPRESULT_OK &&
+        response->data.status_code >= 200 && response->data.status_code < 300) {
+        telemetry_stats.posted++;
+        telemetry_stats.bytes += response->data.body_length;
+
+        // A CBOR reply is a map that may hold the post's ID
+        const char* type = headers_get(response->headers, "content-type");
+        uint32_t length = response->data.body_length;
+        if (type != NULL && strcmp(type, "application/cbor") == 0 && length <= TELEMETRY_REPLY_MAX_LEN_B &&
+            http_read_body(response, telemetry_read_reply, NULL) == MV_STATUS_OKAY) {
+            struct CborReader reader;
+            struct CborItem item;
+            cbor_reader_init(&reader, telemetry_reply, length);
+            uint32_t pairs = cbor_read(&reader, &item) && item.type == CBOR_TYPE_MAP ? item.value : 0;
+            for (uint32_t i = 0 ; i < pairs && cbor_read(&reader, &item) ; ++i) {
+                if (cbor_text_equals(&item, CBOR_LITERAL("id"))) {
+                    if (cbor_read(&reader, &item) && item.type == CBOR_TYPE_UINT) server_log("Telemetry accepted as post %lu", item.value);
+                    break;
+                }
+
+                cbor_skip(&reader);
+            }
+
+            if (reader.error) server_error("Telemetry reply is not valid CBOR");
+        }
+    } else {
+        telemetry_stats.failed++;
+        server_error("Telemetry post failed. Status: %i, HTTP status code: %lu", response->status, response->data.status_code);
+    }
+}
+
+
+/**
+ * @brief Copy a batch's reply body, a chunk at a time.
+ */
+static bool telemetry_read_reply(const uint8_t* chunk, uint32_t length, uint32_t offset, void* context) {
+
+    UNUSED(context);
+    memcpy(&telemetry_reply[offset], chunk, length);
+    return true;
+}
@@ -0,0 +1,63 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     TELEMETRY_BATCH_SAMPLES     10            // Flush when this many samples are held...
+#define     TELEMETRY_MAX_AGE_US        600000 * 1000 // ...or when the oldest is this old
+#define     TELEMETRY_REPLY_MAX_LEN_B   32
+#define     TELEMETRY_URL               "https://jsonplaceholder.typicode.com/posts"
+
+
+/*
+ * TYPES
+ */
+struct TelemetrySample {
+    uint32_t    uptime_s;
+    uint32_t    counter;
+    uint32_t    stack_peak_b;
+    uint32_t    heap_b;
+};
+
+struct TelemetryStats {
+    uint32_t    samples;
+    uint32_t    posts;              // Batches queued
+    uint32_t    posted;             // Batches the server accepted
+    uint32_t    failed;             // Batches that failed
+    uint32_t    dropped;            // Samples lost with a batch that couldn't be queued
+    uint32_t    size_flushes;
+    uint32_t    age_flushes;
+    uint64_t    bytes;              // Request bytes sent, and response body bytes received
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+void        telemetry_sample(uint32_t counter);
+void        telemetry_flush(void);
+void        telemetry_get_stats(struct TelemetryStats* stats);
+void        telemetry_report(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _TELEMETRY_H_
@@ -0,0 +1,166 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include "main.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     timestamp_put2(char* buffer, uint32_t value);
+static void     timestamp_set_date(uint32_t days);
+static void     timestamp_set_time(uint32_t seconds);
+
+
+/*
+ * GLOBALS
+ */
+// Two ASCII digits for every value 0-99
+static const char timestamp_digits[200] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// The last wall-clock prefix written, "YYYY-MM-DD HH:MM:SS.", and
+// the day and second it shows. Log lines mostly share a second, and
+// nearly always a day, so most calls only write the milliseconds
+static struct {
+    char        prefix[20];
+    uint32_t    day;
+    uint32_t    second;
+    bool        valid;
+} timestamp_cache = { .prefix = "0000-00-00 00:00:00." };
+
+
+/**
+ * @brief Write a wall-clock time as "YYYY-MM-DD HH:MM:SS.mmm ".
+ *
+ * Gives the same text as `strftime("%F %T")` on `gmtime()` followed by
+ * the milliseconds, but recomputes the date only when the day changes
+ * and the time only when the second does.
+ *
+ * @param buffer:  At least TIMESTAMP_WALL_LEN_B + 1 bytes.
+ * @param wall_us: Microseconds since the Unix epoch, eg. from `mvGetWallTime()`.
+ *
+ * @returns The length of the text, excluding the NUL.
+ */
+uint32_t timestamp_format_wall(char* buffer, uint64_t wall_us) {
+
+    uint64_t seconds = wall_us / 1000000;
+    uint32_t day = (uint32_t)(seconds / TIMESTAMP_SECONDS_PER_DAY);
+    uint32_t second = (uint32_t)(seconds - (uint64_t)day * TIMESTAMP_SECONDS_PER_DAY);
+
+    if (!timestamp_cache.valid || day != timestamp_cache.day) {
+        timestamp_set_date(day);
+        timestamp_set_time(second);
+        timestamp_cache.valid = true;
+    } else if (second != timestamp_cache.second) {
+        timestamp_set_time(second);
+    }
+
+    memcpy(buffer, timestamp_cache.prefix, 20);
+
+    uint32_t msec = (uint32_t)(wall_us / 1000 % 1000);
+    buffer[20] = (char)('0' + msec / 100);
+    timestamp_put2(&buffer[21], msec % 100);
+    buffer[23] = ' ';
+    buffer[24] = 0;
+    return TIMESTAMP_WALL_LEN_B;
+}
+
+
+/**
+ * @brief Write a monotonic time as "S.uuuuuu ", eg. "1234.000567 ".
+ *
+ * @param buffer: At least TIMESTAMP_MONOTONIC_MAX_LEN_B + 1 bytes.
+ * @param usec:   Microseconds, eg. from `mvGetMicroseconds()`.
+ *
+ * @returns The length of the text, excluding the NUL.
+ */
+uint32_t timestamp_format_monotonic(char* buffer, uint64_t usec) {
+
+    // Write the seconds backwards, two digits at a time, then move them up
+    char digits[20];
+    uint32_t count = 0;
+    uint64_t seconds = usec / 1000000;
+    do {
+        uint32_t pair = (uint32_t)(seconds % 100);
+        seconds /= 100;
+        digits[count++] = timestamp_digits[pair * 2 + 1];
+        if (seconds > 0 || pair >= 10) digits[count++] = timestamp_digits[pair * 2];
+    } while (seconds > 0);
+
+    uint32_t length = 0;
+    while (count > 0) buffer[length++] = digits[--count];
+
+    uint32_t fraction = (uint32_t)(usec % 1000000);
+    buffer[length++] = '.';
+    timestamp_put2(&buffer[length], fraction / 10000);
+    timestamp_put2(&buffer[length + 2], fraction / 100 % 100);
+    timestamp_put2(&buffer[length + 4], fraction % 100);
+    length += 6;
+    buffer[length++] = ' ';
+    buffer[length] = 0;
+    return length;
+}
+
+
+/**
+ * @brief Write a value 0-99 as two ASCII digits.
+ */
+static void timestamp_put2(char* buffer, uint32_t value) {
+
+    buffer[0] = timestamp_digits[value * 2];
+    buffer[1] = timestamp_digits[value * 2 + 1];
+}
+
+
+/**
+ * @brief Write the cached prefix's date.
+ *
+ * Converts days since the epoch to a proleptic Gregorian date, after
+ * Howard Hinnant's `civil_from_days()`, with no calls to `gmtime()`.
+ *
+ * @param days: Days since 1970-01-01.
+ */
+static void timestamp_set_date(uint32_t days) {
+
+    uint32_t shifted = days + 719468;
+    uint32_t era = shifted / 146097;
+    uint32_t day_of_era = shifted - era * 146097;
+    uint32_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    uint32_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    uint32_t month_index = (5 * day_of_year + 2) / 153;
+    uint32_t day = day_of_year - (153 * month_index + 2) / 5 + 1;
+    uint32_t month = month_index < 10 ? month_index + 3 : month_index - 9;
+    uint32_t year = year_of_era + era * 400 + (month <= 2 ? 1 : 0);
+
+    timestamp_put2(&timestamp_cache.prefix[0], year / 100 % 100);
+    timestamp_put2(&timestamp_cache.prefix[2], year % 100);
+    timestamp_put2(&timestamp_cache.prefix[5], month);
+    timestamp_put2(&timestamp_cache.prefix[8], day);
+    timestamp_cache.prefix[4] = '-';
+    timestamp_cache.prefix[7] = '-';
+    timestamp_cache.day = days;
+}
+
+
+/**
+ * @brief Write the cached prefix's time of day.
+ *
+ * @param seconds: Seconds since midnight.
+ */
+static void timestamp_set_time(uint32_t seconds) {
+
+    timestamp_put2(&timestamp_cache.prefix[11], seconds / 3600);
+    timestamp_put2(&timestamp_cache.prefix[14], seconds / 60 % 60);
+    timestamp_put2(&timestamp_cache.prefix[17], seconds % 60);
+    timestamp_cache.second = seconds;
+}
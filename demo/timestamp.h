@@ -0,0 +1,38 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _TIMESTAMP_H_
+#define _TIMESTAMP_H_
+
+
+/*
+ * CONSTANTS
+ */
+#define     TIMESTAMP_WALL_LEN_B        24            // "2022-05-10 13:30:58.123 "
+#define     TIMESTAMP_MONOTONIC_MAX_LEN_B 22          // "18446744073709.551615 "
+#define     TIMESTAMP_SECONDS_PER_DAY   86400
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+uint32_t    timestamp_format_wall(char* buffer, uint64_t wall_us);
+uint32_t    timestamp_format_monotonic(char* buffer, uint64_t usec);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _TIMESTAMP_H_
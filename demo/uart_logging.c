@@ -6,10 +6,37 @@
  * Licence: MIT
  *
  */
+#define     LOG_MODULE      LOG_MODULE_UART
 #include "main.h"
 
 
+/*
+ * STATIC PROTOTYPES
+ */
+static void log_uart_write(const char* text);
+static void log_uart_kick(void);
+static uint64_t log_uart_now(void);
+
+
+/*
+ * GLOBALS
+ */
 static UART_HandleTypeDef log_uart;
+static DMA_HandleTypeDef log_uart_dma;
+
+// Double-buffered transmit: the DMA sends one buffer while log
+// output is copied into the other. Shared with the DMA ISRs, so
+// only touched with interrupts masked
+static struct {
+    uint8_t             buffers[2][UART_DMA_BUFFER_SIZE_B];
+    uint32_t            fill;                   // The buffer being filled
+    uint32_t            fill_length;
+    volatile bool       busy;                   // A transfer is in progress
+} log_uart_tx;
+
+static struct UartStats log_uart_stats = { 0 };
+static uint64_t log_uart_report_tick = 0;
+static uint32_t log_uart_report_bytes = 0;
 
 
 /**
@@ -73,6 +100,36 @@ void HAL_UART_MspInit(UART_HandleTypeDef *uart) {
 
     // Enable the UART clock
     __HAL_RCC_USART2_CLK_ENABLE()
+
+    // Configure a GPDMA channel to feed the UART's transmit register
+    __HAL_RCC_GPDMA1_CLK_ENABLE();
+    log_uart_dma.Instance                   = GPDMA1_Channel0;
+    log_uart_dma.Init.Request               = GPDMA1_REQUEST_USART2_TX;
+    log_uart_dma.Init.BlkHWRequest          = DMA_BREQ_SINGLE_BURST;
+    log_uart_dma.Init.Direction             = DMA_MEMORY_TO_PERIPH;
+    log_uart_dma.Init.SrcInc                = DMA_SINC_INCREMENTED;
+    log_uart_dma.Init.DestInc               = DMA_DINC_FIXED;
+    log_uart_dma.Init.SrcDataWidth          = DMA_SRC_DATAWIDTH_BYTE;
+    log_uart_dma.Init.DestDataWidth         = DMA_DEST_DATAWIDTH_BYTE;
+    log_uart_dma.Init.Priority              = DMA_LOW_PRIORITY_LOW_WEIGHT;
+    log_uart_dma.Init.SrcBurstLength        = 1;
+    log_uart_dma.Init.DestBurstLength       = 1;
+    log_uart_dma.Init.TransferAllocatedPort = DMA_SRC_ALLOCATED_PORT0 | DMA_DEST_ALLOCATED_PORT0;
+    log_uart_dma.Init.TransferEventMode     = DMA_TCEM_BLOCK_TRANSFER;
+    log_uart_dma.Init.Mode                  = DMA_NORMAL;
+    if (HAL_DMA_Init(&log_uart_dma) != HAL_OK) {
+        server_error("Could not enable logging UART DMA");
+        return;
+    }
+
+    __HAL_LINKDMA(uart, hdmatx, log_uart_dma);
+
+    // The DMA interrupt hands over to the UART's transmission-complete
+    // interrupt, which calls `HAL_UART_TxCpltCallback()`
+    HAL_NVIC_SetPriority(GPDMA1_Channel0_IRQn, TICK_INT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(GPDMA1_Channel0_IRQn);
+    HAL_NVIC_SetPriority(USART2_IRQn, TICK_INT_PRIORITY, 0);
+    HAL_NVIC_EnableIRQ(USART2_IRQn);
 }
 
 
@@ -80,43 +137,175 @@ void HAL_UART_MspInit(UART_HandleTypeDef *uart) {
  * @brief Output a UART-friendly log string, ie. one with
  *        RETURN+NEWLINE in place of NEWLINE.
  *
+ * The string is copied for DMA transmission, so this returns at once
+ * unless both transmit buffers are full.
+ *
  * @param buffer: Source string.
- * @param length: String character count.
  */
 void log_uart_output(const char* buffer) {
 
-    static char uart_buffer[UART_LOG_TIMESTAMP_MAX_LEN_B + UART_LOG_MESSAGE_MAX_LEN_B + 3] = {0};
-
+    PROFILE_SCOPE("log_uart_output");
+    char timestamp[UART_LOG_TIMESTAMP_MAX_LEN_B];
     uint64_t usec = 0;
-    time_t sec = 0;
-    time_t msec = 0;
-
-    enum MvStatus status = mvGetWallTime(&usec);
-    if (status == MV_STATUS_OKAY) {
-        // Get the second and millisecond times
-        sec = (time_t)usec / 1000000;
-        msec = (time_t)usec / 1000;
-    }
 
-    // Write time string as "2022-05-10 13:30:58.XXX "
-    strftime(uart_buffer, 64, "%F %T.XXX ", gmtime(&sec));
-    // Insert the millisecond time over the XXX
-    sprintf(&uart_buffer[20], "%03u ", (unsigned)(msec % 1000));
-    const uint32_t length = strlen(uart_buffer);
-
-    // Write the timestamp to the message
-    sprintf(&uart_buffer[length], "%s\n", buffer);
-
-    // Send uart_buffer to the UART
-    const char nls[2] = "\r\n";
-    const char *buf_ptr = uart_buffer;
-    while(*buf_ptr != 0) {
-        if (*buf_ptr == '\n') {
-            HAL_UART_Transmit(&log_uart, (const uint8_t*)nls, 2, 100);
-        } else {
-            HAL_UART_Transmit(&log_uart, (const uint8_t*)buf_ptr, 1, 100);
+#if UART_LOG_MONOTONIC_TIME == true
+    // Write time since boot as "1234.000567 "
+    mvGetMicroseconds(&usec);
+    timestamp_format_monotonic(timestamp, usec);
+#else
+    // Write time string as "2022-05-10 13:30:58.123 "
+    if (mvGetWallTime(&usec) != MV_STATUS_OKAY) usec = 0;
+    timestamp_format_wall(timestamp, usec);
+#endif
+
+    log_uart_write(timestamp);
+    log_uart_write(buffer);
+    log_uart_write("\n");
+}
+
+
+/**
+ * @brief Copy a string into the transmit buffers, expanding
+ *        NEWLINE to RETURN+NEWLINE as it goes.
+ *
+ * Starts a transfer if the DMA is idle. If the string doesn't fit,
+ * waits for the DMA to free a buffer: the only time this blocks.
+ *
+ * @param text: The string.
+ */
+static void log_uart_write(const char* text) {
+
+    __disable_irq();
+    while (*text != 0) {
+        // Leave room for an expanded NEWLINE
+        uint8_t* buffer = log_uart_tx.buffers[log_uart_tx.fill];
+        uint32_t length = log_uart_tx.fill_length;
+        while (*text != 0 && length < UART_DMA_BUFFER_SIZE_B - 1) {
+            if (*text == '\n') buffer[length++] = '\r';
+            buffer[length++] = (uint8_t)*text++;
+        }
+
+        log_uart_tx.fill_length = length;
+        if (!log_uart_tx.busy) log_uart_kick();
+        if (*text == 0) break;
+
+        // Both buffers are full: sleep until the transfer completes and
+        // its handler hands over the buffer being filled, so this one
+        // is free. The pending interrupt wakes WFI; its handler runs once
+        // interrupts are unmasked
+        uint64_t start = log_uart_now();
+        log_uart_stats.waits++;
+        while (log_uart_tx.fill_length >= UART_DMA_BUFFER_SIZE_B - 1) {
+            __WFI();
+            __enable_irq();
+            __disable_irq();
         }
 
-        buf_ptr++;
+        log_uart_stats.blocked_us += log_uart_now() - start;
+    }
+
+    __enable_irq();
+}
+
+
+/**
+ * @brief Start sending the buffer being filled, and fill the other.
+ *
+ * If the DMA won't take the buffer, its contents are dropped, so a
+ * writer waiting for room is never left waiting on a transfer that
+ * didn't start.
+ *
+ * Call with interrupts masked, or from the DMA ISR.
+ */
+static void log_uart_kick(void) {
+
+    if (log_uart_tx.busy || log_uart_tx.fill_length == 0) return;
+
+    uint32_t length = log_uart_tx.fill_length;
+    if (HAL_UART_Transmit_DMA(&log_uart, log_uart_tx.buffers[log_uart_tx.fill], (uint16_t)length) != HAL_OK) {
+        log_uart_tx.fill_length = 0;
+        log_uart_stats.failures++;
+        log_uart_stats.dropped_b += length;
+        return;
     }
+
+    log_uart_tx.busy = true;
+    log_uart_tx.fill ^= 1;
+    log_uart_tx.fill_length = 0;
+    log_uart_stats.bytes += length;
+    log_uart_stats.transfers++;
+}
+
+
+/**
+ * @brief HAL-called function on completion of a UART transmission.
+ *
+ * Sends whatever has been queued while the transfer was in progress.
+ *
+ * @param uart: A HAL UART_HandleTypeDef pointer to the UART instance.
+ */
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *uart) {
+
+    if (uart != &log_uart) return;
+    log_uart_tx.busy = false;
+    log_uart_kick();
+}
+
+
+/**
+ * @brief Copy out the UART transmitter's counters.
+ *
+ * @param stats: Pointer to the record to fill.
+ */
+void log_uart_get_stats(struct UartStats* stats) {
+
+    *stats = log_uart_stats;
+}
+
+
+/**
+ * @brief Log the UART transmitter's throughput and blocked time.
+ *
+ * Throughput is measured over the time since the previous report.
+ */
+void log_uart_report(void) {
+
+    uint64_t now = log_uart_now();
+    uint64_t window_us = now - log_uart_report_tick;
+    uint32_t bytes = log_uart_stats.bytes - log_uart_report_bytes;
+    uint32_t per_sec = window_us > 0 ? (uint32_t)((uint64_t)bytes * 1000000ULL / window_us) : 0;
+
+    server_log("UART: %lu bytes in %lu transfers, %lu bytes/s, %lu waits for a buffer, %lu us blocked, %lu failed transfers (%lu bytes dropped)",
+               log_uart_stats.bytes, log_uart_stats.transfers, per_sec,
+               log_uart_stats.waits, (uint32_t)log_uart_stats.blocked_us,
+               log_uart_stats.failures, log_uart_stats.dropped_b);
+
+    log_uart_report_tick = now;
+    log_uart_report_bytes = log_uart_stats.bytes;
+}
+
+
+/**
+ * @brief Read the Microvisor microsecond clock.
+ */
+static uint64_t log_uart_now(void) {
+
+    uint64_t tick = 0;
+    mvGetMicroseconds(&tick);
+    return tick;
+}
+
+
+/*
+ * INTERRUPT HANDLERS
+ */
+void GPDMA1_Channel0_IRQHandler(void) {
+
+    HAL_DMA_IRQHandler(&log_uart_dma);
+}
+
+
+void USART2_IRQHandler(void) {
+
+    HAL_UART_IRQHandler(&log_uart);
 }
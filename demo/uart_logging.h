@@ -14,7 +14,20 @@
  * CONSTANTS
  */
 #define UART_LOG_TIMESTAMP_MAX_LEN_B        64
-#define UART_LOG_MESSAGE_MAX_LEN_B          1024
+#define UART_DMA_BUFFER_SIZE_B              512
+
+
+/*
+ * TYPES
+ */
+struct UartStats {
+    uint32_t    bytes;              // Bytes handed to the DMA, after CRLF expansion
+    uint32_t    transfers;          // DMA transfers started
+    uint32_t    waits;              // Writes that found both buffers full
+    uint32_t    failures;           // Transfers the DMA refused...
+    uint32_t    dropped_b;          // ...and the bytes they would have sent
+    uint64_t    blocked_us;         // Time spent waiting for a buffer
+};
 
 
 #ifdef __cplusplus
@@ -27,6 +40,8 @@ extern "C" {
  */
 bool    log_uart_init(void);
 void    log_uart_output(const char* buffer);
+void    log_uart_get_stats(struct UartStats* stats);
+void    log_uart_report(void);
 
 
 #ifdef __cplusplus
@@ -0,0 +1,55 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host micro-benchmark helpers
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdint.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_MIN_RUN_NS            200000000ULL  // Repeat each case for at least this long
+
+
+/**
+ * @brief Read the host's cycle counter.
+ *
+ * Falls back to nanoseconds where there is no cycle counter to read,
+ * in which case "cycles" in the reports are nanoseconds.
+ */
+static inline uint64_t bench_cycles(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+
+/**
+ * @brief Read the host's monotonic clock in nanoseconds.
+ */
+static inline uint64_t bench_ns(void) {
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+
+#endif      // _BENCH_H_
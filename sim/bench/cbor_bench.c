@@ -0,0 +1,235 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host benchmark of the CBOR encoder against snprintf() JSON
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "main.h"
+#include "bench.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_BODY_MAX_LEN_B        1024
+
+
+/*
+ * TYPES
+ */
+struct bench_batch {
+    const char*             name;
+    struct TelemetrySample  samples[TELEMETRY_BATCH_SAMPLES];
+    uint32_t                count;
+};
+
+
+/*
+ * GLOBALS
+ */
+static struct bench_batch bench_batches[3] = {
+    { .name = "first" },
+    { .name = "day" },
+    { .name = "month" }
+};
+
+static uint8_t bench_body[BENCH_BODY_MAX_LEN_B];
+
+
+/**
+ * @brief Fill a batch as the telemetry stage would, `start_s` into the run.
+ */
+static void bench_fill(struct bench_batch* batch, uint32_t start_s, uint32_t count) {
+
+    batch->count = count;
+    for (uint32_t i = 0 ; i < count ; ++i) {
+        struct TelemetrySample* sample = &batch->samples[i];
+        sample->uptime_s = start_s + i * 30;
+        sample->counter = 42 + sample->uptime_s / 30;
+        sample->stack_peak_b = 4164;
+        sample->heap_b = 0;
+    }
+}
+
+
+/**
+ * @brief Encode a batch as JSON, as the telemetry stage did before CBOR.
+ */
+static uint32_t bench_encode_json(const struct bench_batch* batch, char* body, uint32_t size) {
+
+    uint32_t start = batch->samples[0].uptime_s;
+    int length = snprintf(body, size, "{\"t\":%u,\"s\":[", start);
+    for (uint32_t i = 0 ; i < batch->count ; ++i) {
+        const struct TelemetrySample* sample = &batch->samples[i];
+        length += snprintf(&body[length], size - length, "%s[%u,%u,%u,%u]", i > 0 ? "," : "",
+                           sample->uptime_s - start, sample->counter, sample->stack_peak_b, sample->heap_b);
+    }
+
+    length += snprintf(&body[length], size - length, "]}");
+    return (uint32_t)length;
+}
+
+
+/**
+ * @brief Encode a batch as CBOR, as the telemetry stage does, or with
+ *        no buffer, measure it.
+ */
+static uint32_t bench_encode_cbor(const struct bench_batch* batch, uint8_t* body, uint32_t size) {
+
+    struct CborWriter writer;
+    cbor_writer_init(&writer, body, size);
+
+    uint32_t start = batch->samples[0].uptime_s;
+    cbor_map(&writer, 2);
+    cbor_text(&writer, CBOR_LITERAL("t"));
+    cbor_uint(&writer, start);
+    cbor_text(&writer, CBOR_LITERAL("s"));
+    cbor_array(&writer, batch->count);
+    for (uint32_t i = 0 ; i < batch->count ; ++i) {
+        const struct TelemetrySample* sample = &batch->samples[i];
+        cbor_array(&writer, 4);
+        cbor_uint(&writer, sample->uptime_s - start);
+        cbor_uint(&writer, sample->counter);
+        cbor_uint(&writer, sample->stack_peak_b);
+        cbor_uint(&writer, sample->heap_b);
+    }
+
+    return writer.overflow ? 0 : writer.length;
+}
+
+
+/**
+ * @brief Decode a CBOR batch and check it against the original.
+ *
+ * @returns `true` if every value reads back, otherwise `false`.
+ */
+static bool bench_decode_cbor(const struct bench_batch* batch, const uint8_t* body, uint32_t length) {
+
+    struct CborReader reader;
+    struct CborItem item;
+    cbor_reader_init(&reader, body, length);
+    if (!cbor_read(&reader, &item) || item.type != CBOR_TYPE_MAP || item.value != 2) return false;
+
+    uint32_t start = 0;
+    for (uint32_t pair = 0 ; pair < 2 ; ++pair) {
+        if (!cbor_read(&reader, &item)) return false;
+        if (cbor_text_equals(&item, CBOR_LITERAL("t"))) {
+            if (!cbor_read(&reader, &item) || item.type != CBOR_TYPE_UINT) return false;
+            start = item.value;
+            continue;
+        }
+
+        if (!cbor_text_equals(&item, CBOR_LITERAL("s"))) return false;
+        if (!cbor_read(&reader, &item) || item.type != CBOR_TYPE_ARRAY || item.value != batch->count) return false;
+        for (uint32_t i = 0 ; i < batch->count ; ++i) {
+            const struct TelemetrySample* sample = &batch->samples[i];
+            const uint32_t expected[4] = { sample->uptime_s - start, sample->counter, sample->stack_peak_b, sample->heap_b };
+            if (!cbor_read(&reader, &item) || item.type != CBOR_TYPE_ARRAY || item.value != 4) return false;
+            for (uint32_t j = 0 ; j < 4 ; ++j) {
+                if (!cbor_read(&reader, &item) || item.type != CBOR_TYPE_UINT || item.value != expected[j]) return false;
+            }
+        }
+    }
+
+    // Nothing may follow, and skipping the whole body must land at its end
+    if (reader.offset != length || reader.error) return false;
+    cbor_reader_init(&reader, body, length);
+    return cbor_skip(&reader) && reader.offset == length;
+}
+
+
+/**
+ * @brief Time repeated calls of an encoder, or the decoder, on one batch.
+ *
+ * @returns Mean cycles per call.
+ */
+static double bench_time(const struct bench_batch* batch, uint32_t which) {
+
+    uint64_t cycles = 0;
+    uint64_t runs = 0;
+    uint64_t start_ns = bench_ns();
+    uint32_t length = bench_encode_cbor(batch, bench_body, sizeof(bench_body));
+
+    while (bench_ns() - start_ns < BENCH_MIN_RUN_NS) {
+        uint64_t start = bench_cycles();
+        for (uint32_t i = 0 ; i < 100 ; ++i) {
+            if (which == 0) {
+                bench_encode_json(batch, (char*)bench_body, sizeof(bench_body));
+            } else if (which == 1) {
+                bench_encode_cbor(batch, bench_body, sizeof(bench_body));
+            } else {
+                bench_decode_cbor(batch, bench_body, length);
+            }
+
+            __asm__ volatile("" : : "r"(bench_body) : "memory");
+        }
+
+        cycles += bench_cycles() - start;
+        runs += 100;
+    }
+
+    return (double)cycles / (double)runs;
+}
+
+
+int main(void) {
+
+    // A first batch, one a day in and one a month in: the counter and
+    // uptime grow, and their encodings with them
+    bench_fill(&bench_batches[0], 15, TELEMETRY_BATCH_SAMPLES);
+    bench_fill(&bench_batches[1], 86400, TELEMETRY_BATCH_SAMPLES);
+    bench_fill(&bench_batches[2], 2592000, TELEMETRY_BATCH_SAMPLES);
+
+    uint32_t failures = 0;
+    printf("Telemetry batches of %u samples\n\n", TELEMETRY_BATCH_SAMPLES);
+    printf("%-6s %10s %10s %10s %12s %12s %12s\n", "Batch", "JSON B", "CBOR B", "Saved", "JSON cycles", "CBOR cycles", "Decode");
+
+    for (uint32_t i = 0 ; i < 3 ; ++i) {
+        const struct bench_batch* batch = &bench_batches[i];
+        uint32_t json_len = bench_encode_json(batch, (char*)bench_body, sizeof(bench_body));
+        uint32_t cbor_len = bench_encode_cbor(batch, bench_body, sizeof(bench_body));
+        if (cbor_len == 0 || !bench_decode_cbor(batch, bench_body, cbor_len)) {
+            fprintf(stderr, "cbor: %s batch did not read back\n", batch->name);
+            failures++;
+        }
+
+        // Measuring without a buffer must agree with writing
+        if (bench_encode_cbor(batch, NULL, 0) != cbor_len) {
+            fprintf(stderr, "cbor: %s batch measured wrong\n", batch->name);
+            failures++;
+        }
+
+        printf("%-6s %10u %10u %9.0f%% %12.1f %12.1f %12.1f\n", batch->name, json_len, cbor_len,
+               100.0 * (double)(json_len - cbor_len) / (double)json_len,
+               bench_time(batch, 0), bench_time(batch, 1), bench_time(batch, 2));
+    }
+
+    // Malformed input is refused, not read past
+    const uint8_t truncated[] = { 0x82, 0x19, 0x01 };
+    const uint8_t too_many[] = { 0x9A, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+    struct CborReader reader;
+    cbor_reader_init(&reader, truncated, sizeof(truncated));
+    if (cbor_skip(&reader) || !reader.error) {
+        fprintf(stderr, "cbor: truncated input not refused\n");
+        failures++;
+    }
+
+    cbor_reader_init(&reader, too_many, sizeof(too_many));
+    if (cbor_skip(&reader) || !reader.error) {
+        fprintf(stderr, "cbor: oversized array not refused\n");
+        failures++;
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "\n%u check(s) failed\n", failures);
+        return 1;
+    }
+
+    printf("\nAll checks passed\n");
+    return 0;
+}
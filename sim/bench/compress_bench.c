@@ -0,0 +1,233 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host benchmark of the LZSS compressor on the app's own log output
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "main.h"
+#include "bench.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_CORPUS_MAX_B          65536
+#define     BENCH_CORPUS_MAX_LINES      2048
+#define     BENCH_STREAM_WRITE_B        97            // Feed the stream in odd-sized pieces
+
+
+/*
+ * GLOBALS
+ */
+// Lines of `post_log()` output from an hour of the simulator, with a
+// network drop and a rate-limited server
+static uint8_t bench_corpus[BENCH_CORPUS_MAX_B];
+static uint32_t bench_corpus_len = 0;
+static uint32_t bench_line_start[BENCH_CORPUS_MAX_LINES];
+static uint32_t bench_line_len[BENCH_CORPUS_MAX_LINES];
+static uint32_t bench_lines = 0;
+
+static struct Compressor bench_compressor;
+static uint8_t bench_packed[COMPRESS_BOUND(BENCH_CORPUS_MAX_B)];
+static uint8_t bench_expanded[BENCH_CORPUS_MAX_B];
+static char bench_record[LOG_MESSAGE_MAX_LEN_B];
+static uint32_t bench_failures = 0;
+
+
+/**
+ * @brief Read the corpus and find its lines.
+ *
+ * @returns `true` if the corpus was read, otherwise `false`.
+ */
+static bool bench_load(const char* path) {
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return false;
+    bench_corpus_len = (uint32_t)fread(bench_corpus, 1, sizeof(bench_corpus), file);
+    fclose(file);
+
+    uint32_t start = 0;
+    for (uint32_t i = 0 ; i < bench_corpus_len && bench_lines < BENCH_CORPUS_MAX_LINES ; ++i) {
+        if (bench_corpus[i] != '\n') continue;
+        bench_line_start[bench_lines] = start;
+        bench_line_len[bench_lines++] = i - start;
+        start = i + 1;
+    }
+
+    return bench_lines > 0;
+}
+
+
+/**
+ * @brief Compress the whole corpus as one stream, as an upload would be.
+ *
+ * @returns The compressed length.
+ */
+static uint32_t bench_stream(void) {
+
+    compress_init(&bench_compressor, bench_packed, sizeof(bench_packed), NULL, 0);
+    for (uint32_t offset = 0 ; offset < bench_corpus_len ; offset += BENCH_STREAM_WRITE_B) {
+        uint32_t length = bench_corpus_len - offset < BENCH_STREAM_WRITE_B ? bench_corpus_len - offset : BENCH_STREAM_WRITE_B;
+        compress_write(&bench_compressor, &bench_corpus[offset], length);
+    }
+
+    return compress_finish(&bench_compressor);
+}
+
+
+/**
+ * @brief Send the corpus as the logger does with LOG_COMPRESS: up to
+ *        `batch` messages at a time, each batch compressed on its own
+ *        and sent as a record if that's shorter than the text.
+ *
+ * @param batch:      The most messages per record.
+ * @param dictionary: Preload LOG_COMPRESS_DICTIONARY?
+ * @param check:      Decompress each record and compare it with the text?
+ *
+ * @returns The bytes sent.
+ */
+static uint64_t bench_batches(uint32_t batch, bool dictionary, bool check) {
+
+    const uint8_t* dict = dictionary ? (const uint8_t*)LOG_COMPRESS_DICTIONARY : NULL;
+    uint32_t dict_len = dictionary ? sizeof(LOG_COMPRESS_DICTIONARY) - 1 : 0;
+    uint64_t sent = 0;
+
+    for (uint32_t line = 0 ; line < bench_lines ; ) {
+        uint32_t count = 0;
+        uint32_t text = 0;
+        uint32_t raw = 0;
+        compress_init(&bench_compressor, bench_packed, sizeof(bench_packed), dict, dict_len);
+        while (count < batch && line + count < bench_lines) {
+            uint32_t length = bench_line_len[line + count];
+            if (count > 0 && raw + 1 + length > LOG_COMPRESS_BATCH_MAX_B) break;
+            if (count > 0) compress_write(&bench_compressor, (const uint8_t*)"\n", 1);
+            compress_write(&bench_compressor, &bench_corpus[bench_line_start[line + count]], length);
+            raw += (count > 0 ? 1 : 0) + length;
+            text += length;
+            count++;
+        }
+
+        uint32_t packed = compress_finish(&bench_compressor);
+        uint32_t length = packed > 0 ? log_armor(bench_record, sizeof(bench_record), LOG_COMPRESS_MARKER, bench_packed, packed) : 0;
+        sent += length > 0 && length < text ? length : text;
+
+        if (check) {
+            uint32_t expanded = 0;
+            if (packed == 0 ||
+                !compress_expand(bench_packed, packed, bench_expanded, sizeof(bench_expanded), dict, dict_len, &expanded) ||
+                expanded != raw || memcmp(bench_expanded, &bench_corpus[bench_line_start[line]], raw) != 0) {
+                fprintf(stderr, "compress: batch at line %u did not read back\n", line + 1);
+                bench_failures++;
+            }
+        }
+
+        line += count;
+    }
+
+    return sent;
+}
+
+
+int main(void) {
+
+    if (!bench_load(BENCH_LOG_CORPUS)) {
+        fprintf(stderr, "compress: cannot read %s\n", BENCH_LOG_CORPUS);
+        return 1;
+    }
+
+    printf("Log corpus: %u lines, %u bytes. Window %u bytes, copies of up to %u\n\n",
+           bench_lines, bench_corpus_len, COMPRESS_WINDOW_B, COMPRESS_MATCH_MAX_B);
+
+    // One stream: ratio, and cycles a byte each way
+    uint32_t packed = bench_stream();
+    uint32_t expanded = 0;
+    if (packed == 0 || !compress_expand(bench_packed, packed, bench_expanded, sizeof(bench_expanded), NULL, 0, &expanded) ||
+        expanded != bench_corpus_len || memcmp(bench_expanded, bench_corpus, expanded) != 0) {
+        fprintf(stderr, "compress: stream did not read back\n");
+        bench_failures++;
+    }
+
+    uint64_t cycles = 0;
+    uint64_t runs = 0;
+    uint64_t start_ns = bench_ns();
+    while (bench_ns() - start_ns < BENCH_MIN_RUN_NS) {
+        uint64_t start = bench_cycles();
+        bench_stream();
+        cycles += bench_cycles() - start;
+        runs++;
+    }
+
+    double compress_cycles = (double)cycles / (double)runs / bench_corpus_len;
+    cycles = 0;
+    runs = 0;
+    start_ns = bench_ns();
+    while (bench_ns() - start_ns < BENCH_MIN_RUN_NS) {
+        uint64_t start = bench_cycles();
+        compress_expand(bench_packed, packed, bench_expanded, sizeof(bench_expanded), NULL, 0, &expanded);
+        __asm__ volatile("" : : "r"(bench_expanded) : "memory");
+        cycles += bench_cycles() - start;
+        runs++;
+    }
+
+    printf("Stream: %u to %u bytes (%.0f%%), compress %.1f cycles/byte, expand %.1f cycles/byte\n\n",
+           bench_corpus_len, packed, 100.0 * packed / bench_corpus_len,
+           compress_cycles, (double)cycles / (double)runs / bench_corpus_len);
+
+    // Log records, as sent with LOG_COMPRESS. The text excludes each
+    // message's newline, which the log channel doesn't carry
+    uint64_t text = bench_corpus_len - bench_lines;
+    const uint32_t batches[] = { 1, 3, LOG_DRAIN_BATCH };
+    printf("%-10s %12s %12s %16s\n", "Messages", "Plain B", "Dictionary B", "Dictionary cycles");
+    for (uint32_t i = 0 ; i < sizeof(batches) / sizeof(batches[0]) ; ++i) {
+        uint64_t plain = bench_batches(batches[i], false, true);
+        uint64_t primed = bench_batches(batches[i], true, true);
+
+        cycles = 0;
+        runs = 0;
+        start_ns = bench_ns();
+        while (bench_ns() - start_ns < BENCH_MIN_RUN_NS) {
+            uint64_t start = bench_cycles();
+            bench_batches(batches[i], true, false);
+            cycles += bench_cycles() - start;
+            runs++;
+        }
+
+        printf("%-10u %7lu %3.0f%% %7lu %3.0f%% %11.1f/byte\n", batches[i],
+               (unsigned long)plain, 100.0 * plain / text, (unsigned long)primed, 100.0 * primed / text,
+               (double)cycles / (double)runs / text);
+    }
+
+    // Output that won't fit, and input that refers back before its start, are refused
+    struct Compressor small;
+    uint8_t tiny[16];
+    compress_init(&small, tiny, sizeof(tiny), NULL, 0);
+    compress_write(&small, bench_corpus, 256);
+    if (compress_finish(&small) != 0) {
+        fprintf(stderr, "compress: overflow not reported\n");
+        bench_failures++;
+    }
+
+    const uint8_t before_start[] = { 0x00, 0x10, 0x00 };
+    if (compress_expand(before_start, sizeof(before_start), bench_expanded, sizeof(bench_expanded), NULL, 0, &expanded)) {
+        fprintf(stderr, "compress: copy from before the start not refused\n");
+        bench_failures++;
+    }
+
+    if (compress_expand(bench_packed, packed, bench_expanded, 100, NULL, 0, &expanded)) {
+        fprintf(stderr, "compress: expansion past the output not refused\n");
+        bench_failures++;
+    }
+
+    if (bench_failures > 0) {
+        fprintf(stderr, "\n%u check(s) failed\n", bench_failures);
+        return 1;
+    }
+
+    printf("\nAll checks passed\n");
+    return 0;
+}
@@ -0,0 +1,155 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host benchmark of the streaming JSON tokenizer
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "main.h"
+#include "bench.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_PAYLOAD_MAX_LEN_B     32768
+#define     BENCH_TODO_COUNT            200
+
+
+/*
+ * TYPES
+ */
+struct bench_payload {
+    const char*         name;
+    char                text[BENCH_PAYLOAD_MAX_LEN_B];
+    uint32_t            length;
+    const char* const*  paths;
+    uint32_t            num_paths;
+};
+
+
+/*
+ * GLOBALS
+ */
+static const char* const bench_todo_paths[] = { "id", "title", "completed" };
+static const char* const bench_list_paths[] = { "[].id", "[].title", "[].completed" };
+static const char* const bench_user_paths[] = { "address.geo.lat", "address.geo.lng", "company.name" };
+
+static struct bench_payload bench_payloads[3] = {
+    { .name = "todo",   .paths = bench_todo_paths, .num_paths = 3 },
+    { .name = "todos",  .paths = bench_list_paths, .num_paths = 3 },
+    { .name = "user",   .paths = bench_user_paths, .num_paths = 3 }
+};
+
+static uint32_t bench_values = 0;
+
+
+/**
+ * @brief Count matched values. Does no other work, so the
+ *        benchmark measures the tokenizer alone.
+ */
+static void bench_count_value(const struct JsonValue* value, void* context) {
+
+    UNUSED(context);
+    if (value->done) bench_values++;
+}
+
+
+/**
+ * @brief Format a todo as jsonplaceholder -- and the simulator -- does.
+ */
+static int bench_format_todo(char* buffer, size_t size, uint32_t id) {
+
+    return snprintf(buffer, size,
+                    "{\n  \"userId\": %u,\n  \"id\": %u,\n  \"title\": \"todo number %u, with \\\"quotes\\\"\",\n  \"completed\": %s\n}",
+                    (id - 1) / 20 + 1, id, id, id % 3 == 0 ? "true" : "false");
+}
+
+
+/**
+ * @brief Build the representative payloads.
+ */
+static void bench_build_payloads(void) {
+
+    struct bench_payload* payload = &bench_payloads[0];
+    payload->length = (uint32_t)bench_format_todo(payload->text, BENCH_PAYLOAD_MAX_LEN_B, 1);
+
+    payload = &bench_payloads[1];
+    payload->length = (uint32_t)snprintf(payload->text, BENCH_PAYLOAD_MAX_LEN_B, "[\n");
+    for (uint32_t id = 1 ; id <= BENCH_TODO_COUNT ; ++id) {
+        payload->length += (uint32_t)bench_format_todo(&payload->text[payload->length],
+                                                       BENCH_PAYLOAD_MAX_LEN_B - payload->length, id);
+        payload->length += (uint32_t)snprintf(&payload->text[payload->length],
+                                              BENCH_PAYLOAD_MAX_LEN_B - payload->length,
+                                              id < BENCH_TODO_COUNT ? ",\n" : "\n]");
+    }
+
+    payload = &bench_payloads[2];
+    payload->length = (uint32_t)snprintf(payload->text, BENCH_PAYLOAD_MAX_LEN_B,
+        "{\n  \"id\": 1,\n  \"name\": \"Leanne Graham\",\n  \"username\": \"Bret\",\n"
+        "  \"email\": \"Sincere@april.biz\",\n  \"address\": {\n    \"street\": \"Kulas Light\",\n"
+        "    \"suite\": \"Apt. 556\",\n    \"city\": \"Gwenborough\",\n    \"zipcode\": \"92998-3874\",\n"
+        "    \"geo\": {\n      \"lat\": \"-37.3159\",\n      \"lng\": \"81.1496\"\n    }\n  },\n"
+        "  \"phone\": \"1-770-736-8031 x56442\",\n  \"website\": \"hildegard.org\",\n"
+        "  \"company\": {\n    \"name\": \"Romaguera-Crona\",\n"
+        "    \"catchPhrase\": \"Multi-layered client-server neural-net\",\n"
+        "    \"bs\": \"harness real-time e-markets\",\n    \"tags\": [1, 2.5, -3e2, true, false, null]\n  }\n}");
+}
+
+
+/**
+ * @brief Parse one payload repeatedly in fixed-size chunks and report throughput.
+ *
+ * @param payload: The payload.
+ * @param chunk:   The chunk size in bytes.
+ */
+static void bench_run(const struct bench_payload* payload, uint32_t chunk) {
+
+    uint64_t bytes = 0;
+    uint64_t cycles = 0;
+    uint64_t runs = 0;
+    uint64_t start_ns = bench_ns();
+    bench_values = 0;
+
+    while (bench_ns() - start_ns < BENCH_MIN_RUN_NS) {
+        struct JsonParser parser;
+        uint64_t start = bench_cycles();
+        json_init(&parser, payload->paths, payload->num_paths, bench_count_value, NULL);
+        enum JsonStatus status = JSON_OK;
+        for (uint32_t offset = 0 ; offset < payload->length ; offset += chunk) {
+            uint32_t length = payload->length - offset < chunk ? payload->length - offset : chunk;
+            status = json_feed(&parser, (const uint8_t*)&payload->text[offset], length);
+        }
+
+        cycles += bench_cycles() - start;
+        if (status != JSON_DONE) {
+            fprintf(stderr, "json: %s did not parse (status %i)\n", payload->name, status);
+            exit(1);
+        }
+
+        bytes += payload->length;
+        runs++;
+    }
+
+    double seconds = (double)(bench_ns() - start_ns) / 1e9;
+    printf("json: %-6s %6u B in %5u B chunks: %6.3f bytes/cycle, %8.1f MB/s, %lu values/parse\n",
+           payload->name, payload->length, chunk, (double)bytes / (double)cycles,
+           (double)bytes / seconds / 1e6, (unsigned long)(bench_values / runs));
+}
+
+
+int main(void) {
+
+    bench_build_payloads();
+    for (uint32_t i = 0 ; i < 3 ; ++i) {
+        bench_run(&bench_payloads[i], 16);
+        bench_run(&bench_payloads[i], HTTP_BODY_CHUNK_SIZE_B);
+        bench_run(&bench_payloads[i], bench_payloads[i].length);
+    }
+
+    return 0;
+}
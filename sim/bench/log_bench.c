@@ -0,0 +1,111 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host benchmark of text versus deferred log formatting
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include "main.h"
+#include "bench.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_ITERATIONS            200000
+
+
+/*
+ * MACROS
+ */
+// Time both formatters on one of the app's messages
+#define     BENCH_MESSAGE(format, ...)  do {                                                    \
+    uint64_t start = bench_cycles();                                                            \
+    for (uint32_t i = 0 ; i < BENCH_ITERATIONS ; ++i) {                                         \
+        bench_text_bytes = bench_text(format, __VA_ARGS__);                                     \
+    }                                                                                           \
+    uint64_t middle = bench_cycles();                                                           \
+    for (uint32_t i = 0 ; i < BENCH_ITERATIONS ; ++i) {                                         \
+        bench_deferred_bytes = bench_deferred(LOG_FORMAT(format), __VA_ARGS__);                 \
+    }                                                                                           \
+    bench_report(format, middle - start, bench_cycles() - middle);                              \
+} while (0)
+
+
+/*
+ * GLOBALS
+ */
+static char bench_buffer[LOG_MESSAGE_MAX_LEN_B];
+static uint32_t bench_text_bytes = 0;
+static uint32_t bench_deferred_bytes = 0;
+
+static struct {
+    uint32_t    messages;
+    uint64_t    text_cycles;
+    uint64_t    text_bytes;
+    uint64_t    deferred_cycles;
+    uint64_t    deferred_bytes;
+} bench_totals;
+
+
+static uint32_t bench_text(const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    uint32_t length = log_format_text(bench_buffer, sizeof(bench_buffer), false, format_string, args, NULL);
+    va_end(args);
+    return length;
+}
+
+
+static uint32_t bench_deferred(const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    uint32_t length = log_format_deferred(bench_buffer, sizeof(bench_buffer), false, format_string, args);
+    va_end(args);
+    return length;
+}
+
+
+/**
+ * @brief Print one message's results and add them to the totals.
+ */
+static void bench_report(const char* format, uint64_t text_cycles, uint64_t deferred_cycles) {
+
+    printf("log: %-44.44s text %5.0f cycles %4u B | deferred %5.0f cycles %3u B\n",
+           format, (double)text_cycles / BENCH_ITERATIONS, bench_text_bytes,
+           (double)deferred_cycles / BENCH_ITERATIONS, bench_deferred_bytes);
+
+    bench_totals.messages++;
+    bench_totals.text_cycles += text_cycles;
+    bench_totals.text_bytes += bench_text_bytes;
+    bench_totals.deferred_cycles += deferred_cycles;
+    bench_totals.deferred_bytes += bench_deferred_bytes;
+}
+
+
+int main(void) {
+
+    // Messages the app logs, with typical values
+    uint32_t store = 44;
+    BENCH_MESSAGE("Debug test variable value: %lu", store);
+    BENCH_MESSAGE("Preparing HTTP request%s", "");
+    BENCH_MESSAGE("HTTP response received. Body length: %lu bytes, %lu headers", (uint32_t)83, (uint32_t)7);
+    BENCH_MESSAGE("Todo %lu: \"%s\" (%s)", (uint32_t)5,
+                  "laboriosam mollitia et enim quasi adipisci quia provident illum", "not completed");
+    BENCH_MESSAGE("HTTP channel %lu closed (status code: %i)", (uint32_t)12288, 0);
+    BENCH_MESSAGE("HTTP latency, %s channel: %lu requests, mean %lu us, min %lu us, max %lu us",
+                  "reused", (uint32_t)118, (uint32_t)400000, (uint32_t)400000, (uint32_t)400000);
+
+    printf("log: mean of %u messages: text %.0f cycles %.1f B, deferred %.0f cycles %.1f B\n",
+           bench_totals.messages,
+           (double)bench_totals.text_cycles / BENCH_ITERATIONS / bench_totals.messages,
+           (double)bench_totals.text_bytes / bench_totals.messages,
+           (double)bench_totals.deferred_cycles / BENCH_ITERATIONS / bench_totals.messages,
+           (double)bench_totals.deferred_bytes / bench_totals.messages);
+    return 0;
+}
@@ -0,0 +1,198 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host benchmark of compile-time and runtime log levels
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include "main.h"
+#include "bench.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_SITE_DEBUGS           8             // Messages in `log_level_sites.c`...
+#define     BENCH_SITE_ERRORS           2
+#define     BENCH_SITE_ARGS             11            // ...and the `bench_arg()` and `bench_string()` calls in the debug messages
+#define     BENCH_SITE_ERROR_ARGS       1             // ...and in the error messages
+#define     BENCH_BATCH                 100           // Passes timed together
+
+
+/*
+ * TYPES
+ */
+struct bench_variant {
+    const char*     name;
+    void            (*sites)(uint32_t value);
+    void            (*errors)(uint32_t value);
+    const uint8_t*  start;
+    const uint8_t*  stop;
+    uint8_t         runtime_level;
+    bool            discard;            // The function drops debug messages, as with LOG_DEBUG_MESSAGES false
+    uint32_t        logged;             // Expected messages formatted per pass...
+    uint32_t        args;               // ...and arguments evaluated
+};
+
+
+/*
+ * PROTOTYPES
+ */
+uint32_t    bench_arg(uint32_t value);
+const char* bench_string(uint32_t value);
+
+// One build of `log_level_sites.c` each, in a section of its own
+void        bench_sites_built(uint32_t value);
+void        bench_sites_out(uint32_t value);
+void        bench_sites_before(uint32_t value);
+void        bench_errors_built(uint32_t value);
+void        bench_errors_out(uint32_t value);
+void        bench_errors_before(uint32_t value);
+extern const uint8_t __start_bench_built[], __stop_bench_built[];
+extern const uint8_t __start_bench_out[], __stop_bench_out[];
+extern const uint8_t __start_bench_before[], __stop_bench_before[];
+
+
+/*
+ * GLOBALS
+ */
+volatile uint8_t log_levels[LOG_MODULE_COUNT] = {
+    LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG
+};
+
+static char bench_buffer[LOG_MESSAGE_MAX_LEN_B];
+static const char* bench_strings[4] = { "application/json; charset=utf-8", "delectus aut autem", "connected", "disconnected" };
+static bool bench_discard = false;
+static uint32_t bench_logged = 0;
+static uint32_t bench_args = 0;
+
+
+/*
+ * STUBS
+ *
+ * The logging functions format the message, as `post_log()` does, but
+ * go no further.
+ */
+void (server_log)(const char* format_string, ...) {
+
+    if (bench_discard) return;
+    va_list args;
+    va_start(args, format_string);
+    log_format_text(bench_buffer, sizeof(bench_buffer), false, format_string, args, NULL);
+    va_end(args);
+    bench_logged++;
+}
+
+
+void (server_error)(const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    log_format_text(bench_buffer, sizeof(bench_buffer), true, format_string, args, NULL);
+    va_end(args);
+    bench_logged++;
+}
+
+
+/**
+ * @brief A message argument: a value that takes a little work to find,
+ *        as a queue count or a header lookup does.
+ */
+__attribute__((noinline))
+uint32_t bench_arg(uint32_t value) {
+
+    for (uint32_t i = 0 ; i < 8 ; ++i) value = value * 2654435761u + i;
+    bench_args++;
+    return value;
+}
+
+
+__attribute__((noinline))
+const char* bench_string(uint32_t value) {
+
+    bench_args++;
+    return bench_strings[value & 3];
+}
+
+
+/**
+ * @brief Time passes over a variant's debug messages.
+ *
+ * The error messages are left out, as every variant logs them and their
+ * formatting would swamp the difference between a debug message that's
+ * off at runtime and one that's compiled out. So would the noise of a
+ * mean, so the fastest batch of passes is taken.
+ *
+ * @returns Cycles per pass.
+ */
+static double bench_time(const struct bench_variant* variant) {
+
+    uint64_t best = UINT64_MAX;
+    uint32_t runs = 0;
+    uint64_t start_ns = bench_ns();
+    while (bench_ns() - start_ns < BENCH_MIN_RUN_NS) {
+        uint64_t start = bench_cycles();
+        for (uint32_t i = 0 ; i < BENCH_BATCH ; ++i) variant->sites(runs + i);
+        uint64_t cycles = bench_cycles() - start;
+        if (cycles < best) best = cycles;
+        runs += BENCH_BATCH;
+    }
+
+    return (double)best / BENCH_BATCH;
+}
+
+
+int main(void) {
+
+    struct bench_variant variants[4] = {
+        { "Debug built, logged", bench_sites_built, bench_errors_built, __start_bench_built, __stop_bench_built, LOG_LEVEL_DEBUG, false,
+          BENCH_SITE_DEBUGS + BENCH_SITE_ERRORS, BENCH_SITE_ARGS + BENCH_SITE_ERROR_ARGS },
+        { "Debug built, off at runtime", bench_sites_built, bench_errors_built, __start_bench_built, __stop_bench_built, LOG_LEVEL_ERROR, false,
+          BENCH_SITE_ERRORS, BENCH_SITE_ERROR_ARGS },
+        { "Debug compiled out", bench_sites_out, bench_errors_out, __start_bench_out, __stop_bench_out, LOG_LEVEL_DEBUG, false,
+          BENCH_SITE_ERRORS, BENCH_SITE_ERROR_ARGS },
+        { "Before: always called", bench_sites_before, bench_errors_before, __start_bench_before, __stop_bench_before, LOG_LEVEL_DEBUG, true,
+          BENCH_SITE_ERRORS, BENCH_SITE_ARGS + BENCH_SITE_ERROR_ARGS }
+    };
+
+    uint32_t failures = 0;
+    printf("%u debug and %u error messages a pass, the debug messages timed\n\n", BENCH_SITE_DEBUGS, BENCH_SITE_ERRORS);
+    printf("%-28s %8s %10s %14s\n", "Variant", "Code B", "Arguments", "Debug cycles");
+
+    for (uint32_t i = 0 ; i < 4 ; ++i) {
+        struct bench_variant* variant = &variants[i];
+        log_levels[LOG_MODULE_MAIN] = variant->runtime_level;
+        bench_discard = variant->discard;
+
+        // One pass must format and evaluate only what its levels allow
+        bench_logged = 0;
+        bench_args = 0;
+        variant->sites(0);
+        variant->errors(0);
+        if (bench_logged != variant->logged || bench_args != variant->args) {
+            fprintf(stderr, "log level: %s formatted %u messages and evaluated %u arguments, not %u and %u\n",
+                    variant->name, bench_logged, bench_args, variant->logged, variant->args);
+            failures++;
+        }
+
+        printf("%-28s %8u %10u %14.1f\n", variant->name, (uint32_t)(variant->stop - variant->start),
+               variant->args, bench_time(variant));
+    }
+
+    // Compiling the debug messages out must shrink the code
+    if (__stop_bench_out - __start_bench_out >= __stop_bench_built - __start_bench_built) {
+        fprintf(stderr, "log level: compiling out debug messages saved no code\n");
+        failures++;
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "\n%u check(s) failed\n", failures);
+        return 1;
+    }
+
+    printf("\nAll checks passed\n");
+    return 0;
+}
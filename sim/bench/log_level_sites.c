@@ -0,0 +1,60 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Log calls for the log level benchmark, built once for each variant
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+// The variant's build sets the module's level, and names its function and section
+#undef      LOG_LEVEL_MAIN
+#define     LOG_LEVEL_MAIN              BENCH_LEVEL
+#include "main.h"
+
+#if BENCH_UNFILTERED == true
+// Call the function whatever the level, with every argument evaluated,
+// as `server_log()` was before compile-time levels
+#undef      server_log
+#define     server_log                  (server_log)
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+uint32_t    bench_arg(uint32_t value);
+const char* bench_string(uint32_t value);
+void        BENCH_SITES(uint32_t value);
+void        BENCH_ERRORS(uint32_t value);
+
+
+/**
+ * @brief The app's own debug messages, whose arguments, like theirs,
+ *        take some work to find.
+ */
+__attribute__((section(BENCH_SECTION), noinline))
+void BENCH_SITES(uint32_t value) {
+
+    server_log("Network connected in %lu us", bench_arg(value));
+    server_log("HTTP response received. Body length: %lu bytes, type: %s", bench_arg(value + 1), bench_string(value));
+    server_log("Todo %lu: \"%s\" (%s)", value, bench_string(value + 1), value & 1 ? "completed" : "not completed");
+    server_log("Debug test variable value: %lu", value);
+    server_log("Posting %lu telemetry samples, %lu bytes", bench_arg(value + 2), bench_arg(value + 3));
+    server_log("Network: %s, connected in %lu us, %lu disconnects, %lu attempts, %lu reconnects, %lu s offline",
+               bench_string(value + 2), bench_arg(value + 4), value, value + 1, value + 2, bench_arg(value + 5));
+    server_log("Request sent to the Microvisor Cloud");
+    server_log("HTTP queue: %lu queued, %lu sent, %lu failed, high-water mark %lu of %lu",
+               bench_arg(value + 6), value, value + 1, bench_arg(value + 7), value + 2);
+}
+
+
+/**
+ * @brief The app's own error messages, which every variant logs.
+ */
+__attribute__((section(BENCH_SECTION), noinline))
+void BENCH_ERRORS(uint32_t value) {
+
+    server_error("HTTP status code: %lu", bench_arg(value + 8));
+    server_error("Channel closed for reason: %lu", value);
+}
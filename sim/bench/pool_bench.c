@@ -0,0 +1,348 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host check and benchmark of the pool allocator and its newlib hooks
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <reent.h>
+#include "main.h"
+#include "bench.h"
+
+
+/*
+ * NOTE This bench and `demo/pool.c` are built with POOL_HOOK_MALLOC set
+ *      and `malloc()`, `free()`, `realloc()` and `calloc()` renamed, so the
+ *      hooks are compiled and called here as on the device, while the
+ *      host C library keeps its own allocator for everything else.
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_HELD                  32          // Allocations held at once while timing: 16 of 16 B and 16 of 32 B
+
+
+/*
+ * MACROS
+ */
+#define     BENCH_CHECK(condition, ...) do {                                                    \
+    if (!(condition)) {                                                                         \
+        fprintf(stderr, "pool: " __VA_ARGS__);                                                  \
+        fprintf(stderr, "\n");                                                                  \
+        bench_failures++;                                                                       \
+    }                                                                                           \
+} while (0)
+
+
+/*
+ * GLOBALS
+ */
+static uint32_t bench_failures = 0;
+static struct _reent bench_reent = { 0 };
+struct _reent* _impure_ptr = &bench_reent;
+
+
+/*
+ * STUBS
+ *
+ * The pool runs on the host's single thread, so masking interrupts
+ * only has to be remembered.
+ */
+static uint32_t bench_primask = 0;
+
+void __disable_irq(void) {
+
+    bench_primask = 1;
+}
+
+
+void __enable_irq(void) {
+
+    bench_primask = 0;
+}
+
+
+uint32_t __get_PRIMASK(void) {
+
+    return bench_primask;
+}
+
+
+void __set_PRIMASK(uint32_t mask) {
+
+    bench_primask = mask;
+}
+
+
+volatile uint8_t log_levels[LOG_MODULE_COUNT] = {
+    LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG
+};
+
+
+void (server_log)(const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    vprintf(format_string, args);
+    va_end(args);
+    printf("\n");
+}
+
+
+void (server_error)(const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    vfprintf(stderr, format_string, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+}
+
+
+/**
+ * @brief Get the size class an allocation of `size` bytes took, from
+ *        the change in each class' blocks in use, and free it.
+ *
+ * @returns The class' block size, or 0 if the allocation failed.
+ */
+static uint32_t bench_class_taken(size_t size) {
+
+    struct PoolStats before;
+    struct PoolStats after;
+    pool_get_stats(&before);
+    void* block = pool_alloc(size);
+    pool_get_stats(&after);
+    if (block == NULL) return 0;
+
+    uint32_t taken = 0;
+    for (uint32_t i = 0 ; i < POOL_CLASS_COUNT ; ++i) {
+        if (after.classes[i].in_use > before.classes[i].in_use) taken = after.classes[i].block_size_b;
+    }
+
+    pool_free(block);
+    return taken;
+}
+
+
+/**
+ * @brief Every block is back in the pool, and the byte counts with them.
+ */
+static void bench_check_empty(const char* after) {
+
+    struct PoolStats stats;
+    pool_get_stats(&stats);
+    BENCH_CHECK(stats.requested_b == 0 && stats.in_use_b == 0, "%u B requested and %u B in use after %s, not 0",
+                stats.requested_b, stats.in_use_b, after);
+    for (uint32_t i = 0 ; i < POOL_CLASS_COUNT ; ++i) {
+        BENCH_CHECK(stats.classes[i].in_use == 0, "%u %u B blocks in use after %s",
+                    stats.classes[i].in_use, stats.classes[i].block_size_b, after);
+    }
+}
+
+
+/**
+ * @brief A request takes the smallest class that holds it, and one too
+ *        big for any class fails.
+ */
+static void bench_check_classes(void) {
+
+    static const uint32_t sizes[] = { 1, 16, 17, 32, 33, 64, 65, 128, 129, 256 };
+    static const uint32_t classes[] = { 16, 16, 32, 32, 64, 64, 128, 128, 256, 256 };
+    for (uint32_t i = 0 ; i < sizeof(sizes) / sizeof(sizes[0]) ; ++i) {
+        uint32_t taken = bench_class_taken(sizes[i]);
+        BENCH_CHECK(taken == classes[i], "%u B took a %u B block, not %u B", sizes[i], taken, classes[i]);
+    }
+
+    struct PoolStats before;
+    struct PoolStats after;
+    pool_get_stats(&before);
+    BENCH_CHECK(pool_alloc(POOL_MAX_BLOCK_SIZE_B + 1) == NULL, "%u B was allocated", POOL_MAX_BLOCK_SIZE_B + 1);
+    pool_get_stats(&after);
+    BENCH_CHECK(after.failed == before.failed + 1, "%u B was not counted as failed", POOL_MAX_BLOCK_SIZE_B + 1);
+    bench_check_empty("class selection");
+}
+
+
+/**
+ * @brief A full class passes requests to the next, and once every class
+ *        is full, requests fail. The byte counts follow each allocation.
+ */
+static void bench_check_exhaustion(void) {
+
+    void* blocks[POOL_BLOCK_TOTAL + 1];
+    struct PoolStats before;
+    pool_get_stats(&before);
+
+    // Sizes cycle through 1 to 16 bytes, so every request after the 16 B
+    // class is full spills, and requested and block bytes differ
+    uint32_t count = 0;
+    uint32_t requested_b = 0;
+    while (count <= POOL_BLOCK_TOTAL && (blocks[count] = pool_alloc(count % 16 + 1)) != NULL) {
+        requested_b += count % 16 + 1;
+        count++;
+    }
+
+    struct PoolStats full;
+    pool_get_stats(&full);
+    BENCH_CHECK(count == POOL_BLOCK_TOTAL, "%u blocks allocated before failing, not %u", count, POOL_BLOCK_TOTAL);
+    BENCH_CHECK(full.failed == before.failed + 1, "exhaustion counted %u failures, not 1", full.failed - before.failed);
+    BENCH_CHECK(full.classes[0].spilled - before.classes[0].spilled == count + 1 - POOL_BLOCKS_16B,
+                "16 B class spilled %u times, not %u", full.classes[0].spilled - before.classes[0].spilled,
+                count + 1 - POOL_BLOCKS_16B);
+    BENCH_CHECK(full.requested_b == requested_b, "%u B requested, not %u", full.requested_b, requested_b);
+    BENCH_CHECK(full.in_use_b == POOL_ARENA_SIZE_B, "%u B in use, not %u", full.in_use_b, POOL_ARENA_SIZE_B);
+    BENCH_CHECK(full.high_water_b == POOL_ARENA_SIZE_B, "high-water mark %u B, not %u", full.high_water_b, POOL_ARENA_SIZE_B);
+    BENCH_CHECK(full.largest_free_b == 0, "largest free block %u B when full", full.largest_free_b);
+
+    // Freeing one 16 B block makes it the only one free, and a 16 B request takes it
+    pool_free(blocks[3]);
+    blocks[3] = pool_alloc(16);
+    BENCH_CHECK(blocks[3] != NULL, "freed 16 B block not reused");
+
+    for (uint32_t i = 0 ; i < count ; ++i) pool_free(blocks[i]);
+    bench_check_empty("exhaustion");
+}
+
+
+/**
+ * @brief Resizing within a block keeps it, resizing beyond it moves the
+ *        contents, and a resize that can't be met leaves the block intact.
+ */
+static void bench_check_realloc(void) {
+
+    uint8_t* block = pool_alloc(10);
+    for (uint32_t i = 0 ; i < 10 ; ++i) block[i] = (uint8_t)(i * 7 + 1);
+
+    struct PoolStats stats;
+    uint8_t* same = pool_realloc(block, 16);
+    pool_get_stats(&stats);
+    BENCH_CHECK(same == block, "growing within a block moved it");
+    BENCH_CHECK(stats.requested_b == 16 && stats.in_use_b == 16, "%u B requested and %u B in use after growing in place, not 16 and 16",
+                stats.requested_b, stats.in_use_b);
+
+    uint8_t* grown = pool_realloc(block, 100);
+    pool_get_stats(&stats);
+    BENCH_CHECK(grown != NULL && grown != block, "growing past a block didn't move it");
+    BENCH_CHECK(stats.requested_b == 100 && stats.in_use_b == 128, "%u B requested and %u B in use after growing, not 100 and 128",
+                stats.requested_b, stats.in_use_b);
+
+    bool match = grown != NULL;
+    for (uint32_t i = 0 ; match && i < 10 ; ++i) match = grown[i] == (uint8_t)(i * 7 + 1);
+    BENCH_CHECK(match, "contents lost when growing");
+
+    uint8_t* shrunk = pool_realloc(grown, 20);
+    pool_get_stats(&stats);
+    BENCH_CHECK(shrunk == grown, "shrinking moved the block");
+    BENCH_CHECK(stats.requested_b == 20 && stats.in_use_b == 128, "%u B requested and %u B in use after shrinking, not 20 and 128",
+                stats.requested_b, stats.in_use_b);
+
+    // With the 256 B blocks taken, growing to 200 B fails and keeps the block
+    void* large[POOL_BLOCKS_256B];
+    for (uint32_t i = 0 ; i < POOL_BLOCKS_256B ; ++i) large[i] = pool_alloc(256);
+    BENCH_CHECK(pool_realloc(shrunk, 200) == NULL, "growing to 200 B succeeded with no 256 B block free");
+    match = true;
+    for (uint32_t i = 0 ; i < 10 ; ++i) match = match && shrunk[i] == (uint8_t)(i * 7 + 1);
+    BENCH_CHECK(match, "contents lost when growing failed");
+
+    for (uint32_t i = 0 ; i < POOL_BLOCKS_256B ; ++i) pool_free(large[i]);
+    pool_free(shrunk);
+    void* fresh = pool_realloc(NULL, 0);
+    BENCH_CHECK(fresh != NULL, "resizing NULL didn't allocate");
+    pool_free(fresh);
+    bench_check_empty("resizing");
+}
+
+
+/**
+ * @brief The newlib hooks route `malloc()` and friends through the pool.
+ */
+static void bench_check_hooks(void) {
+
+    struct PoolStats before;
+    struct PoolStats stats;
+    pool_get_stats(&before);
+
+    uint8_t* block = malloc(24);
+    pool_get_stats(&stats);
+    BENCH_CHECK(block != NULL && stats.classes[1].allocs == before.classes[1].allocs + 1, "malloc(24) didn't take a 32 B block");
+
+    block = realloc(block, 48);
+    pool_get_stats(&stats);
+    BENCH_CHECK(block != NULL && stats.classes[2].in_use == 1, "realloc() to 48 B didn't take a 64 B block");
+    free(block);
+
+    // calloc() hands out zeroed memory, even from a block that held data
+    uint8_t* dirty = malloc(64);
+    memset(dirty, 0xA5, 64);
+    free(dirty);
+    uint8_t* zeroed = calloc(8, 8);
+    bool clear = zeroed != NULL;
+    for (uint32_t i = 0 ; clear && i < 64 ; ++i) clear = zeroed[i] == 0;
+    BENCH_CHECK(clear, "calloc() memory not zeroed");
+    free(zeroed);
+
+    // The count is volatile so the compiler can't see, and warn about, the overflow
+    volatile size_t huge = SIZE_MAX / 2;
+    bench_reent._errno = 0;
+    BENCH_CHECK(calloc(huge, 4) == NULL && bench_reent._errno == ENOMEM, "overflowing calloc() not refused with ENOMEM");
+    bench_reent._errno = 0;
+    BENCH_CHECK(malloc(POOL_MAX_BLOCK_SIZE_B + 1) == NULL && bench_reent._errno == ENOMEM, "oversized malloc() not refused with ENOMEM");
+
+    // Pointers the pool didn't allocate are ignored
+    uint8_t local[16];
+    free(NULL);
+    free(local);
+    bench_check_empty("the newlib hooks");
+}
+
+
+/**
+ * @brief Time allocation and release, with the two smallest classes
+ *        filled and emptied again.
+ */
+static void bench_time(void) {
+
+    void* held[BENCH_HELD];
+    uint64_t alloc_cycles = 0;
+    uint64_t free_cycles = 0;
+    uint64_t calls = 0;
+    uint64_t start_ns = bench_ns();
+    while (bench_ns() - start_ns < BENCH_MIN_RUN_NS) {
+        uint64_t start = bench_cycles();
+        for (uint32_t i = 0 ; i < BENCH_HELD ; ++i) held[i] = pool_alloc(i & 1 ? 32 : 16);
+        uint64_t middle = bench_cycles();
+        for (uint32_t i = 0 ; i < BENCH_HELD ; ++i) pool_free(held[i]);
+        alloc_cycles += middle - start;
+        free_cycles += bench_cycles() - middle;
+        calls += BENCH_HELD;
+    }
+
+    printf("%-28s %10.1f cycles\n", "Allocate, per call", (double)alloc_cycles / calls);
+    printf("%-28s %10.1f cycles\n", "Free, per call", (double)free_cycles / calls);
+}
+
+
+int main(void) {
+
+    printf("Pool: %u blocks in %u classes, %u B arena\n\n", POOL_BLOCK_TOTAL, POOL_CLASS_COUNT, POOL_ARENA_SIZE_B);
+
+    bench_check_classes();
+    bench_check_exhaustion();
+    bench_check_realloc();
+    bench_check_hooks();
+    bench_time();
+    bench_check_empty("timing");
+
+    if (bench_failures > 0) {
+        fprintf(stderr, "\n%u check(s) failed\n", bench_failures);
+        return 1;
+    }
+
+    printf("\nAll checks passed\n");
+    return 0;
+}
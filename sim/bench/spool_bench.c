@@ -0,0 +1,287 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host check and benchmark of the flash request spool
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include "main.h"
+#include "mv_sim.h"
+#include "bench.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_RECORD_LEN_B          64          // About the size of a spooled todo request
+#define     BENCH_WEAR_CYCLES           20000
+
+
+/*
+ * MACROS
+ */
+#define     BENCH_CHECK(condition, ...) do {                                                    \
+    if (!(condition)) {                                                                         \
+        fprintf(stderr, "spool: " __VA_ARGS__);                                                 \
+        fprintf(stderr, "\n");                                                                  \
+        bench_failures++;                                                                       \
+    }                                                                                           \
+} while (0)
+
+
+/*
+ * GLOBALS
+ */
+static uint32_t bench_failures = 0;
+static uint64_t bench_flash_us = 0;
+static uint32_t bench_next_pushed = 0;
+static uint32_t bench_next_read = 0;
+
+
+/*
+ * STUBS
+ *
+ * The spool links against the flash simulator alone. It stalls the
+ * virtual clock for each flash operation, which here is only totalled.
+ */
+void sim_advance(uint64_t delta_us) {
+
+    bench_flash_us += delta_us;
+}
+
+
+volatile uint8_t log_levels[LOG_MODULE_COUNT] = {
+    LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG
+};
+
+
+void (server_log)(const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    vprintf(format_string, args);
+    va_end(args);
+    printf("\n");
+}
+
+
+void (server_error)(const char* format_string, ...) {
+
+    va_list args;
+    va_start(args, format_string);
+    vfprintf(stderr, format_string, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+}
+
+
+/**
+ * @brief Erase the spool's pages, as on a factory-fresh part.
+ */
+static void bench_erase_spool(void) {
+
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_PAGES,
+        .Banks     = SPOOL_FLASH_BANK,
+        .Page      = SPOOL_FLASH_FIRST_PAGE,
+        .NbPages   = SPOOL_FLASH_PAGES
+    };
+
+    uint32_t page_error = 0;
+    HAL_FLASH_Unlock();
+    HAL_FLASHEx_Erase(&erase, &page_error);
+    HAL_FLASH_Lock();
+    spool_init();
+    bench_next_pushed = 0;
+    bench_next_read = 0;
+}
+
+
+/**
+ * @brief Store the next numbered record: its bytes derive from its number.
+ */
+static bool bench_push(void) {
+
+    uint8_t record[BENCH_RECORD_LEN_B];
+    for (uint32_t i = 0 ; i < BENCH_RECORD_LEN_B ; ++i) record[i] = (uint8_t)(bench_next_pushed * 31 + i);
+    if (!spool_push(record, BENCH_RECORD_LEN_B)) return false;
+
+    bench_next_pushed++;
+    return true;
+}
+
+
+/**
+ * @brief Read a record and check it's the next one expected.
+ */
+static bool bench_read(void) {
+
+    uint8_t record[SPOOL_RECORD_MAX_LEN_B];
+    uint32_t length = spool_read(record, sizeof(record));
+    if (length == 0) return false;
+
+    bool match = length == BENCH_RECORD_LEN_B;
+    for (uint32_t i = 0 ; match && i < BENCH_RECORD_LEN_B ; ++i) match = record[i] == (uint8_t)(bench_next_read * 31 + i);
+    BENCH_CHECK(match, "record %u read back wrong", bench_next_read);
+    bench_next_read++;
+    return true;
+}
+
+
+/**
+ * @brief Records come back in order, once committed are gone, and once
+ *        read but not committed come back after a reset.
+ */
+static void bench_check_order(void) {
+
+    bench_erase_spool();
+    for (uint32_t i = 0 ; i < 10 ; ++i) BENCH_CHECK(bench_push(), "push %u failed", i);
+    BENCH_CHECK(spool_pending() == 10, "%u pending, not 10", spool_pending());
+
+    for (uint32_t i = 0 ; i < 4 ; ++i) bench_read();
+    BENCH_CHECK(spool_commit(), "commit failed");
+    for (uint32_t i = 0 ; i < 3 ; ++i) bench_read();
+
+    // Reset: the three uncommitted reads come back
+    spool_init();
+    BENCH_CHECK(spool_pending() == 6, "%u pending after reset, not 6", spool_pending());
+    bench_next_read = 4;
+    while (bench_read()) {}
+    BENCH_CHECK(bench_next_read == 10, "read to %u after reset, not 10", bench_next_read);
+    BENCH_CHECK(spool_commit(), "commit failed");
+
+    spool_init();
+    BENCH_CHECK(spool_pending() == 0, "%u pending after final commit", spool_pending());
+}
+
+
+/**
+ * @brief A record torn by a reset is dropped. Those before it survive,
+ *        and new records go to a fresh page.
+ */
+static void bench_check_torn_write(void) {
+
+    bench_erase_spool();
+    for (uint32_t i = 0 ; i < 5 ; ++i) bench_push();
+
+    // Clear bits in the last record's payload, as a partial write would
+    uint32_t record_size = (SPOOL_HEADER_SIZE_B + BENCH_RECORD_LEN_B + SPOOL_QUADWORD_B - 1) & ~(SPOOL_QUADWORD_B - 1);
+    sim_flash_poke(SPOOL_FLASH_ADDR + SPOOL_HEADER_SIZE_B + 4 * record_size + SPOOL_HEADER_SIZE_B + 8, 0x00);
+
+    spool_init();
+    struct SpoolStats stats;
+    spool_get_stats(&stats);
+    BENCH_CHECK(stats.corrupt == 1, "%u corrupt records, not 1", stats.corrupt);
+    BENCH_CHECK(spool_pending() == 4, "%u pending after a torn write, not 4", spool_pending());
+
+    bench_next_pushed = 5;
+    BENCH_CHECK(bench_push(), "push after a torn write failed");
+    for (uint32_t i = 0 ; i < 4 ; ++i) bench_read();
+    bench_next_read = 5;
+    BENCH_CHECK(bench_read(), "record after a torn write not read");
+}
+
+
+/**
+ * @brief A full spool refuses records, but can always commit what's been
+ *        read, and takes records again once a page is free.
+ */
+static void bench_check_full(void) {
+
+    bench_erase_spool();
+    uint32_t stored = 0;
+    while (bench_push()) stored++;
+
+    uint32_t per_page = stored / SPOOL_FLASH_PAGES;
+    BENCH_CHECK(stored > 0 && spool_pending() == stored, "%u pending when full, not %u", spool_pending(), stored);
+
+    // Part of the oldest page: committed, but no page freed
+    for (uint32_t i = 0 ; i < per_page / 2 ; ++i) bench_read();
+    BENCH_CHECK(spool_commit(), "commit when full failed");
+    BENCH_CHECK(!bench_push(), "push succeeded with no page free");
+
+    // The rest of it: the page can be reused
+    for (uint32_t i = per_page / 2 ; i < per_page ; ++i) bench_read();
+    BENCH_CHECK(spool_commit(), "commit of the oldest page failed");
+    BENCH_CHECK(bench_push(), "push failed with a page free");
+
+    spool_init();
+    BENCH_CHECK(spool_pending() == stored - per_page + 1, "%u pending after reset, not %u", spool_pending(), stored - per_page + 1);
+    while (bench_read()) {}
+    BENCH_CHECK(bench_next_read == bench_next_pushed, "read to %u, not %u", bench_next_read, bench_next_pushed);
+}
+
+
+/**
+ * @brief Steady store-and-forward traffic wears every page evenly.
+ *
+ * Also times the spool: host cycles, simulated flash time and flash
+ * bytes per record, in batches of four as the HTTP engine replays them.
+ */
+static void bench_check_wear(void) {
+
+    bench_erase_spool();
+    uint64_t flash_us = bench_flash_us;
+    uint32_t start_erases[SPOOL_FLASH_PAGES];
+    for (uint32_t page = 0 ; page < SPOOL_FLASH_PAGES ; ++page) {
+        start_erases[page] = sim_flash_page_erases(SPOOL_FLASH_ADDR + page * FLASH_PAGE_SIZE);
+    }
+
+    uint64_t push_cycles = 0;
+    uint64_t read_cycles = 0;
+    for (uint32_t i = 0 ; i < BENCH_WEAR_CYCLES ; ++i) {
+        uint64_t start = bench_cycles();
+        for (uint32_t j = 0 ; j < 4 ; ++j) BENCH_CHECK(bench_push(), "push %u failed", bench_next_pushed);
+        uint64_t middle = bench_cycles();
+        for (uint32_t j = 0 ; j < 4 ; ++j) bench_read();
+        BENCH_CHECK(spool_commit(), "commit failed");
+        push_cycles += middle - start;
+        read_cycles += bench_cycles() - middle;
+    }
+
+    uint32_t min_erases = UINT32_MAX;
+    uint32_t max_erases = 0;
+    uint32_t total_erases = 0;
+    for (uint32_t page = 0 ; page < SPOOL_FLASH_PAGES ; ++page) {
+        uint32_t erases = sim_flash_page_erases(SPOOL_FLASH_ADDR + page * FLASH_PAGE_SIZE) - start_erases[page];
+        if (erases < min_erases) min_erases = erases;
+        if (erases > max_erases) max_erases = erases;
+        total_erases += erases;
+    }
+
+    BENCH_CHECK(max_erases - min_erases <= 1, "page erases range from %u to %u", min_erases, max_erases);
+
+    struct SpoolStats stats;
+    spool_get_stats(&stats);
+    BENCH_CHECK(stats.max_page_erases - stats.min_page_erases <= 1, "recorded page erases range from %u to %u", stats.min_page_erases, stats.max_page_erases);
+
+    uint32_t records = BENCH_WEAR_CYCLES * 4;
+    printf("%-28s %10.1f cycles\n", "Push, per record", (double)push_cycles / records);
+    printf("%-28s %10.1f cycles\n", "Read and commit, per record", (double)read_cycles / records);
+    printf("%-28s %10.1f us\n", "Flash time, per record", (double)(bench_flash_us - flash_us) / records);
+    printf("%-28s %10.1f bytes\n", "Flash written, per record", (double)total_erases * FLASH_PAGE_SIZE / records);
+    printf("%-28s %10u to %u\n", "Erases per page", min_erases, max_erases);
+    printf("%-28s %10.0f\n", "Records per page erase", (double)records / total_erases);
+}
+
+
+int main(void) {
+
+    printf("Flash spool: %u pages of %u bytes, %u-byte records\n\n", SPOOL_FLASH_PAGES, FLASH_PAGE_SIZE, BENCH_RECORD_LEN_B);
+
+    bench_check_order();
+    bench_check_torn_write();
+    bench_check_full();
+    bench_check_wear();
+
+    if (bench_failures > 0) {
+        fprintf(stderr, "\n%u check(s) failed\n", bench_failures);
+        return 1;
+    }
+
+    printf("\nAll checks passed\n");
+    return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host benchmark of UART log timestamp formatting
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include "main.h"
+#include "bench.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     BENCH_ITERATIONS            1000000
+#define     BENCH_START_US              1652189458000000ULL     // 2022-05-10 13:30:58
+
+
+/*
+ * GLOBALS
+ */
+static char bench_buffer[UART_LOG_TIMESTAMP_MAX_LEN_B];
+static volatile uint32_t bench_sink = 0;
+
+
+/**
+ * @brief Format a timestamp as `log_uart_output()` did before the cache.
+ */
+static void bench_strftime(char* buffer, uint64_t usec) {
+
+    time_t sec = (time_t)(usec / 1000000);
+    strftime(buffer, UART_LOG_TIMESTAMP_MAX_LEN_B, "%F %T.XXX ", gmtime(&sec));
+    sprintf(&buffer[20], "%03u ", (unsigned)(usec / 1000 % 1000));
+}
+
+
+/**
+ * @brief Check the cached formatter against strftime across a spread of
+ *        times, including day, month, year and leap-day boundaries.
+ *
+ * @returns The number of mismatches.
+ */
+static uint32_t bench_verify(void) {
+
+    char expected[UART_LOG_TIMESTAMP_MAX_LEN_B];
+    uint32_t failures = 0;
+    uint64_t usec = 0;
+    for (uint32_t i = 0 ; i < 400000 ; ++i) {
+        // Steps of a little under 2 hours, to 2061, then 1 s steps past midnight
+        usec = i < 200000 ? (uint64_t)i * 6999999123ULL : BENCH_START_US + (uint64_t)(i - 200000) * 999999ULL;
+        bench_strftime(expected, usec);
+        timestamp_format_wall(bench_buffer, usec);
+        if (strcmp(expected, bench_buffer) != 0) {
+            if (failures++ < 5) fprintf(stderr, "timestamp: \"%s\" != \"%s\"\n", bench_buffer, expected);
+        }
+    }
+
+    return failures;
+}
+
+
+/**
+ * @brief Time both wall-clock formatters over one spacing of log lines.
+ *
+ * @param name: The spacing's name.
+ * @param step: Microseconds between log lines.
+ */
+static void bench_run(const char* name, uint64_t step) {
+
+    uint64_t usec = BENCH_START_US;
+    uint64_t start = bench_cycles();
+    for (uint32_t i = 0 ; i < BENCH_ITERATIONS ; ++i) {
+        bench_strftime(bench_buffer, usec);
+        bench_sink += (uint8_t)bench_buffer[22];
+        usec += step;
+    }
+
+    uint64_t middle = bench_cycles();
+    usec = BENCH_START_US;
+    for (uint32_t i = 0 ; i < BENCH_ITERATIONS ; ++i) {
+        bench_sink += timestamp_format_wall(bench_buffer, usec);
+        usec += step;
+    }
+
+    uint64_t end = bench_cycles();
+    printf("timestamp: %-22s strftime %5.0f cycles | cached %4.0f cycles\n", name,
+           (double)(middle - start) / BENCH_ITERATIONS, (double)(end - middle) / BENCH_ITERATIONS);
+}
+
+
+int main(void) {
+
+    // gmtime() must report UTC, as the device's does
+    setenv("TZ", "UTC", 1);
+    tzset();
+
+    uint32_t failures = bench_verify();
+    if (failures > 0) {
+        fprintf(stderr, "timestamp: %u mismatches with strftime\n", failures);
+        return 1;
+    }
+
+    bench_run("lines 5 ms apart", 5000);
+    bench_run("lines 1 s apart", 1000000);
+    bench_run("lines 1 h 1 s apart", 3601000123ULL);
+
+    uint64_t usec = 0;
+    uint64_t start = bench_cycles();
+    for (uint32_t i = 0 ; i < BENCH_ITERATIONS ; ++i) {
+        bench_sink += timestamp_format_monotonic(bench_buffer, usec);
+        usec += 5123;
+    }
+
+    printf("timestamp: %-22s monotonic %4.0f cycles\n", "lines 5 ms apart",
+           (double)(bench_cycles() - start) / BENCH_ITERATIONS);
+    return 0;
+}
@@ -0,0 +1,214 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host simulation of the STM32U5 internal flash
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "mv_sim.h"
+
+
+/*
+ * NOTE The flash is host memory mapped at the device's own address,
+ *      FLASH_BASE, so the demo reads it through plain pointers exactly
+ *      as it does on the device. The mapping is read-only outside the
+ *      HAL calls below, so a stray write faults rather than succeeds.
+ *
+ *      As on the STM32U5, flash is written a quad-word at a time, only
+ *      to erased quad-words, and erased a page at a time to 0xFF. Each
+ *      operation stalls the virtual clock for its typical duration.
+ *
+ *      Set `MV_SIM_FLASH_FILE` to keep the flash in a file, so that its
+ *      contents survive from one run to the next, as over a reset.
+ */
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     sim_flash_init(void) __attribute__((constructor));
+static uint8_t* sim_flash_at(uint32_t address, uint32_t length);
+static void     sim_flash_writable(uint8_t* target, uint32_t length, bool writable);
+
+
+/*
+ * GLOBALS
+ */
+struct sim_flash_stats sim_flash_stats;
+
+static uint8_t* sim_flash = NULL;
+static bool     sim_flash_locked = true;
+static uint32_t sim_flash_erase_counts[SIM_FLASH_SIZE_B / FLASH_PAGE_SIZE];
+
+
+/**
+ * @brief Map the flash at FLASH_BASE, erased or from `MV_SIM_FLASH_FILE`.
+ *
+ * Runs before `main()`.
+ */
+static void sim_flash_init(void) {
+
+    int fd = -1;
+    int flags = MAP_FIXED_NOREPLACE;
+    const char* path = getenv("MV_SIM_FLASH_FILE");
+    if (path != NULL && path[0] != 0) {
+        fd = open(path, O_RDWR | O_CREAT, 0644);
+        off_t size = fd >= 0 ? lseek(fd, 0, SEEK_END) : -1;
+        if (size < 0) {
+            fprintf(stderr, "[SIM] Could not open flash file %s\n", path);
+            exit(1);
+        }
+
+        // A new file is a new part: erased
+        if (size < SIM_FLASH_SIZE_B) {
+            uint8_t erased[FLASH_PAGE_SIZE];
+            memset(erased, 0xFF, sizeof(erased));
+            for (off_t offset = size ; offset < SIM_FLASH_SIZE_B ; offset += FLASH_PAGE_SIZE) {
+                if (pwrite(fd, erased, FLASH_PAGE_SIZE, offset) != FLASH_PAGE_SIZE) break;
+            }
+        }
+
+        flags |= MAP_SHARED;
+    } else {
+        flags |= MAP_PRIVATE | MAP_ANONYMOUS;
+    }
+
+    void* flash = mmap((void*)(uintptr_t)FLASH_BASE, SIM_FLASH_SIZE_B, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (flash != (void*)(uintptr_t)FLASH_BASE) {
+        fprintf(stderr, "[SIM] Could not map the flash at 0x%08lx\n", (unsigned long)FLASH_BASE);
+        exit(1);
+    }
+
+    sim_flash = (uint8_t*)flash;
+    if (fd < 0) memset(sim_flash, 0xFF, SIM_FLASH_SIZE_B);
+    if (fd >= 0) close(fd);
+    sim_flash_writable(sim_flash, SIM_FLASH_SIZE_B, false);
+}
+
+
+/**
+ * @brief Get the host memory behind a range of flash addresses.
+ *
+ * @returns The memory, or `NULL` if the range is not all flash.
+ */
+static uint8_t* sim_flash_at(uint32_t address, uint32_t length) {
+
+    if (address < FLASH_BASE || address - FLASH_BASE + length > SIM_FLASH_SIZE_B) return NULL;
+    return sim_flash + (address - FLASH_BASE);
+}
+
+
+/**
+ * @brief Open the host pages under a HAL write, or close them again.
+ */
+static void sim_flash_writable(uint8_t* target, uint32_t length, bool writable) {
+
+    uintptr_t host_page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)target & ~(host_page - 1);
+    mprotect((void*)start, (uintptr_t)target + length - start, writable ? PROT_READ | PROT_WRITE : PROT_READ);
+}
+
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+
+    sim_flash_locked = false;
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+
+    sim_flash_locked = true;
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Program one quad-word.
+ *
+ * Fails, as the device does with PROGERR, if the flash is locked, the
+ * address is not quad-word aligned or the quad-word is not erased.
+ */
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uintptr_t DataAddress) {
+
+    uint8_t* target = sim_flash_at(Address, 16);
+    bool erased = target != NULL;
+    for (uint32_t i = 0 ; erased && i < 16 ; ++i) erased = target[i] == 0xFF;
+
+    if (sim_flash_locked || TypeProgram != FLASH_TYPEPROGRAM_QUADWORD || (Address & 0x0F) != 0 || !erased) {
+        sim_flash_stats.errors++;
+        return HAL_ERROR;
+    }
+
+    sim_flash_writable(target, 16, true);
+    memcpy(target, (const void*)DataAddress, 16);
+    sim_flash_writable(target, 16, false);
+
+    sim_flash_stats.programs++;
+    sim_flash_stats.busy_us += SIM_FLASH_PROGRAM_US;
+    sim_advance(SIM_FLASH_PROGRAM_US);
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Erase a run of pages in one bank.
+ */
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* pEraseInit, uint32_t* PageError) {
+
+    *PageError = 0xFFFFFFFF;
+    uint32_t bank_base = FLASH_BASE + (pEraseInit->Banks == FLASH_BANK_2 ? SIM_FLASH_SIZE_B / 2 : 0);
+    for (uint32_t i = 0 ; i < pEraseInit->NbPages ; ++i) {
+        uint32_t page = pEraseInit->Page + i;
+        uint32_t address = bank_base + page * FLASH_PAGE_SIZE;
+        uint8_t* target = sim_flash_at(address, FLASH_PAGE_SIZE);
+        if (sim_flash_locked || pEraseInit->TypeErase != FLASH_TYPEERASE_PAGES || page >= FLASH_PAGE_NB || target == NULL) {
+            sim_flash_stats.errors++;
+            *PageError = page;
+            return HAL_ERROR;
+        }
+
+        sim_flash_writable(target, FLASH_PAGE_SIZE, true);
+        memset(target, 0xFF, FLASH_PAGE_SIZE);
+        sim_flash_writable(target, FLASH_PAGE_SIZE, false);
+
+        sim_flash_erase_counts[(address - FLASH_BASE) / FLASH_PAGE_SIZE]++;
+        sim_flash_stats.erases++;
+        sim_flash_stats.busy_us += SIM_FLASH_ERASE_US;
+        sim_advance(SIM_FLASH_ERASE_US);
+    }
+
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Count the erases of the page holding an address during this run.
+ */
+uint32_t sim_flash_page_erases(uint32_t address) {
+
+    return sim_flash_at(address, 1) != NULL ? sim_flash_erase_counts[(address - FLASH_BASE) / FLASH_PAGE_SIZE] : 0;
+}
+
+
+/**
+ * @brief Overwrite one byte of flash directly, eg. to mimic a write torn
+ *        by a power failure.
+ */
+void sim_flash_poke(uint32_t address, uint8_t value) {
+
+    uint8_t* target = sim_flash_at(address, 1);
+    if (target == NULL) return;
+
+    sim_flash_writable(target, 1, true);
+    *target = value;
+    sim_flash_writable(target, 1, false);
+}
@@ -0,0 +1,532 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host simulation of the STM32U5 HAL and Cortex-M33 core
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "mv_sim.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     SIM_IRQ_COUNT       128
+#define     SIM_TIMER_COUNT     1
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     sim_timer_expire(uint32_t index, uint32_t generation);
+static uint64_t sim_timer_period_us(const TIM_TypeDef* timer);
+static uint64_t sim_uart_wire_us(const UART_HandleTypeDef* huart, uint32_t size);
+static void     sim_dma_complete(uint32_t unused, uint32_t generation);
+
+
+/*
+ * GLOBALS
+ */
+GPIO_TypeDef    sim_gpioa;
+GPIO_TypeDef    sim_gpiod;
+USART_TypeDef   sim_usart2 = { .irq = USART2_IRQn };
+TIM_TypeDef     sim_tim7 = { .irq = TIM7_IRQn };
+DMA_Channel_TypeDef sim_gpdma1_channel0 = { .irq = GPDMA1_Channel0_IRQn };
+CoreDebug_Type  sim_core_debug;
+static DWT_Type sim_dwt_registers;
+
+static bool     sim_irq_enabled[SIM_IRQ_COUNT];
+static bool     sim_irq_pending[SIM_IRQ_COUNT];
+static bool     sim_primask = false;
+static bool     sim_in_handler = false;
+static uint64_t sim_uart_ns = 0;
+
+static TIM_TypeDef* const sim_timers[SIM_TIMER_COUNT] = { &sim_tim7 };
+
+// The transfer in progress on the one modelled DMA channel
+static DMA_HandleTypeDef* sim_dma_active = NULL;
+
+// Application interrupt handlers. Weak references, as in the device's
+// startup vector table, so the simulation links whichever the app defines
+extern void TIM2_IRQHandler(void)           __attribute__((weak));
+extern void TIM7_IRQHandler(void)           __attribute__((weak));
+extern void TIM8_BRK_IRQHandler(void)       __attribute__((weak));
+extern void GPDMA1_Channel0_IRQHandler(void) __attribute__((weak));
+extern void USART2_IRQHandler(void)         __attribute__((weak));
+
+
+/*
+ * INTERRUPTS
+ */
+
+/**
+ * @brief Map an IRQ number to the application's handler.
+ *
+ * @returns The handler, or `NULL` if the app does not define one.
+ */
+static void (*sim_irq_vector(uint32_t irq))(void) {
+
+    switch (irq) {
+        case TIM2_IRQn:             return TIM2_IRQHandler;
+        case TIM7_IRQn:             return TIM7_IRQHandler;
+        case TIM8_BRK_IRQn:         return TIM8_BRK_IRQHandler;
+        case GPDMA1_Channel0_IRQn:  return GPDMA1_Channel0_IRQHandler;
+        case USART2_IRQn:           return USART2_IRQHandler;
+        default:                    return NULL;
+    }
+}
+
+
+/**
+ * @brief Pend an IRQ and service it if the core would take it now.
+ *
+ * @param irq: The IRQ number.
+ */
+void sim_irq_raise(uint32_t irq) {
+
+    if (irq >= SIM_IRQ_COUNT) return;
+    sim_irq_pending[irq] = true;
+    sim_irq_service_pending();
+}
+
+
+/**
+ * @brief Run the handlers of all pending, enabled IRQs.
+ *
+ * Handlers do not nest and are held off while PRIMASK is set.
+ */
+void sim_irq_service_pending(void) {
+
+    if (sim_primask || sim_in_handler) return;
+
+    bool serviced = true;
+    while (serviced) {
+        serviced = false;
+        for (uint32_t irq = 0 ; irq < SIM_IRQ_COUNT ; ++irq) {
+            if (!sim_irq_pending[irq] || !sim_irq_enabled[irq]) continue;
+
+            sim_irq_pending[irq] = false;
+            void (*handler)(void) = sim_irq_vector(irq);
+            if (handler == NULL) continue;
+
+            sim_in_handler = true;
+            handler();
+            sim_in_handler = false;
+            sim_stats.irqs++;
+            serviced = true;
+        }
+    }
+}
+
+
+/**
+ * @brief Check for an interrupt that would wake the core from WFI.
+ */
+static bool sim_irq_wake_pending(void) {
+
+    for (uint32_t irq = 0 ; irq < SIM_IRQ_COUNT ; ++irq) {
+        if (sim_irq_pending[irq] && sim_irq_enabled[irq]) return true;
+    }
+
+    return false;
+}
+
+
+void NVIC_EnableIRQ(IRQn_Type irq) {
+
+    sim_irq_enabled[irq] = true;
+    sim_irq_service_pending();
+}
+
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub) {
+
+    UNUSED(irq);
+    UNUSED(preempt);
+    UNUSED(sub);
+}
+
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq) {
+
+    NVIC_EnableIRQ(irq);
+}
+
+
+void NVIC_DisableIRQ(IRQn_Type irq) {
+
+    sim_irq_enabled[irq] = false;
+}
+
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq) {
+
+    sim_irq_pending[irq] = false;
+}
+
+
+void NVIC_SetPendingIRQ(IRQn_Type irq) {
+
+    sim_irq_raise(irq);
+}
+
+
+void __disable_irq(void) {
+
+    sim_primask = true;
+}
+
+
+void __enable_irq(void) {
+
+    sim_primask = false;
+    sim_irq_service_pending();
+}
+
+
+uint32_t __get_PRIMASK(void) {
+
+    return sim_primask ? 1 : 0;
+}
+
+
+void __set_PRIMASK(uint32_t mask) {
+
+    if (mask & 1) {
+        __disable_irq();
+    } else {
+        __enable_irq();
+    }
+}
+
+
+/**
+ * @brief Get the DWT registers, with CYCCNT brought up to date.
+ *
+ * Once enabled, the cycle counter follows the host's time-stamp counter,
+ * or its nanosecond clock where there is none: profiles measure the
+ * demo's code on the host, not the virtual clock.
+ */
+DWT_Type* sim_dwt(void) {
+
+    if ((sim_core_debug.DEMCR & CoreDebug_DEMCR_TRCENA_Msk) && (sim_dwt_registers.CTRL & DWT_CTRL_CYCCNTENA_Msk)) {
+#if defined(__x86_64__) || defined(__i386__)
+        sim_dwt_registers.CYCCNT = (uint32_t)__rdtsc();
+#else
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        sim_dwt_registers.CYCCNT = (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec);
+#endif
+    }
+
+    return &sim_dwt_registers;
+}
+
+
+/**
+ * @brief Wait For Interrupt.
+ *
+ * Skips the virtual clock straight to the next simulated event and keeps
+ * doing so until an enabled IRQ is pending. As on the core, a pending IRQ
+ * wakes WFI even while PRIMASK holds off its handler.
+ */
+void __WFI(void) {
+
+    sim_stats.wfi_calls++;
+    while (!sim_irq_wake_pending()) {
+        uint64_t next = sim_next_deadline();
+        sim_advance_to(next == SIM_NEVER ? sim_config.run_us : next);
+    }
+
+    sim_irq_service_pending();
+}
+
+
+/*
+ * HAL CORE
+ */
+HAL_StatusTypeDef HAL_Init(void) {
+
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_InitTick(uint32_t TickPriority) {
+
+    UNUSED(TickPriority);
+    return HAL_OK;
+}
+
+
+uint32_t HAL_GetTick(void) {
+
+    return (uint32_t)(sim_now() / 1000);
+}
+
+
+void SystemCoreClockUpdate(void) {
+
+    // No clock tree to read on the host
+}
+
+
+void HAL_SuspendTick(void) {
+
+    // The HAL tick is derived from the virtual clock
+}
+
+
+void HAL_ResumeTick(void) {
+
+}
+
+
+void HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef* config, uint32_t* flash_latency) {
+
+    memset(config, 0, sizeof(RCC_ClkInitTypeDef));
+    config->APB1CLKDivider = RCC_HCLK_DIV1;
+    *flash_latency = 0;
+}
+
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(const RCC_PeriphCLKInitTypeDef* init) {
+
+    UNUSED(init);
+    return HAL_OK;
+}
+
+
+/*
+ * GPIO
+ */
+void HAL_GPIO_Init(GPIO_TypeDef* port, const GPIO_InitTypeDef* init) {
+
+    UNUSED(port);
+    UNUSED(init);
+}
+
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state) {
+
+    if (state == GPIO_PIN_SET) {
+        port->odr |= pin;
+    } else {
+        port->odr &= ~(uint32_t)pin;
+    }
+}
+
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef* port, uint16_t pin) {
+
+    port->odr ^= pin;
+    port->toggles++;
+    sim_stats.led_toggles++;
+}
+
+
+/*
+ * TIMERS
+ */
+
+/**
+ * @brief Simulated event: a timer's counter has reached its reload value.
+ *
+ * @param index:      The timer's index in `sim_timers`.
+ * @param generation: The timer's generation when it was started.
+ */
+static void sim_timer_expire(uint32_t index, uint32_t generation) {
+
+    TIM_TypeDef* timer = sim_timers[index];
+    if (timer->generation != generation) return;
+
+    timer->SR |= TIM_FLAG_UPDATE;
+    if (timer->CR1 & TIM_OPMODE_SINGLE) timer->generation++;
+    else sim_schedule(sim_now() + sim_timer_period_us(timer), sim_timer_expire, index, generation);
+
+    if (timer->DIER & TIM_IT_UPDATE) sim_irq_raise(timer->irq);
+}
+
+
+/**
+ * @brief Get a timer's update period from its prescaler and reload values.
+ */
+static uint64_t sim_timer_period_us(const TIM_TypeDef* timer) {
+
+    uint32_t clock = 0;
+    mvGetPClk1(&clock);
+    return (uint64_t)(timer->PSC + 1) * (timer->ARR + 1) * 1000000ULL / clock;
+}
+
+
+HAL_StatusTypeDef HAL_TIM_OnePulse_Init(TIM_HandleTypeDef* htim, uint32_t mode) {
+
+    if (htim == NULL || htim->Instance == NULL) return HAL_ERROR;
+    htim->Instance->PSC = htim->Init.Prescaler;
+    htim->Instance->ARR = htim->Init.Period;
+    htim->Instance->CR1 = mode;
+    htim->Instance->CNT = 0;
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_TIM_Base_Start_IT(TIM_HandleTypeDef* htim) {
+
+    TIM_TypeDef* timer = htim->Instance;
+    for (uint32_t i = 0 ; i < SIM_TIMER_COUNT ; ++i) {
+        if (sim_timers[i] != timer) continue;
+
+        // Restarting a running timer orphans its pending expiry
+        timer->generation++;
+        timer->DIER |= TIM_IT_UPDATE;
+        uint64_t span = sim_timer_period_us(timer) * (timer->ARR + 1 - timer->CNT) / (timer->ARR + 1);
+        sim_schedule(sim_now() + span, sim_timer_expire, i, timer->generation);
+        return HAL_OK;
+    }
+
+    return HAL_ERROR;
+}
+
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef* htim) {
+
+    htim->Instance->generation++;
+    htim->Instance->DIER &= ~TIM_IT_UPDATE;
+    return HAL_OK;
+}
+
+
+/*
+ * UART
+ */
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef* huart) {
+
+    if (huart == NULL || huart->Instance == NULL || huart->Init.BaudRate == 0) return HAL_ERROR;
+    huart->gState = HAL_UART_STATE_READY;
+    HAL_UART_MspInit(huart);
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Get the time a number of bytes take on the wire: ten bit
+ *        periods per byte for 8N1 framing.
+ *
+ * Fractions of a microsecond are carried over to the next call.
+ */
+static uint64_t sim_uart_wire_us(const UART_HandleTypeDef* huart, uint32_t size) {
+
+    sim_uart_ns += (uint64_t)size * 10ULL * 1000000000ULL / huart->Init.BaudRate;
+    uint64_t wire_us = sim_uart_ns / 1000;
+    sim_uart_ns %= 1000;
+    return wire_us;
+}
+
+
+/**
+ * @brief Blocking UART transmit.
+ *
+ * Costs the virtual time the bytes take on the wire.
+ */
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size, uint32_t timeout) {
+
+    UNUSED(timeout);
+    if (huart == NULL || data == NULL) return HAL_ERROR;
+
+    huart->Instance->bytes += size;
+    sim_stats.uart_bytes += size;
+    if (sim_config.echo_uart) fwrite(data, 1, size, stdout);
+
+    uint64_t blocked_us = sim_uart_wire_us(huart, size);
+    sim_stats.uart_blocked_us += blocked_us;
+    sim_advance(blocked_us);
+    return HAL_OK;
+}
+
+
+/**
+ * @brief DMA UART transmit.
+ *
+ * Returns at once. The DMA channel's IRQ is raised once the bytes
+ * would have left the wire, and the UART's transmission-complete
+ * IRQ follows from `HAL_DMA_IRQHandler()`, as on the device.
+ */
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size) {
+
+    if (huart == NULL || data == NULL || huart->hdmatx == NULL) return HAL_ERROR;
+    if (huart->gState == HAL_UART_STATE_BUSY_TX) return HAL_BUSY;
+
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    huart->Instance->bytes += size;
+    sim_stats.uart_bytes += size;
+    if (sim_config.echo_uart) fwrite(data, 1, size, stdout);
+
+    DMA_Channel_TypeDef* channel = huart->hdmatx->Instance;
+    channel->generation++;
+    channel->done = false;
+    sim_dma_active = huart->hdmatx;
+    sim_schedule(sim_now() + sim_uart_wire_us(huart, size), sim_dma_complete, 0, channel->generation);
+    return HAL_OK;
+}
+
+
+void HAL_UART_IRQHandler(UART_HandleTypeDef* huart) {
+
+    if (huart->Instance->tc) {
+        huart->Instance->tc = false;
+        huart->gState = HAL_UART_STATE_READY;
+        HAL_UART_TxCpltCallback(huart);
+    }
+}
+
+
+__attribute__((weak)) void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart) {
+
+    UNUSED(huart);
+}
+
+
+/*
+ * DMA
+ */
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef* hdma) {
+
+    if (hdma == NULL || hdma->Instance == NULL) return HAL_ERROR;
+    return HAL_OK;
+}
+
+
+/**
+ * @brief Simulated event: the active DMA transfer has completed.
+ */
+static void sim_dma_complete(uint32_t unused, uint32_t generation) {
+
+    UNUSED(unused);
+    if (sim_dma_active == NULL || sim_dma_active->Instance->generation != generation) return;
+
+    sim_dma_active->Instance->done = true;
+    sim_irq_raise(sim_dma_active->Instance->irq);
+}
+
+
+/**
+ * @brief Complete a UART transmit transfer: as on the device, this
+ *        hands over to the UART's transmission-complete interrupt.
+ */
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef* hdma) {
+
+    if (!hdma->Instance->done) return;
+    hdma->Instance->done = false;
+
+    UART_HandleTypeDef* huart = (UART_HandleTypeDef*)hdma->Parent;
+    if (huart == NULL) return;
+    huart->Instance->tc = true;
+    sim_irq_raise(huart->Instance->irq);
+}
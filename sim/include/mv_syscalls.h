@@ -0,0 +1,197 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host simulation stand-in for the Microvisor system call API
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _MV_SYSCALLS_H_
+#define _MV_SYSCALLS_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+
+
+/*
+ * NOTE This header mirrors the subset of `mv_syscalls.h` from the
+ *      Microvisor HAL that the demo uses. Types and names match the
+ *      device header so the files in `demo/` compile unchanged; the
+ *      calls themselves are implemented against a virtual clock in
+ *      `sim/mv_sim.c`.
+ */
+
+
+/*
+ * TYPES
+ */
+typedef uint32_t MvNotificationHandle;
+typedef uint32_t MvNetworkHandle;
+typedef uint32_t MvChannelHandle;
+
+enum MvStatus {
+    MV_STATUS_OKAY = 0,
+    MV_STATUS_UNAVAILABLE,
+    MV_STATUS_INVALIDHANDLE,
+    MV_STATUS_INVALIDBUFFERSIZE,
+    MV_STATUS_INVALIDBUFFERALIGNMENT,
+    MV_STATUS_PARAMETERFAULT,
+    MV_STATUS_CHANNELCLOSED,
+    MV_STATUS_RESPONSENOTPRESENT,
+    MV_STATUS_HEADERINDEXINVALID,
+    MV_STATUS_OFFSETINVALID,
+    MV_STATUS_TOOMANYCHANNELS,
+    MV_STATUS_TOOMANYNOTIFICATIONBUFFERS,
+};
+
+enum MvEventType {
+    MV_EVENTTYPE_NONE = 0,
+    MV_EVENTTYPE_NETWORKSTATUSCHANGED = 1,
+    MV_EVENTTYPE_CHANNELDATAREADABLE = 2,
+    MV_EVENTTYPE_CHANNELDATAWRITESPACE = 3,
+    MV_EVENTTYPE_CHANNELNOTCONNECTED = 4,
+};
+
+enum MvNetworkStatus {
+    MV_NETWORKSTATUS_DELIBERATELYOFFLINE = 0,
+    MV_NETWORKSTATUS_CONNECTED = 1,
+    MV_NETWORKSTATUS_CONNECTING = 2,
+};
+
+enum MvChannelType {
+    MV_CHANNELTYPE_OPAQUEBYTES = 1,
+    MV_CHANNELTYPE_HTTP = 2,
+    MV_CHANNELTYPE_MQTT = 3,
+};
+
+enum MvClosureReason {
+    MV_CLOSUREREASON_NOREASON = 0,
+    MV_CLOSUREREASON_NETWORKDISCONNECTED = 1,
+    MV_CLOSUREREASON_CHANNELCLOSEDBYSERVER = 2,
+};
+
+enum MvHttpResult {
+    MV_HTTPRESULT_OK = 0,
+    MV_HTTPRESULT_UNSUPPORTEDURISCHEME,
+    MV_HTTPRESULT_UNSUPPORTEDMETHOD,
+    MV_HTTPRESULT_INVALIDHEADERS,
+    MV_HTTPRESULT_INVALIDTIMEOUT,
+    MV_HTTPRESULT_REQUESTFAILED,
+    MV_HTTPRESULT_RESPONSETOOLARGE,
+};
+
+enum MvWakeReason {
+    MV_WAKEREASON_COLDBOOT = 0,
+};
+
+struct MvNotification {
+    uint64_t microseconds;
+    uint32_t event_type;
+    uint32_t tag;
+};
+
+struct MvNotificationSetup {
+    uint32_t                irq;
+    struct MvNotification*  buffer;
+    uint32_t                buffer_size;
+};
+
+struct MvSizedString {
+    const uint8_t*  data;
+    uint32_t        length;
+};
+
+struct MvRequestNetworkParams {
+    uint32_t version;
+    union {
+        struct {
+            MvNotificationHandle    notification_handle;
+            uint32_t                notification_tag;
+        } v1;
+    };
+};
+
+struct MvOpenChannelParams {
+    uint32_t version;
+    union {
+        struct {
+            MvNotificationHandle    notification_handle;
+            uint32_t                notification_tag;
+            MvNetworkHandle         network_handle;
+            uint8_t*                receive_buffer;
+            uint32_t                receive_buffer_len;
+            uint8_t*                send_buffer;
+            uint32_t                send_buffer_len;
+            enum MvChannelType      channel_type;
+            struct MvSizedString    endpoint;
+        } v1;
+    };
+};
+
+struct MvHttpHeader {
+    struct MvSizedString    key;
+    struct MvSizedString    value;
+};
+
+struct MvHttpRequest {
+    struct MvSizedString        method;
+    struct MvSizedString        url;
+    uint32_t                    num_headers;
+    const struct MvHttpHeader*  headers;
+    struct MvSizedString        body;
+    uint32_t                    timeout_ms;
+};
+
+struct MvHttpResponseData {
+    enum MvHttpResult   result;
+    uint32_t            status_code;
+    uint32_t            num_headers;
+    uint32_t            body_length;
+};
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+enum MvStatus mvGetMicroseconds(uint64_t* usec);
+enum MvStatus mvGetWallTime(uint64_t* usec);
+enum MvStatus mvGetHClk(uint32_t* hclk);
+enum MvStatus mvGetPClk1(uint32_t* pclk1);
+enum MvStatus mvGetDeviceId(uint8_t* buffer, uint32_t length);
+enum MvStatus mvGetWakeReason(enum MvWakeReason* reason);
+enum MvStatus mvSystemLedEnable(uint32_t enable);
+
+enum MvStatus mvServerLoggingInit(uint8_t* buffer, uint32_t length);
+enum MvStatus mvServerLog(const uint8_t* text, uint16_t length);
+
+enum MvStatus mvSetupNotifications(const struct MvNotificationSetup* setup, MvNotificationHandle* handle);
+
+enum MvStatus mvRequestNetwork(const struct MvRequestNetworkParams* params, MvNetworkHandle* handle);
+enum MvStatus mvGetNetworkStatus(MvNetworkHandle handle, enum MvNetworkStatus* status);
+enum MvStatus mvReleaseNetwork(MvNetworkHandle* handle);
+
+enum MvStatus mvOpenChannel(const struct MvOpenChannelParams* params, MvChannelHandle* handle);
+enum MvStatus mvCloseChannel(MvChannelHandle* handle);
+enum MvStatus mvGetChannelClosureReason(MvChannelHandle handle, enum MvClosureReason* reason);
+
+enum MvStatus mvSendHttpRequest(MvChannelHandle handle, const struct MvHttpRequest* request);
+enum MvStatus mvReadHttpResponseData(MvChannelHandle handle, struct MvHttpResponseData* response);
+enum MvStatus mvReadHttpResponseHeader(MvChannelHandle handle, uint32_t index, uint8_t* buffer, uint32_t size);
+enum MvStatus mvReadHttpResponseBody(MvChannelHandle handle, uint32_t offset, uint8_t* buffer, uint32_t size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _MV_SYSCALLS_H_
@@ -0,0 +1,42 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host stand-in for newlib's reentrancy header
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _REENT_H_
+#define _REENT_H_
+
+
+/*
+ * NOTE The host C library has no `struct _reent`. This holds the one
+ *      field `demo/pool.c`'s newlib hooks set, so `pool-bench` can build
+ *      and call them. The simulator itself keeps the host's allocator.
+ */
+#include <errno.h>
+
+
+/*
+ * TYPES
+ */
+struct _reent {
+    int     _errno;
+};
+
+
+/*
+ * GLOBALS
+ */
+extern struct _reent* _impure_ptr;
+
+
+/*
+ * MACROS
+ */
+#define     _REENT                      _impure_ptr
+
+
+#endif      // _REENT_H_
@@ -0,0 +1,341 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host simulation stand-in for the STM32U5 HAL
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _STM32U5XX_HAL_H_
+#define _STM32U5XX_HAL_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * NOTE Only the HAL, CMSIS and peripheral names referenced by `demo/`
+ *      are provided. Peripherals are modelled just far enough to be
+ *      counted, timed against the virtual clock, or to raise an IRQ.
+ */
+
+
+/*
+ * CONSTANTS
+ */
+#define     __IO                        volatile
+#define     UNUSED(X)                   (void)(X)
+
+#define     TICK_INT_PRIORITY           15U
+#define     __NVIC_PRIO_BITS            4U
+
+// Interrupt numbers as per the STM32U585 vector table
+typedef enum {
+    GPDMA1_Channel0_IRQn        = 29,
+    TIM2_IRQn                   = 45,
+    TIM6_IRQn                   = 49,
+    TIM7_IRQn                   = 50,
+    TIM8_BRK_IRQn               = 51,
+    USART2_IRQn                 = 62,
+} IRQn_Type;
+
+#define     GPIO_PIN_5                  ((uint16_t)0x0020)
+#define     GPIO_MODE_OUTPUT_PP         0x01U
+#define     GPIO_MODE_AF_PP             0x02U
+#define     GPIO_NOPULL                 0x00U
+#define     GPIO_PULLUP                 0x01U
+#define     GPIO_SPEED_FREQ_HIGH        0x02U
+#define     GPIO_SPEED_FREQ_VERY_HIGH   0x03U
+#define     GPIO_AF7_USART2             0x07U
+
+#define     UART_WORDLENGTH_8B          0x00U
+#define     UART_STOPBITS_1             0x00U
+#define     UART_PARITY_NONE            0x00U
+#define     UART_MODE_TX                0x08U
+#define     UART_HWCONTROL_NONE         0x00U
+
+#define     RCC_PERIPHCLK_USART2        0x02U
+#define     RCC_USART2CLKSOURCE_PCLK1   0x00U
+#define     RCC_HCLK_DIV1               0x00U
+
+#define     TIM_COUNTERMODE_UP          0x00U
+#define     TIM_CLOCKDIVISION_DIV1      0x00U
+#define     TIM_OPMODE_SINGLE           0x08U
+#define     TIM_FLAG_UPDATE             0x01U
+#define     TIM_IT_UPDATE               0x01U
+
+#define     HAL_UART_STATE_READY        0x20U
+#define     HAL_UART_STATE_BUSY_TX      0x21U
+
+#define     GPDMA1_REQUEST_USART2_TX    28U
+#define     DMA_BREQ_SINGLE_BURST       0x00U
+#define     DMA_MEMORY_TO_PERIPH        0x01U
+#define     DMA_SINC_INCREMENTED        0x08U
+#define     DMA_DINC_FIXED              0x00U
+#define     DMA_SRC_DATAWIDTH_BYTE      0x00U
+#define     DMA_DEST_DATAWIDTH_BYTE     0x00U
+#define     DMA_LOW_PRIORITY_LOW_WEIGHT 0x00U
+#define     DMA_SRC_ALLOCATED_PORT0     0x00U
+#define     DMA_DEST_ALLOCATED_PORT0    0x00U
+#define     DMA_TCEM_BLOCK_TRANSFER     0x00U
+#define     DMA_NORMAL                  0x00U
+
+// Flash geometry as per the 2MB STM32U585: two banks of 128 8KB pages
+#define     FLASH_BASE                  0x08000000UL
+#define     FLASH_PAGE_SIZE             0x2000U
+#define     FLASH_PAGE_NB               128U
+#define     FLASH_BANK_1                0x01U
+#define     FLASH_BANK_2                0x02U
+#define     FLASH_TYPEERASE_PAGES       0x02U
+#define     FLASH_TYPEPROGRAM_QUADWORD  0x01U
+
+#define     CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+#define     DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+
+
+/*
+ * TYPES
+ */
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+    uint32_t    odr;
+    uint32_t    toggles;
+} GPIO_TypeDef;
+
+typedef struct {
+    uint32_t    Pin;
+    uint32_t    Mode;
+    uint32_t    Pull;
+    uint32_t    Speed;
+    uint32_t    Alternate;
+} GPIO_InitTypeDef;
+
+typedef struct {
+    uint32_t    irq;
+    uint32_t    bytes;
+    bool        tc;                 // Transmission complete
+} USART_TypeDef;
+
+typedef struct {
+    uint32_t    irq;
+    uint32_t    generation;
+    bool        done;
+} DMA_Channel_TypeDef;
+
+typedef struct {
+    uint32_t    Request;
+    uint32_t    BlkHWRequest;
+    uint32_t    Direction;
+    uint32_t    SrcInc;
+    uint32_t    DestInc;
+    uint32_t    SrcDataWidth;
+    uint32_t    DestDataWidth;
+    uint32_t    Priority;
+    uint32_t    SrcBurstLength;
+    uint32_t    DestBurstLength;
+    uint32_t    TransferAllocatedPort;
+    uint32_t    TransferEventMode;
+    uint32_t    Mode;
+} DMA_InitTypeDef;
+
+typedef struct {
+    DMA_Channel_TypeDef*    Instance;
+    DMA_InitTypeDef         Init;
+    void*                   Parent;
+} DMA_HandleTypeDef;
+
+typedef struct {
+    uint32_t    BaudRate;
+    uint32_t    WordLength;
+    uint32_t    StopBits;
+    uint32_t    Parity;
+    uint32_t    Mode;
+    uint32_t    HwFlowCtl;
+} UART_InitTypeDef;
+
+typedef struct {
+    USART_TypeDef*      Instance;
+    UART_InitTypeDef    Init;
+    DMA_HandleTypeDef*  hdmatx;
+    volatile uint32_t   gState;
+} UART_HandleTypeDef;
+
+typedef struct {
+    uint32_t    PeriphClockSelection;
+    uint32_t    Usart2ClockSelection;
+} RCC_PeriphCLKInitTypeDef;
+
+typedef struct {
+    uint32_t    ClockType;
+    uint32_t    SYSCLKSource;
+    uint32_t    AHBCLKDivider;
+    uint32_t    APB1CLKDivider;
+    uint32_t    APB2CLKDivider;
+    uint32_t    APB3CLKDivider;
+} RCC_ClkInitTypeDef;
+
+typedef struct {
+    uint32_t    CR1;
+    uint32_t    DIER;
+    uint32_t    SR;
+    uint32_t    CNT;
+    uint32_t    PSC;
+    uint32_t    ARR;
+    uint32_t    irq;
+    uint32_t    generation;
+} TIM_TypeDef;
+
+typedef struct {
+    uint32_t    Prescaler;
+    uint32_t    CounterMode;
+    uint32_t    Period;
+    uint32_t    ClockDivision;
+    uint32_t    RepetitionCounter;
+    uint32_t    AutoReloadPreload;
+} TIM_Base_InitTypeDef;
+
+typedef struct {
+    TIM_TypeDef*            Instance;
+    TIM_Base_InitTypeDef    Init;
+} TIM_HandleTypeDef;
+
+typedef struct {
+    uint32_t    TypeErase;
+    uint32_t    Banks;
+    uint32_t    Page;
+    uint32_t    NbPages;
+} FLASH_EraseInitTypeDef;
+
+typedef struct {
+    uint32_t    DEMCR;
+} CoreDebug_Type;
+
+typedef struct {
+    uint32_t    CTRL;
+    uint32_t    CYCCNT;
+} DWT_Type;
+
+
+/*
+ * PERIPHERALS
+ */
+extern GPIO_TypeDef     sim_gpioa;
+extern GPIO_TypeDef     sim_gpiod;
+extern USART_TypeDef    sim_usart2;
+extern TIM_TypeDef      sim_tim7;
+extern DMA_Channel_TypeDef sim_gpdma1_channel0;
+extern CoreDebug_Type   sim_core_debug;
+
+#define     GPIOA                       (&sim_gpioa)
+#define     GPIOD                       (&sim_gpiod)
+#define     USART2                      (&sim_usart2)
+#define     TIM7                        (&sim_tim7)
+#define     GPDMA1_Channel0             (&sim_gpdma1_channel0)
+#define     CoreDebug                   (&sim_core_debug)
+
+// Each access to the cycle counter reads the host's time-stamp counter
+#define     DWT                         (sim_dwt())
+
+// Barriers map to a full fence so the host compiler and CPU honour them
+#define     __DMB()                         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define     __DSB()                         __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+// Clock gates are no-ops on the host. Expand to a block so that
+// callers may, as on the device, omit the trailing semicolon
+#define     __HAL_RCC_GPIOA_CLK_ENABLE()    {}
+#define     __HAL_RCC_GPIOD_CLK_ENABLE()    {}
+#define     __HAL_RCC_USART2_CLK_ENABLE()   {}
+#define     __HAL_RCC_TIM7_CLK_ENABLE()     {}
+#define     __HAL_RCC_GPDMA1_CLK_ENABLE()   {}
+
+#define     __HAL_LINKDMA(H, F, D)          do { (H)->F = &(D); (D).Parent = (H); } while (0)
+
+#define     __HAL_TIM_SET_AUTORELOAD(H, V)  do { (H)->Instance->ARR = (V); (H)->Init.Period = (V); } while (0)
+#define     __HAL_TIM_SET_COUNTER(H, V)     ((H)->Instance->CNT = (V))
+#define     __HAL_TIM_CLEAR_FLAG(H, F)      ((H)->Instance->SR = ~(F))
+#define     __HAL_TIM_CLEAR_IT(H, I)        ((H)->Instance->SR = ~(I))
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+HAL_StatusTypeDef   HAL_Init(void);
+HAL_StatusTypeDef   HAL_InitTick(uint32_t TickPriority);
+uint32_t            HAL_GetTick(void);
+void                SystemCoreClockUpdate(void);
+
+void                HAL_GPIO_Init(GPIO_TypeDef* port, const GPIO_InitTypeDef* init);
+void                HAL_GPIO_WritePin(GPIO_TypeDef* port, uint16_t pin, GPIO_PinState state);
+void                HAL_GPIO_TogglePin(GPIO_TypeDef* port, uint16_t pin);
+
+void                HAL_SuspendTick(void);
+void                HAL_ResumeTick(void);
+
+void                HAL_RCC_GetClockConfig(RCC_ClkInitTypeDef* config, uint32_t* flash_latency);
+HAL_StatusTypeDef   HAL_RCCEx_PeriphCLKConfig(const RCC_PeriphCLKInitTypeDef* init);
+
+HAL_StatusTypeDef   HAL_TIM_OnePulse_Init(TIM_HandleTypeDef* htim, uint32_t mode);
+HAL_StatusTypeDef   HAL_TIM_Base_Start_IT(TIM_HandleTypeDef* htim);
+HAL_StatusTypeDef   HAL_TIM_Base_Stop_IT(TIM_HandleTypeDef* htim);
+
+void                HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t preempt, uint32_t sub);
+void                HAL_NVIC_EnableIRQ(IRQn_Type irq);
+
+HAL_StatusTypeDef   HAL_UART_Init(UART_HandleTypeDef* huart);
+void                HAL_UART_MspInit(UART_HandleTypeDef* huart);
+HAL_StatusTypeDef   HAL_UART_Transmit(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef   HAL_UART_Transmit_DMA(UART_HandleTypeDef* huart, const uint8_t* data, uint16_t size);
+void                HAL_UART_IRQHandler(UART_HandleTypeDef* huart);
+void                HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart);
+
+HAL_StatusTypeDef   HAL_DMA_Init(DMA_HandleTypeDef* hdma);
+void                HAL_DMA_IRQHandler(DMA_HandleTypeDef* hdma);
+
+// NOTE `DataAddress` is a `uint32_t` on the device. Here it must hold a
+//      host pointer, so callers cast their source with `(uintptr_t)`
+HAL_StatusTypeDef   HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef   HAL_FLASH_Lock(void);
+HAL_StatusTypeDef   HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uintptr_t DataAddress);
+HAL_StatusTypeDef   HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* pEraseInit, uint32_t* PageError);
+
+void                NVIC_EnableIRQ(IRQn_Type irq);
+void                NVIC_DisableIRQ(IRQn_Type irq);
+void                NVIC_ClearPendingIRQ(IRQn_Type irq);
+void                NVIC_SetPendingIRQ(IRQn_Type irq);
+
+DWT_Type*           sim_dwt(void);
+
+void                __WFI(void);
+void                __disable_irq(void);
+void                __enable_irq(void);
+uint32_t            __get_PRIMASK(void);
+void                __set_PRIMASK(uint32_t mask);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _STM32U5XX_HAL_H_
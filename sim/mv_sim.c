@@ -0,0 +1,955 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host simulation of the Microvisor system calls
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include "mv_sim.h"
+#include "compress.h"
+
+
+/*
+ * STATIC PROTOTYPES
+ */
+static void     sim_init(void);
+static void     sim_syscall(void);
+static void     sim_poll(void);
+static uint64_t sim_env(const char* name, uint64_t fallback);
+static void     sim_notify(MvNotificationHandle handle, uint32_t event_type, uint32_t tag);
+static void     sim_network_up(uint32_t generation, uint32_t unused);
+static void     sim_network_drop(uint32_t unused_a, uint32_t unused_b);
+static void     sim_http_respond(uint32_t index, uint32_t generation);
+static struct sim_channel* sim_get_channel(MvChannelHandle handle);
+static void     sim_http_route(struct sim_channel* channel, const struct MvHttpRequest* request);
+static bool     sim_http_not_modified(const struct MvHttpRequest* request, const char* etag);
+static bool     sim_http_header_is(const struct MvHttpRequest* request, const char* name, const char* value);
+static bool     sim_http_body_expands(const struct MvHttpRequest* request);
+static void     sim_http_add_header(struct sim_channel* channel, const char* format, ...) __attribute__ ((__format__ (__printf__, 2, 3)));
+
+
+/*
+ * TYPES
+ */
+struct sim_event {
+    uint64_t        when;
+    sim_event_fn    fn;
+    uint32_t        arg_a;
+    uint32_t        arg_b;
+};
+
+struct sim_center {
+    MvNotificationHandle    handle;
+    struct MvNotification*  buffer;
+    uint32_t                count;
+    uint32_t                write_index;
+    uint32_t                irq;
+};
+
+struct sim_network {
+    MvNetworkHandle         handle;
+    MvNotificationHandle    notification;
+    uint32_t                tag;
+    uint32_t                generation;     // Bumped on release, to orphan a pending attach
+    uint64_t                down_until;     // End of the simulated outage
+    bool                    drop_scheduled;
+};
+
+struct sim_channel {
+    MvChannelHandle             handle;
+    MvNotificationHandle        notification;
+    uint32_t                    tag;
+    uint32_t                    generation;
+    uint32_t                    rx_len;
+    uint32_t                    tx_len;
+    bool                        in_flight;
+    bool                        has_response;
+    bool                        connected;
+    enum MvClosureReason        closure;
+    struct MvHttpResponseData   response;
+    char                        headers[SIM_MAX_HEADERS][SIM_HEADER_MAX_LEN_B];
+    uint8_t                     body[SIM_BODY_MAX_LEN_B];
+};
+
+
+/*
+ * GLOBALS
+ */
+struct sim_stats    sim_stats;
+struct sim_config   sim_config;
+
+static uint64_t             sim_clock = 0;
+static bool                 sim_ready = false;
+static bool                 sim_advancing = false;
+static struct timespec      sim_real_start;
+
+static struct sim_event     sim_events[SIM_MAX_EVENTS];
+static uint32_t             sim_event_count = 0;
+
+static struct sim_center    sim_centers[SIM_MAX_NOTIFICATION_CENTERS];
+static uint32_t             sim_center_count = 0;
+
+static struct sim_network   sim_network = { 0 };
+static enum MvNetworkStatus sim_network_status = MV_NETWORKSTATUS_DELIBERATELYOFFLINE;
+
+static struct sim_channel   sim_channels[SIM_MAX_CHANNELS];
+static uint32_t             sim_next_channel_handle = 0x3000;
+
+static const char* sim_todo_titles[] = {
+    "delectus aut autem",
+    "quis ut nam facilis et officia qui",
+    "fugiat veniam minus",
+    "et porro tempora",
+    "laboriosam mollitia et enim quasi adipisci quia provident illum",
+    "qui ullam ratione quibusdam voluptatem quia omnis",
+    "illo expedita consequatur quia in",
+    "quo adipisci enim quam ut ab"
+};
+
+
+/*
+ * VIRTUAL CLOCK
+ */
+
+/**
+ * @brief Read the simulation configuration from the environment.
+ *
+ * All times are virtual. See the README for the variables.
+ */
+static void sim_init(void) {
+
+    if (sim_ready) return;
+    sim_ready = true;
+
+    sim_config.run_us          = sim_env("MV_SIM_RUN_S", 3600) * 1000000ULL;
+    sim_config.poll_us         = sim_env("MV_SIM_POLL_US", 100);
+    sim_config.net_attach_us   = sim_env("MV_SIM_NET_ATTACH_MS", 2000) * 1000ULL;
+    sim_config.net_drop_us     = sim_env("MV_SIM_NET_DROP_S", 0) * 1000000ULL;
+    sim_config.net_down_us     = sim_env("MV_SIM_NET_DOWN_S", 120) * 1000000ULL;
+    sim_config.http_latency_us = sim_env("MV_SIM_HTTP_LATENCY_MS", 400) * 1000ULL;
+    sim_config.channel_setup_us = sim_env("MV_SIM_CHANNEL_SETUP_MS", 600) * 1000ULL;
+    sim_config.todo_count      = (uint32_t)sim_env("MV_SIM_TODO_COUNT", 200);
+    sim_config.rate_limit      = (uint32_t)sim_env("MV_SIM_RATE_LIMIT", 0);
+    sim_config.echo_log        = sim_env("MV_SIM_LOG", 1) != 0;
+    sim_config.echo_uart       = sim_env("MV_SIM_UART", 0) != 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &sim_real_start);
+}
+
+
+/**
+ * @brief Read an unsigned integer environment variable.
+ *
+ * @param name:     The variable's name.
+ * @param fallback: The value to use if the variable is unset.
+ *
+ * @returns The value.
+ */
+static uint64_t sim_env(const char* name, uint64_t fallback) {
+
+    const char* value = getenv(name);
+    if (value == NULL || *value == 0) return fallback;
+    return strtoull(value, NULL, 0);
+}
+
+
+/**
+ * @brief Get the current virtual time.
+ *
+ * @returns Microseconds since simulated boot.
+ */
+uint64_t sim_now(void) {
+
+    return sim_clock;
+}
+
+
+/**
+ * @brief Move the virtual clock forward, firing any events that fall due.
+ *
+ * Events fire in time order with the clock set to their due time, so
+ * notification timestamps are exact. When the run time is exhausted the
+ * simulation reports and exits.
+ *
+ * @param when_us: The target virtual time.
+ */
+void sim_advance_to(uint64_t when_us) {
+
+    sim_init();
+
+    // Interrupt handlers may make calls that advance the clock:
+    // time only moves forward at the outermost level
+    if (sim_advancing) return;
+    sim_advancing = true;
+
+    while (sim_event_count > 0 && sim_events[0].when <= when_us) {
+        struct sim_event event = sim_events[0];
+        memmove(&sim_events[0], &sim_events[1], (sim_event_count - 1) * sizeof(struct sim_event));
+        sim_event_count--;
+
+        if (event.when > sim_clock) sim_clock = event.when;
+        if (sim_clock >= sim_config.run_us) break;
+        event.fn(event.arg_a, event.arg_b);
+    }
+
+    if (when_us > sim_clock) sim_clock = when_us;
+    sim_advancing = false;
+
+    if (sim_clock >= sim_config.run_us) sim_finish();
+}
+
+
+/**
+ * @brief Move the virtual clock forward by a fixed amount.
+ *
+ * @param delta_us: The number of microseconds to add.
+ */
+void sim_advance(uint64_t delta_us) {
+
+    sim_advance_to(sim_clock + delta_us);
+}
+
+
+/**
+ * @brief Get the time of the next simulated event.
+ *
+ * @returns The virtual time, or `SIM_NEVER` if nothing is scheduled.
+ */
+uint64_t sim_next_deadline(void) {
+
+    return sim_event_count > 0 ? sim_events[0].when : SIM_NEVER;
+}
+
+
+/**
+ * @brief Queue a callback to fire at a given virtual time.
+ *
+ * @param when_us: The virtual time.
+ * @param fn:      The callback.
+ * @param arg_a:   First callback argument.
+ * @param arg_b:   Second callback argument.
+ */
+void sim_schedule(uint64_t when_us, sim_event_fn fn, uint32_t arg_a, uint32_t arg_b) {
+
+    if (sim_event_count == SIM_MAX_EVENTS) {
+        fprintf(stderr, "[SIM] Event queue full\n");
+        abort();
+    }
+
+    // Keep the queue sorted, preserving FIFO order for equal times
+    uint32_t i = sim_event_count;
+    while (i > 0 && sim_events[i - 1].when > when_us) {
+        sim_events[i] = sim_events[i - 1];
+        i--;
+    }
+
+    sim_events[i] = (struct sim_event){ when_us, fn, arg_a, arg_b };
+    sim_event_count++;
+}
+
+
+/**
+ * @brief Report the run statistics and terminate.
+ */
+void sim_finish(void) {
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double real_s = (double)(end.tv_sec - sim_real_start.tv_sec) + (double)(end.tv_nsec - sim_real_start.tv_nsec) / 1e9;
+    double virt_s = (double)sim_clock / 1e6;
+
+    fprintf(stderr, "\n[SIM] Virtual time:      %.3f s\n", virt_s);
+    fprintf(stderr, "[SIM] Real time:         %.3f s (%.0fx real time)\n", real_s, real_s > 0 ? virt_s / real_s : 0.0);
+    fprintf(stderr, "[SIM] Clock polls:       %llu\n", (unsigned long long)sim_stats.polls);
+    fprintf(stderr, "[SIM] System calls:      %llu\n", (unsigned long long)sim_stats.syscalls);
+    fprintf(stderr, "[SIM] WFI calls:         %llu\n", (unsigned long long)sim_stats.wfi_calls);
+    fprintf(stderr, "[SIM] IRQs serviced:     %llu\n", (unsigned long long)sim_stats.irqs);
+    fprintf(stderr, "[SIM] Notifications:     %llu posted, %llu dropped\n", (unsigned long long)sim_stats.notifications_posted, (unsigned long long)sim_stats.notifications_dropped);
+    fprintf(stderr, "[SIM] LED toggles:       %llu\n", (unsigned long long)sim_stats.led_toggles);
+    fprintf(stderr, "[SIM] Server log:        %llu lines, %llu bytes\n", (unsigned long long)sim_stats.log_lines, (unsigned long long)sim_stats.log_bytes);
+    fprintf(stderr, "[SIM] UART:              %llu bytes, %llu us blocked\n", (unsigned long long)sim_stats.uart_bytes, (unsigned long long)sim_stats.uart_blocked_us);
+    fprintf(stderr, "[SIM] Network:           %llu requests, %llu drops\n", (unsigned long long)sim_stats.network_requests, (unsigned long long)sim_stats.network_drops);
+    fprintf(stderr, "[SIM] Channels:          %llu opened, %llu closed\n", (unsigned long long)sim_stats.channels_opened, (unsigned long long)sim_stats.channels_closed);
+    fprintf(stderr, "[SIM] HTTP:              %llu requests, %llu responses, %llu bytes tx, %llu bytes rx\n",
+            (unsigned long long)sim_stats.http_requests, (unsigned long long)sim_stats.http_responses,
+            (unsigned long long)sim_stats.http_tx_bytes, (unsigned long long)sim_stats.http_rx_bytes);
+    fprintf(stderr, "[SIM] Flash:             %llu quad-words programmed, %llu pages erased, %llu errors, %llu us busy\n",
+            (unsigned long long)sim_flash_stats.programs, (unsigned long long)sim_flash_stats.erases,
+            (unsigned long long)sim_flash_stats.errors, (unsigned long long)sim_flash_stats.busy_us);
+    exit(0);
+}
+
+
+/**
+ * @brief Account for a system call.
+ */
+static void sim_syscall(void) {
+
+    sim_init();
+    sim_stats.syscalls++;
+}
+
+
+/**
+ * @brief Account for a system call made from a polling loop.
+ *
+ * Polling calls cost `MV_SIM_POLL_US` of virtual time, which stands in
+ * for one pass of the caller's loop.
+ */
+static void sim_poll(void) {
+
+    sim_syscall();
+    sim_stats.polls++;
+    sim_advance(sim_config.poll_us);
+}
+
+
+/*
+ * NOTIFICATIONS
+ */
+
+/**
+ * @brief Post a notification to a notification center and raise its IRQ.
+ *
+ * As on the device, records are written in sequence and a record is only
+ * written if the application has cleared its `event_type`. Otherwise the
+ * notification is lost.
+ *
+ * @param handle:     The notification center handle.
+ * @param event_type: The event.
+ * @param tag:        The user tag supplied with the resource.
+ */
+static void sim_notify(MvNotificationHandle handle, uint32_t event_type, uint32_t tag) {
+
+    for (uint32_t i = 0 ; i < sim_center_count ; ++i) {
+        struct sim_center* center = &sim_centers[i];
+        if (center->handle != handle) continue;
+
+        struct MvNotification* record = &center->buffer[center->write_index];
+        if (record->event_type != 0) {
+            sim_stats.notifications_dropped++;
+            return;
+        }
+
+        record->microseconds = sim_clock;
+        record->tag = tag;
+        record->event_type = event_type;
+        center->write_index = (center->write_index + 1) % center->count;
+        sim_stats.notifications_posted++;
+        sim_irq_raise(center->irq);
+        return;
+    }
+}
+
+
+enum MvStatus mvSetupNotifications(const struct MvNotificationSetup* setup, MvNotificationHandle* handle) {
+
+    sim_syscall();
+    if (setup == NULL || handle == NULL || setup->buffer == NULL) return MV_STATUS_PARAMETERFAULT;
+    if (setup->buffer_size < sizeof(struct MvNotification) || setup->buffer_size % sizeof(struct MvNotification) != 0) return MV_STATUS_INVALIDBUFFERSIZE;
+    if (((uintptr_t)setup->buffer & 7) != 0) return MV_STATUS_INVALIDBUFFERALIGNMENT;
+    if (sim_center_count == SIM_MAX_NOTIFICATION_CENTERS) return MV_STATUS_TOOMANYNOTIFICATIONBUFFERS;
+
+    struct sim_center* center = &sim_centers[sim_center_count];
+    center->handle      = 0x1000 + sim_center_count;
+    center->buffer      = setup->buffer;
+    center->count       = setup->buffer_size / sizeof(struct MvNotification);
+    center->write_index = 0;
+    center->irq         = setup->irq;
+    sim_center_count++;
+
+    *handle = center->handle;
+    return MV_STATUS_OKAY;
+}
+
+
+/*
+ * TIME AND DEVICE
+ */
+enum MvStatus mvGetMicroseconds(uint64_t* usec) {
+
+    sim_poll();
+    *usec = sim_clock;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvGetWallTime(uint64_t* usec) {
+
+    sim_syscall();
+    *usec = SIM_WALL_CLOCK_EPOCH_S * 1000000ULL + sim_clock;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvGetHClk(uint32_t* hclk) {
+
+    sim_syscall();
+    *hclk = 160000000;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvGetPClk1(uint32_t* pclk1) {
+
+    sim_syscall();
+    *pclk1 = 160000000;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvGetDeviceId(uint8_t* buffer, uint32_t length) {
+
+    sim_syscall();
+
+    // Set MV_SIM_DEVICE_ID to simulate another device of a fleet
+    const char* id = getenv("MV_SIM_DEVICE_ID");
+    if (id == NULL || *id == 0) id = "UV0000000000000000000000000000SIM";
+    size_t id_len = strlen(id);
+    memcpy(buffer, id, length < id_len ? length : id_len);
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvGetWakeReason(enum MvWakeReason* reason) {
+
+    sim_syscall();
+    *reason = MV_WAKEREASON_COLDBOOT;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvSystemLedEnable(uint32_t enable) {
+
+    sim_syscall();
+    (void)enable;
+    return MV_STATUS_OKAY;
+}
+
+
+/*
+ * LOGGING
+ */
+enum MvStatus mvServerLoggingInit(uint8_t* buffer, uint32_t length) {
+
+    sim_syscall();
+    if (buffer == NULL) return MV_STATUS_PARAMETERFAULT;
+    if (((uintptr_t)buffer & 511) != 0) return MV_STATUS_INVALIDBUFFERALIGNMENT;
+    if (length < 1024 || length % 512 != 0) return MV_STATUS_INVALIDBUFFERSIZE;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvServerLog(const uint8_t* text, uint16_t length) {
+
+    sim_syscall();
+    sim_stats.log_lines++;
+    sim_stats.log_bytes += length;
+    if (sim_config.echo_log) {
+        fprintf(stdout, "%10.6f %.*s\n", (double)sim_clock / 1e6, (int)length, (const char*)text);
+    }
+
+    return MV_STATUS_OKAY;
+}
+
+
+/*
+ * NETWORK
+ */
+
+/**
+ * @brief Simulated event: the modem has attached.
+ *
+ * @param generation: The network request's generation when the attach began.
+ */
+static void sim_network_up(uint32_t generation, uint32_t unused) {
+
+    (void)unused;
+    if (sim_network.handle == 0 || generation != sim_network.generation) return;
+
+    // Still in an outage: attach once it ends
+    if (sim_clock < sim_network.down_until) {
+        sim_schedule(sim_network.down_until, sim_network_up, generation, 0);
+        return;
+    }
+
+    sim_network_status = MV_NETWORKSTATUS_CONNECTED;
+    sim_notify(sim_network.notification, MV_EVENTTYPE_NETWORKSTATUSCHANGED, sim_network.tag);
+}
+
+
+/**
+ * @brief Simulated event: the network is lost for `MV_SIM_NET_DOWN_S`.
+ *
+ * Every open channel is disconnected, and any response in flight is
+ * lost. Microvisor reattaches once the outage ends.
+ */
+static void sim_network_drop(uint32_t unused_a, uint32_t unused_b) {
+
+    (void)unused_a;
+    (void)unused_b;
+    sim_stats.network_drops++;
+    sim_network.down_until = sim_clock + sim_config.net_down_us;
+    if (sim_network.handle == 0 || sim_network_status != MV_NETWORKSTATUS_CONNECTED) return;
+
+    sim_network_status = MV_NETWORKSTATUS_CONNECTING;
+    sim_notify(sim_network.notification, MV_EVENTTYPE_NETWORKSTATUSCHANGED, sim_network.tag);
+
+    for (uint32_t i = 0 ; i < SIM_MAX_CHANNELS ; ++i) {
+        struct sim_channel* channel = &sim_channels[i];
+        if (channel->handle == 0) continue;
+
+        channel->closure = MV_CLOSUREREASON_NETWORKDISCONNECTED;
+        channel->in_flight = false;
+        channel->generation++;
+        sim_notify(channel->notification, MV_EVENTTYPE_CHANNELNOTCONNECTED, channel->tag);
+    }
+
+    sim_schedule(sim_network.down_until, sim_network_up, sim_network.generation, 0);
+}
+
+
+enum MvStatus mvRequestNetwork(const struct MvRequestNetworkParams* params, MvNetworkHandle* handle) {
+
+    sim_syscall();
+    if (params == NULL || handle == NULL || params->version != 1) return MV_STATUS_PARAMETERFAULT;
+
+    if (sim_network.handle == 0) {
+        sim_network.handle       = 0x2000;
+        sim_network.notification = params->v1.notification_handle;
+        sim_network.tag          = params->v1.notification_tag;
+        sim_network_status       = MV_NETWORKSTATUS_CONNECTING;
+        sim_stats.network_requests++;
+        sim_schedule(sim_clock + sim_config.net_attach_us, sim_network_up, sim_network.generation, 0);
+
+        if (sim_config.net_drop_us > 0 && !sim_network.drop_scheduled) {
+            sim_network.drop_scheduled = true;
+            sim_schedule(sim_config.net_drop_us, sim_network_drop, 0, 0);
+        }
+    }
+
+    *handle = sim_network.handle;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvReleaseNetwork(MvNetworkHandle* handle) {
+
+    sim_syscall();
+    if (handle == NULL) return MV_STATUS_PARAMETERFAULT;
+    if (*handle == 0 || *handle != sim_network.handle) return MV_STATUS_INVALIDHANDLE;
+
+    sim_network.handle = 0;
+    sim_network.generation++;
+    sim_network_status = MV_NETWORKSTATUS_DELIBERATELYOFFLINE;
+    *handle = 0;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvGetNetworkStatus(MvNetworkHandle handle, enum MvNetworkStatus* status) {
+
+    sim_poll();
+    if (handle == 0 || handle != sim_network.handle) return MV_STATUS_INVALIDHANDLE;
+    *status = sim_network_status;
+    return MV_STATUS_OKAY;
+}
+
+
+/*
+ * CHANNELS
+ */
+
+/**
+ * @brief Find an open channel by handle.
+ *
+ * @returns The channel record, or `NULL`.
+ */
+static struct sim_channel* sim_get_channel(MvChannelHandle handle) {
+
+    if (handle == 0) return NULL;
+    for (uint32_t i = 0 ; i < SIM_MAX_CHANNELS ; ++i) {
+        if (sim_channels[i].handle == handle) return &sim_channels[i];
+    }
+
+    return NULL;
+}
+
+
+enum MvStatus mvOpenChannel(const struct MvOpenChannelParams* params, MvChannelHandle* handle) {
+
+    sim_syscall();
+    if (params == NULL || handle == NULL || params->version != 1) return MV_STATUS_PARAMETERFAULT;
+    if (params->v1.network_handle == 0 || params->v1.network_handle != sim_network.handle) return MV_STATUS_INVALIDHANDLE;
+    if (sim_network_status != MV_NETWORKSTATUS_CONNECTED) return MV_STATUS_UNAVAILABLE;
+    if (params->v1.receive_buffer == NULL || params->v1.send_buffer == NULL) return MV_STATUS_PARAMETERFAULT;
+    if (((uintptr_t)params->v1.receive_buffer & 511) != 0 || ((uintptr_t)params->v1.send_buffer & 511) != 0) return MV_STATUS_INVALIDBUFFERALIGNMENT;
+
+    for (uint32_t i = 0 ; i < SIM_MAX_CHANNELS ; ++i) {
+        struct sim_channel* channel = &sim_channels[i];
+        if (channel->handle != 0) continue;
+
+        uint32_t generation = channel->generation + 1;
+        memset(channel, 0, sizeof(struct sim_channel));
+        channel->handle       = sim_next_channel_handle++;
+        channel->generation   = generation;
+        channel->notification = params->v1.notification_handle;
+        channel->tag          = params->v1.notification_tag;
+        channel->rx_len       = params->v1.receive_buffer_len;
+        channel->tx_len       = params->v1.send_buffer_len;
+        sim_stats.channels_opened++;
+
+        *handle = channel->handle;
+        return MV_STATUS_OKAY;
+    }
+
+    return MV_STATUS_TOOMANYCHANNELS;
+}
+
+
+enum MvStatus mvCloseChannel(MvChannelHandle* handle) {
+
+    sim_syscall();
+    if (handle == NULL) return MV_STATUS_PARAMETERFAULT;
+
+    struct sim_channel* channel = sim_get_channel(*handle);
+    if (channel == NULL) return MV_STATUS_INVALIDHANDLE;
+
+    // Bumping the generation orphans any response still in flight
+    channel->handle = 0;
+    channel->generation++;
+    sim_stats.channels_closed++;
+    *handle = 0;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvGetChannelClosureReason(MvChannelHandle handle, enum MvClosureReason* reason) {
+
+    sim_syscall();
+    struct sim_channel* channel = sim_get_channel(handle);
+    if (channel == NULL) return MV_STATUS_INVALIDHANDLE;
+    *reason = channel->closure;
+    return MV_STATUS_OKAY;
+}
+
+
+/*
+ * HTTP
+ */
+
+/**
+ * @brief Simulated event: a response has arrived on a channel.
+ *
+ * @param index:      The channel's slot.
+ * @param generation: The slot's generation when the request was sent.
+ */
+static void sim_http_respond(uint32_t index, uint32_t generation) {
+
+    struct sim_channel* channel = &sim_channels[index];
+    if (channel->handle == 0 || channel->generation != generation) return;
+
+    channel->in_flight = false;
+    channel->has_response = true;
+    sim_stats.http_responses++;
+    sim_notify(channel->notification, MV_EVENTTYPE_CHANNELDATAREADABLE, channel->tag);
+}
+
+
+/**
+ * @brief Append a formatted header line to a channel's pending response.
+ */
+static void sim_http_add_header(struct sim_channel* channel, const char* format, ...) {
+
+    if (channel->response.num_headers == SIM_MAX_HEADERS) return;
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(channel->headers[channel->response.num_headers++], SIM_HEADER_MAX_LEN_B, format, args);
+    va_end(args);
+}
+
+
+/**
+ * @brief Check a request's conditional headers against a resource.
+ *
+ * @param request: The request.
+ * @param etag:    The resource's current ETag.
+ *
+ * @returns `true` if the requester's copy is current.
+ */
+static bool sim_http_not_modified(const struct MvHttpRequest* request, const char* etag) {
+
+    for (uint32_t i = 0 ; i < request->num_headers ; ++i) {
+        const struct MvHttpHeader* header = &request->headers[i];
+        const char* key = (const char*)header->key.data;
+        const char* value = (const char*)header->value.data;
+        const char* expected = NULL;
+        if (header->key.length == 13 && strncasecmp(key, "if-none-match", 13) == 0) {
+            expected = etag;
+        } else if (header->key.length == 17 && strncasecmp(key, "if-modified-since", 17) == 0) {
+            expected = SIM_LAST_MODIFIED;
+        }
+
+        if (expected != NULL) return header->value.length == strlen(expected) && memcmp(value, expected, header->value.length) == 0;
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Check whether a request has a header, eg. a Content-Type of
+ *        application/cbor. The name is matched in any case, the value exactly.
+ */
+static bool sim_http_header_is(const struct MvHttpRequest* request, const char* name, const char* value) {
+
+    uint32_t name_len = (uint32_t)strlen(name);
+    uint32_t value_len = (uint32_t)strlen(value);
+    for (uint32_t i = 0 ; i < request->num_headers ; ++i) {
+        const struct MvHttpHeader* header = &request->headers[i];
+        if (header->key.length == name_len && strncasecmp((const char*)header->key.data, name, name_len) == 0) {
+            return header->value.length == value_len && memcmp(header->value.data, value, value_len) == 0;
+        }
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Check that a compressed request body expands, as the server
+ *        must expand it to use it.
+ */
+static bool sim_http_body_expands(const struct MvHttpRequest* request) {
+
+    uint8_t body[SIM_BODY_MAX_LEN_B];
+    uint32_t length = 0;
+    return compress_expand(request->body.data, request->body.length, body, sizeof(body), NULL, 0, &length);
+}
+
+
+/**
+ * @brief Generate the response a jsonplaceholder-like server would send.
+ *
+ * `GET .../todos/N` yields a todo record for N in 1..`MV_SIM_TODO_COUNT`,
+ * and a 404 beyond that. Any `POST` is accepted with a 201, and a reply in
+ * CBOR if the request's body was CBOR, or a 400 if a compressed body
+ * doesn't expand. A GET whose
+ * If-None-Match or If-Modified-Since validator still holds gets a 304
+ * with no body. Requests beyond `MV_SIM_RATE_LIMIT` a minute get a 429,
+ * with a Retry-After of the rest of the minute.
+ *
+ * @param channel: The channel record.
+ * @param request: The request.
+ */
+static void sim_http_route(struct sim_channel* channel, const struct MvHttpRequest* request) {
+
+    char url[256] = "";
+    uint32_t url_len = request->url.length < sizeof(url) - 1 ? request->url.length : sizeof(url) - 1;
+    memcpy(url, request->url.data, url_len);
+
+    bool is_get  = request->method.length == 3 && memcmp(request->method.data, "GET", 3) == 0;
+    bool is_post = request->method.length == 4 && memcmp(request->method.data, "POST", 4) == 0;
+
+    struct MvHttpResponseData* response = &channel->response;
+    memset(response, 0, sizeof(struct MvHttpResponseData));
+    response->result = MV_HTTPRESULT_OK;
+
+    // The server counts requests in one-minute windows
+    static uint64_t window = 0;
+    static uint32_t window_requests = 0;
+    if (sim_clock / 60000000ULL != window) {
+        window = sim_clock / 60000000ULL;
+        window_requests = 0;
+    }
+
+    uint32_t limit = sim_config.rate_limit > 0 ? sim_config.rate_limit : 1000;
+    bool limited = sim_config.rate_limit > 0 && window_requests >= limit;
+    if (!limited) window_requests++;
+
+    int body_len = 0;
+    const char* content_type = "application/json; charset=utf-8";
+    const char* todos = strstr(url, "/todos/");
+    if (limited) {
+        response->status_code = 429;
+        body_len = snprintf((char*)channel->body, SIM_BODY_MAX_LEN_B, "{}");
+    } else if (is_get && todos != NULL) {
+        uint32_t id = (uint32_t)strtoul(todos + 7, NULL, 10);
+        if (id >= 1 && id <= sim_config.todo_count) {
+            response->status_code = 200;
+            body_len = snprintf((char*)channel->body, SIM_BODY_MAX_LEN_B,
+                                "{\n  \"userId\": %u,\n  \"id\": %u,\n  \"title\": \"%s\",\n  \"completed\": %s\n}",
+                                (id - 1) / 20 + 1, id,
+                                sim_todo_titles[(id - 1) % (sizeof(sim_todo_titles) / sizeof(sim_todo_titles[0]))],
+                                id % 3 == 0 ? "true" : "false");
+        } else {
+            response->status_code = 404;
+            body_len = snprintf((char*)channel->body, SIM_BODY_MAX_LEN_B, "{}");
+        }
+    } else if (is_post && sim_http_header_is(request, "content-encoding", COMPRESS_ENCODING) && !sim_http_body_expands(request)) {
+        response->status_code = 400;
+        body_len = snprintf((char*)channel->body, SIM_BODY_MAX_LEN_B, "{}");
+    } else if (is_post && sim_http_header_is(request, "content-type", "application/cbor")) {
+        // {"id": 101}
+        static const uint8_t reply[] = { 0xA1, 0x62, 'i', 'd', 0x18, 101 };
+        response->status_code = 201;
+        memcpy(channel->body, reply, sizeof(reply));
+        body_len = sizeof(reply);
+        content_type = "application/cbor";
+    } else if (is_post) {
+        response->status_code = 201;
+        body_len = snprintf((char*)channel->body, SIM_BODY_MAX_LEN_B, "{\n  \"id\": 101\n}");
+    } else if (is_get) {
+        response->status_code = 404;
+        body_len = snprintf((char*)channel->body, SIM_BODY_MAX_LEN_B, "{}");
+    } else {
+        response->result = MV_HTTPRESULT_UNSUPPORTEDMETHOD;
+        return;
+    }
+
+    // Derive a stable validator from the body, as an origin server would
+    uint32_t hash = 2166136261u;
+    for (int i = 0 ; i < body_len ; ++i) hash = (hash ^ channel->body[i]) * 16777619u;
+    char etag[32];
+    snprintf(etag, sizeof(etag), "W/\"%x-%08x\"", (unsigned)body_len, hash);
+
+    if (response->status_code == 200 && sim_http_not_modified(request, etag)) {
+        response->status_code = 304;
+        body_len = 0;
+    }
+
+    // The headers jsonplaceholder sends from behind Cloudflare, in its
+    // order: the validators come late, after long reporting headers
+    uint32_t seconds = (uint32_t)(sim_clock / 1000000ULL);
+    response->body_length = (uint32_t)body_len;
+    sim_http_add_header(channel, "date: Tue, 30 Jul 2024 %02u:%02u:%02u GMT",
+                        (unsigned)(seconds / 3600 % 24), (unsigned)(seconds / 60 % 60), (unsigned)(seconds % 60));
+    sim_http_add_header(channel, "content-type: %s", content_type);
+    sim_http_add_header(channel, "content-length: %u", (unsigned)body_len);
+    sim_http_add_header(channel, "connection: keep-alive");
+    sim_http_add_header(channel, "report-to: {\"group\":\"heroku-nel\",\"max_age\":3600,\"endpoints\":[{\"url\":\"https://nel.heroku.com/reports?ts=%u&sid=e11707d5-02a7-43ef-b45e-2cf4d2036f7d&s=gq%%2FfqvqfUcaxZ8wZkHlqiwDTAPOdxRdWTg1rMy%%2BoFQk%%3D\"}]}",
+                        (unsigned)(1722297600 + seconds));
+    sim_http_add_header(channel, "reporting-endpoints: heroku-nel=https://nel.heroku.com/reports?ts=%u&sid=e11707d5-02a7-43ef-b45e-2cf4d2036f7d&s=gq%%2FfqvqfUcaxZ8wZkHlqiwDTAPOdxRdWTg1rMy%%2BoFQk%%3D",
+                        (unsigned)(1722297600 + seconds));
+    sim_http_add_header(channel, "nel: {\"report_to\":\"heroku-nel\",\"max_age\":3600,\"success_fraction\":0.005,\"failure_fraction\":0.05,\"response_headers\":[\"Via\"]}");
+    sim_http_add_header(channel, "x-powered-by: Express");
+    sim_http_add_header(channel, "x-ratelimit-limit: %u", (unsigned)limit);
+    sim_http_add_header(channel, "x-ratelimit-remaining: %u", (unsigned)(limit - window_requests));
+    sim_http_add_header(channel, "x-ratelimit-reset: %u", (unsigned)(1722297600 + seconds - seconds % 60 + 60));
+    sim_http_add_header(channel, "vary: Origin, Accept-Encoding");
+    sim_http_add_header(channel, "access-control-allow-credentials: true");
+    sim_http_add_header(channel, "cache-control: max-age=43200");
+    sim_http_add_header(channel, "pragma: no-cache");
+    sim_http_add_header(channel, "expires: -1");
+    sim_http_add_header(channel, "x-content-type-options: nosniff");
+    if (limited) {
+        sim_http_add_header(channel, "retry-after: %u", (unsigned)(60 - seconds % 60));
+    } else {
+        sim_http_add_header(channel, "etag: %s", etag);
+        sim_http_add_header(channel, "last-modified: %s", SIM_LAST_MODIFIED);
+    }
+
+    sim_http_add_header(channel, "via: 1.1 vegur");
+    sim_http_add_header(channel, "cf-cache-status: HIT");
+    sim_http_add_header(channel, "age: %u", (unsigned)(seconds % 43200));
+    sim_http_add_header(channel, "server: cloudflare");
+    sim_http_add_header(channel, "cf-ray: 8ab3c7e9%08x-LHR", (unsigned)hash);
+    sim_http_add_header(channel, "alt-svc: h3=\":443\"; ma=86400");
+
+    // Microvisor stages the whole response in the channel's receive buffer
+    uint32_t total = response->body_length;
+    for (uint32_t i = 0 ; i < response->num_headers ; ++i) total += strlen(channel->headers[i]) + 2;
+    if (total > channel->rx_len) {
+        response->result = MV_HTTPRESULT_RESPONSETOOLARGE;
+        response->status_code = 0;
+        response->num_headers = 0;
+        response->body_length = 0;
+        return;
+    }
+
+    sim_stats.http_rx_bytes += total;
+}
+
+
+enum MvStatus mvSendHttpRequest(MvChannelHandle handle, const struct MvHttpRequest* request) {
+
+    sim_syscall();
+    struct sim_channel* channel = sim_get_channel(handle);
+    if (channel == NULL || channel->closure != 0) return MV_STATUS_CHANNELCLOSED;
+    if (request == NULL || request->method.data == NULL || request->url.data == NULL) return MV_STATUS_PARAMETERFAULT;
+    if (request->num_headers > 0 && request->headers == NULL) return MV_STATUS_PARAMETERFAULT;
+    if (channel->in_flight) return MV_STATUS_UNAVAILABLE;
+
+    // Microvisor serializes the request into the channel's send buffer
+    uint32_t size = request->method.length + request->url.length + request->body.length + 16;
+    for (uint32_t i = 0 ; i < request->num_headers ; ++i) {
+        size += request->headers[i].key.length + request->headers[i].value.length + 4;
+    }
+
+    if (size > channel->tx_len) return MV_STATUS_INVALIDBUFFERSIZE;
+
+    channel->has_response = false;
+    channel->in_flight = true;
+    sim_http_route(channel, request);
+    sim_stats.http_requests++;
+    sim_stats.http_tx_bytes += size;
+
+    // A new channel connects to the cloud on its first request
+    uint64_t latency = sim_config.http_latency_us;
+    if (!channel->connected) latency += sim_config.channel_setup_us;
+    channel->connected = true;
+
+    uint32_t index = (uint32_t)(channel - sim_channels);
+    sim_schedule(sim_clock + latency, sim_http_respond, index, channel->generation);
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvReadHttpResponseData(MvChannelHandle handle, struct MvHttpResponseData* response) {
+
+    sim_syscall();
+    struct sim_channel* channel = sim_get_channel(handle);
+    if (channel == NULL) return MV_STATUS_CHANNELCLOSED;
+    if (!channel->has_response) return MV_STATUS_RESPONSENOTPRESENT;
+    *response = channel->response;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvReadHttpResponseHeader(MvChannelHandle handle, uint32_t index, uint8_t* buffer, uint32_t size) {
+
+    sim_syscall();
+    struct sim_channel* channel = sim_get_channel(handle);
+    if (channel == NULL) return MV_STATUS_CHANNELCLOSED;
+    if (!channel->has_response) return MV_STATUS_RESPONSENOTPRESENT;
+    if (index >= channel->response.num_headers) return MV_STATUS_HEADERINDEXINVALID;
+
+    uint32_t length = (uint32_t)strlen(channel->headers[index]);
+    if (size < length) return MV_STATUS_INVALIDBUFFERSIZE;
+    memcpy(buffer, channel->headers[index], length);
+    if (size > length) buffer[length] = 0;
+    return MV_STATUS_OKAY;
+}
+
+
+enum MvStatus mvReadHttpResponseBody(MvChannelHandle handle, uint32_t offset, uint8_t* buffer, uint32_t size) {
+
+    sim_syscall();
+    struct sim_channel* channel = sim_get_channel(handle);
+    if (channel == NULL) return MV_STATUS_CHANNELCLOSED;
+    if (!channel->has_response) return MV_STATUS_RESPONSENOTPRESENT;
+    if (offset > channel->response.body_length) return MV_STATUS_OFFSETINVALID;
+
+    uint32_t available = channel->response.body_length - offset;
+    memcpy(buffer, &channel->body[offset], size < available ? size : available);
+    return MV_STATUS_OKAY;
+}
@@ -0,0 +1,127 @@
+/**
+ *
+ * Microvisor Remote Debugging Demo
+ * Host simulation internals
+ *
+ * Copyright © 2024, KORE Wireless
+ * Licence: MIT
+ *
+ */
+#ifndef _MV_SIM_H_
+#define _MV_SIM_H_
+
+
+/*
+ * INCLUDES
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "stm32u5xx_hal.h"
+#include "mv_syscalls.h"
+
+
+/*
+ * CONSTANTS
+ */
+#define     SIM_NEVER                       UINT64_MAX
+#define     SIM_MAX_EVENTS                  32
+#define     SIM_MAX_NOTIFICATION_CENTERS    4
+#define     SIM_MAX_CHANNELS                4
+#define     SIM_MAX_HEADERS                 24
+#define     SIM_HEADER_MAX_LEN_B            256
+#define     SIM_BODY_MAX_LEN_B              4096
+#define     SIM_WALL_CLOCK_EPOCH_S          1722297600ULL   // 2024-07-30 00:00:00 UTC
+#define     SIM_LAST_MODIFIED               "Mon, 01 Jul 2024 00:00:00 GMT"
+#define     SIM_FLASH_SIZE_B                0x200000
+#define     SIM_FLASH_PROGRAM_US            120             // Per quad-word, typical
+#define     SIM_FLASH_ERASE_US              1500            // Per page, typical
+
+
+/*
+ * TYPES
+ */
+typedef void (*sim_event_fn)(uint32_t arg_a, uint32_t arg_b);
+
+struct sim_stats {
+    uint64_t    polls;
+    uint64_t    syscalls;
+    uint64_t    wfi_calls;
+    uint64_t    irqs;
+    uint64_t    notifications_posted;
+    uint64_t    notifications_dropped;
+    uint64_t    led_toggles;
+    uint64_t    log_lines;
+    uint64_t    log_bytes;
+    uint64_t    uart_bytes;
+    uint64_t    uart_blocked_us;
+    uint64_t    network_requests;
+    uint64_t    network_drops;
+    uint64_t    channels_opened;
+    uint64_t    channels_closed;
+    uint64_t    http_requests;
+    uint64_t    http_responses;
+    uint64_t    http_tx_bytes;
+    uint64_t    http_rx_bytes;
+};
+
+struct sim_flash_stats {
+    uint64_t    programs;               // Quad-words
+    uint64_t    erases;                 // Pages
+    uint64_t    errors;                 // Locked, misaligned or not erased
+    uint64_t    busy_us;
+};
+
+struct sim_config {
+    uint64_t    run_us;
+    uint64_t    poll_us;
+    uint64_t    net_attach_us;
+    uint64_t    net_drop_us;            // 0 for never
+    uint64_t    net_down_us;
+    uint64_t    http_latency_us;
+    uint64_t    channel_setup_us;
+    uint32_t    todo_count;
+    uint32_t    rate_limit;             // Requests per minute, 0 for no limit
+    bool        echo_log;
+    bool        echo_uart;
+};
+
+
+/*
+ * GLOBALS
+ */
+extern struct sim_stats     sim_stats;
+extern struct sim_config    sim_config;
+extern struct sim_flash_stats sim_flash_stats;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * PROTOTYPES
+ */
+// Virtual clock -- `mv_sim.c`
+uint64_t    sim_now(void);
+void        sim_advance(uint64_t delta_us);
+void        sim_advance_to(uint64_t when_us);
+uint64_t    sim_next_deadline(void);
+void        sim_schedule(uint64_t when_us, sim_event_fn fn, uint32_t arg_a, uint32_t arg_b);
+void        sim_finish(void);
+
+// Interrupt controller -- `hal_sim.c`
+void        sim_irq_raise(uint32_t irq);
+void        sim_irq_service_pending(void);
+
+// Flash -- `flash_sim.c`
+uint32_t    sim_flash_page_erases(uint32_t address);
+void        sim_flash_poke(uint32_t address, uint8_t value);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif      // _MV_SIM_H_
@@ -0,0 +1,19 @@
+# Microvisor Remote Debugging Demo
+# Deferred log dictionary size check
+#
+# Copyright © 2024, KORE Wireless
+# Licence: MIT
+#
+# A deferred record's ID is its format string's offset in the dictionary,
+# sent in 15 bits: the 16th is LOG_DEFERRED_ERROR_FLAG. Past 32KB, IDs
+# would alias other format strings and `tools/log_decode.py` would print
+# the wrong text, so the build fails instead.
+#
+# Usage: cmake -DLOGDICT=<app>.logdict -P check_logdict.cmake
+
+set(LOGDICT_MAX_B 32768)
+
+file(SIZE "${LOGDICT}" LOGDICT_SIZE_B)
+if(LOGDICT_SIZE_B GREATER LOGDICT_MAX_B)
+    message(FATAL_ERROR "${LOGDICT} is ${LOGDICT_SIZE_B} bytes: deferred log IDs only reach ${LOGDICT_MAX_B}")
+endif()
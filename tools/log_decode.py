@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""
+Microvisor Remote Debugging Demo
+Deferred log decoder
+
+Copyright © 2024, KORE Wireless
+Licence: MIT
+
+Turns the deferred log records written by a `LOG_DEFERRED=true` build
+back into text. Reads log lines from a file or stdin, and replaces each
+record -- `~` followed by base64 -- with its message. Other text, such
+as timestamps and messages logged as text, passes through unchanged.
+
+Also expands the compressed records written by a `LOG_COMPRESS=true`
+build -- `^` followed by base64 -- into the messages they hold, one a
+line. The two options are mutually exclusive, so the dictionary is only
+needed for deferred records.
+
+Usage: log_decode.py <app>.logdict [log file]
+"""
+
+import base64
+import re
+import struct
+import sys
+
+ERROR_FLAG = 0x8000
+RECORD = re.compile(r"~([A-Za-z0-9+/]+)")
+COMPRESSED = re.compile(r"\^([A-Za-z0-9+/]+)")
+
+# COMPRESS_WINDOW_BITS and COMPRESS_LENGTH_BITS in demo/compress.h
+WINDOW_BITS = 9
+LENGTH_BITS = 5
+
+# LOG_COMPRESS_DICTIONARY in demo/logging.h
+COMPRESS_DICTIONARY = (b"[ERROR] HTTP status code: \n[DEBUG] HTTP server busy: holding requests for \n"
+                       b"[DEBUG] HTTP hold over: sending queued requests\n"
+                       b"[DEBUG] HTTP response received. Body length:  bytes, type: application/json; charset=utf-8\n"
+                       b"[DEBUG] Todo : \" (not completed)\n[DEBUG] Debug test variable value: \n"
+                       b"[DEBUG] Preparing HTTP request\n[DEBUG] Request sent to the Microvisor Cloud\n")
+SPEC = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|z|j|t)?([diouxXcpfFeEgGaAs%])")
+
+
+class Record:
+    """Reads a record's arguments in order."""
+
+    def __init__(self, data):
+        self.data = data
+        self.offset = 0
+
+    def take(self, size, fmt):
+        if self.offset + size > len(self.data):
+            return None
+        value = struct.unpack_from(fmt, self.data, self.offset)[0]
+        self.offset += size
+        return value
+
+    def string(self):
+        end = self.data.find(b"\0", self.offset)
+        if end < 0:
+            return None
+        value = self.data[self.offset:end].decode("utf-8", "replace")
+        self.offset = end + 1
+        return value
+
+
+def format_message(fmt, record):
+    """Apply a format string to a record's arguments, as printf would."""
+
+    def convert(match):
+        flags, width, precision, modifier, kind = match.groups()
+        if kind == "%":
+            return "%"
+
+        if width == "*":
+            width = record.take(4, "<i")
+            width = "" if width is None else str(width)
+        if precision == "*":
+            precision = record.take(4, "<i")
+            precision = None if precision is None else str(precision)
+
+        if kind in "diouxXc":
+            signed = kind in "di"
+            if modifier == "ll":
+                value = record.take(8, "<q" if signed else "<Q")
+            else:
+                value = record.take(4, "<i" if signed else "<I")
+        elif kind == "p":
+            value = record.take(4, "<I")
+            kind, flags = "x", "#" + (flags or "")
+        elif kind == "s":
+            value = record.string()
+        else:
+            value = record.take(8, "<d")
+            kind = {"F": "f", "a": "e", "A": "E"}.get(kind, kind)
+
+        if value is None:
+            return "<?>"
+
+        spec = "%" + (flags or "") + (width or "") + ("." + precision if precision is not None else "") + kind
+        return spec % value
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode_record(dictionary, text):
+    """Decode one base64 record, or return None if it isn't one."""
+
+    try:
+        data = base64.b64decode(text + "=" * (-len(text) % 4))
+    except ValueError:
+        return None
+    if len(data) < 2:
+        return None
+
+    ident = struct.unpack_from("<H", data)[0]
+    offset = ident & ~ERROR_FLAG
+    end = dictionary.find(b"\0", offset)
+    if offset >= len(dictionary) or end < 0:
+        return None
+
+    fmt = dictionary[offset:end].decode("utf-8", "replace")
+    record = Record(data)
+    record.offset = 2
+    prefix = "[ERROR] " if ident & ERROR_FLAG else "[DEBUG] "
+    return prefix + format_message(fmt, record)
+
+
+def expand(data, dictionary):
+    """Decompress an LZSS bit stream, as compress_expand() does, or return None if it's malformed."""
+
+    bits = int.from_bytes(data, "big")
+    remaining = len(data) * 8
+    out = bytearray(dictionary)
+    while remaining >= 9:
+        remaining -= 1
+        if (bits >> remaining) & 1:
+            remaining -= 8
+            out.append((bits >> remaining) & 0xFF)
+            continue
+
+        if remaining < WINDOW_BITS + LENGTH_BITS:
+            return None
+        remaining -= WINDOW_BITS + LENGTH_BITS
+        token = bits >> remaining
+        distance = ((token >> LENGTH_BITS) & ((1 << WINDOW_BITS) - 1)) + 1
+        count = (token & ((1 << LENGTH_BITS) - 1)) + 1
+        if distance > len(out):
+            return None
+        for _ in range(count):
+            out.append(out[-distance])
+
+    return bytes(out[len(dictionary):])
+
+
+def decode_compressed(text):
+    """Expand one base64 compressed record, or return None if it isn't one."""
+
+    try:
+        data = base64.b64decode(text + "=" * (-len(text) % 4))
+    except ValueError:
+        return None
+
+    messages = expand(data, COMPRESS_DICTIONARY)
+    return None if messages is None else messages.decode("utf-8", "replace")
+
+
+def main():
+    if len(sys.argv) < 2:
+        sys.stderr.write(__doc__)
+        return 1
+
+    with open(sys.argv[1], "rb") as file:
+        dictionary = file.read()
+
+    source = open(sys.argv[2], encoding="utf-8", errors="replace") if len(sys.argv) > 2 else sys.stdin
+    for line in source:
+        def replace(match):
+            message = decode_record(dictionary, match.group(1))
+            return match.group(0) if message is None else message
+
+        def expand_record(match):
+            messages = decode_compressed(match.group(1))
+            return match.group(0) if messages is None else messages
+
+        sys.stdout.write(RECORD.sub(replace, COMPRESSED.sub(expand_record, line)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())